@@ -0,0 +1,59 @@
+#include "AsyncWriter.h"
+#include "gromacs/utility/exceptions.h"
+
+namespace fda {
+
+AsyncWriter::AsyncWriter(size_t capacity)
+ : capacity(capacity ? capacity : 1),
+   busy(false),
+   stop(false),
+   thread(&AsyncWriter::run, this)
+{}
+
+AsyncWriter::~AsyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    task_available.notify_one();
+    thread.join();
+}
+
+void AsyncWriter::push(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        task_done.wait(lock, [this]{ return tasks.size() < capacity; });
+        tasks.push_back(std::move(task));
+    }
+    task_available.notify_one();
+}
+
+void AsyncWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    task_done.wait(lock, [this]{ return tasks.empty() and !busy; });
+}
+
+void AsyncWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        task_available.wait(lock, [this]{ return stop or !tasks.empty(); });
+        if (tasks.empty()) break;
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        busy = true;
+        lock.unlock();
+        try {
+            task();
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+        lock.lock();
+        busy = false;
+        task_done.notify_all();
+    }
+}
+
+} // namespace fda
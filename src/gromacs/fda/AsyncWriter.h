@@ -0,0 +1,67 @@
+#ifndef SRC_GROMACS_FDA_ASYNCWRITER_H_
+#define SRC_GROMACS_FDA_ASYNCWRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace fda {
+
+/**
+ * Background thread executing write tasks
+ *
+ * The tasks are executed one after the other in the order of push,
+ * so that the output is identical to writing directly.
+ * At most capacity tasks are pending, push blocks if the queue is full (back-pressure),
+ * which limits the number of frame snapshots in memory.
+ */
+class AsyncWriter
+{
+public:
+
+    /// Start the writer thread
+    AsyncWriter(size_t capacity = 2);
+
+    /// Execute all pending tasks and stop the writer thread
+    ~AsyncWriter();
+
+    AsyncWriter(AsyncWriter const&) = delete;
+    AsyncWriter& operator = (AsyncWriter const&) = delete;
+
+    /// Queue a task, blocks while capacity tasks are pending
+    void push(std::function<void()> task);
+
+    /// Block until all queued tasks are executed
+    void wait();
+
+private:
+
+    /// Loop of the writer thread
+    void run();
+
+    size_t capacity;
+
+    std::deque<std::function<void()>> tasks;
+
+    /// True while the writer thread executes a task
+    bool busy;
+
+    bool stop;
+
+    std::mutex mutex;
+
+    /// Signaled when a task is queued or the writer should stop
+    std::condition_variable task_available;
+
+    /// Signaled when a task is finished
+    std::condition_variable task_done;
+
+    std::thread thread;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_ASYNCWRITER_H_ */
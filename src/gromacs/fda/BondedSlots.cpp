@@ -0,0 +1,61 @@
+#include <algorithm>
+#include "BondedSlots.h"
+#include "gromacs/topology/ifunc.h"
+
+namespace fda {
+
+const int BondedSlots::npos;
+
+BondedSlots::BondedSlots(t_idef const& idef, FDASettings const& fda_settings, bool residue_based)
+ : offsets(fda_settings.syslen_atoms + 1, 0)
+{
+    // Collect all atom pairs of bonded interactions with one atom in each group
+    for (int ftype = 0; ftype < F_NRE; ++ftype) {
+        if (!(interaction_function[ftype].flags & IF_BOND)) continue;
+        int nral = NRAL(ftype);
+        t_ilist const& il = idef.il[ftype];
+        for (int n = 0; n < il.nr; n += nral + 1) {
+            t_iatom const* atoms = il.iatoms + n + 1;
+            for (int a = 0; a < nral; ++a) {
+                for (int b = a + 1; b < nral; ++b) {
+                    int i = std::min(atoms[a], atoms[b]);
+                    int j = std::max(atoms[a], atoms[b]);
+                    if (i == j or !fda_settings.atoms_in_index_groups(i, j)) continue;
+                    atom_pairs.push_back(std::make_pair(i, j));
+                }
+            }
+        }
+    }
+    std::sort(atom_pairs.begin(), atom_pairs.end());
+    atom_pairs.erase(std::unique(atom_pairs.begin(), atom_pairs.end()), atom_pairs.end());
+
+    partners.reserve(atom_pairs.size());
+    for (auto const& p : atom_pairs) {
+        ++offsets[p.first + 1];
+        partners.push_back(p.second);
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) offsets[i] += offsets[i - 1];
+
+    // Residue pairs, atom pairs within the same residue are not considered for residue-based forces
+    if (residue_based) {
+        residue_slots.resize(atom_pairs.size(), npos);
+        for (auto const& p : atom_pairs) {
+            int ri = fda_settings.get_atom2residue(p.first);
+            int rj = fda_settings.get_atom2residue(p.second);
+            if (ri != rj) residue_pairs.push_back(std::make_pair(std::min(ri, rj), std::max(ri, rj)));
+        }
+        std::sort(residue_pairs.begin(), residue_pairs.end());
+        residue_pairs.erase(std::unique(residue_pairs.begin(), residue_pairs.end()), residue_pairs.end());
+
+        for (size_t slot = 0; slot != atom_pairs.size(); ++slot) {
+            int ri = fda_settings.get_atom2residue(atom_pairs[slot].first);
+            int rj = fda_settings.get_atom2residue(atom_pairs[slot].second);
+            if (ri == rj) continue;
+            auto iter = std::lower_bound(residue_pairs.begin(), residue_pairs.end(),
+                std::make_pair(std::min(ri, rj), std::max(ri, rj)));
+            residue_slots[slot] = std::distance(residue_pairs.begin(), iter);
+        }
+    }
+}
+
+} // namespace fda
@@ -0,0 +1,83 @@
+#ifndef SRC_GROMACS_FDA_BONDEDSLOTS_H_
+#define SRC_GROMACS_FDA_BONDEDSLOTS_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "FDASettings.h"
+#include "gromacs/topology/idef.h"
+
+namespace fda {
+
+/// Pairs (i,j) with i < j, the position in the list is the slot index
+typedef std::vector<std::pair<int, int>> PairList;
+
+/**
+ * Static slot table for bonded interactions
+ *
+ * The atoms of bonded interactions are known at simulation start and do not change.
+ * Each atom pair of a bonded interaction which is relevant for FDA (one atom in each group)
+ * get a fixed slot, so that the bonded forces can be accumulated in a flat array
+ * without searching the pair within all neighbours of an atom.
+ * The decomposition of angles and dihedrals produces forces between all atoms of the interaction,
+ * therefore all atom pairs of an interaction are registered.
+ *
+ * The slot of a pair is found by a binary search over the bonded partners of the first atom only,
+ * which are only a few, independent of the number of nonbonded neighbours.
+ */
+class BondedSlots
+{
+public:
+
+    /// Returned by find if the pair has no slot
+    static const int npos = -1;
+
+    /// Default constructor, no slots
+    BondedSlots() {}
+
+    /// Build the slot table from the interaction lists of the local topology
+    BondedSlots(t_idef const& idef, FDASettings const& fda_settings, bool residue_based);
+
+    /// Return the slot of atom pair (i,j) or npos, the order of i and j is irrelevant
+    int find(int i, int j) const
+    {
+        if (i > j) std::swap(i, j);
+        if (i >= static_cast<int>(offsets.size()) - 1) return npos;
+        auto begin = partners.begin() + offsets[i];
+        auto end = partners.begin() + offsets[i + 1];
+        auto iter = std::lower_bound(begin, end, j);
+        if (iter == end or *iter != j) return npos;
+        return std::distance(partners.begin(), iter);
+    }
+
+    /// Return the residue slot of an atom slot or npos if both atoms belong to the same residue
+    int get_residue_slot(int slot) const { return residue_slots[slot]; }
+
+    /// Atom pairs of all slots
+    PairList const& get_atom_pairs() const { return atom_pairs; }
+
+    /// Residue pairs of all residue slots
+    PairList const& get_residue_pairs() const { return residue_pairs; }
+
+private:
+
+    /// First slot for each atom i in partners (CSR), length syslen_atoms + 1
+    std::vector<int> offsets;
+
+    /// Sorted second atoms j of each atom i
+    std::vector<int> partners;
+
+    /// Atom pairs, same order as partners
+    PairList atom_pairs;
+
+    /// Residue slot for each atom slot
+    std::vector<int> residue_slots;
+
+    /// Residue pairs
+    PairList residue_pairs;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_BONDEDSLOTS_H_ */
@@ -0,0 +1,28 @@
+#ifndef SRC_GROMACS_FDA_COMPATFORMAT_H_
+#define SRC_GROMACS_FDA_COMPATFORMAT_H_
+
+#include <cstdint>
+#include "gromacs/fda/Varint.h"
+
+namespace fda {
+
+/**
+ * Helper for the compat format version 2.0
+ *
+ * A pair (i, j) with i < j is stored as key i * syslen + j. The keys are 64-bit,
+ * so that systems with more than 46340 particles can be written without overflow.
+ * The keys of a frame are sorted ascending and stored as differences to the previous key,
+ * the first key is the difference to zero. Binary files store the differences as
+ * variable length integers with 7 bits per byte (LEB128), small differences need a single byte.
+ * The list of particles with interactions is encoded in the same way.
+ */
+
+/// Return the 64-bit key of pair (i, j)
+inline int64_t compat_pair_key(int i, int j, int syslen)
+{
+    return static_cast<int64_t>(i) * syslen + j;
+}
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_COMPATFORMAT_H_ */
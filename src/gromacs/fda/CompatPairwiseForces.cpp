@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "CompatFormat.h"
+#include "CompatInteractionType.h"
+#include "CompatPairwiseForces.h"
+#include "FrameIndex.h"
+#include "FrameView.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace fda {
+
+namespace {
+
+const std::string begin_block = "<begin_block>";
+const std::string end_block = "<end_block>";
+
+/// Return the line starting at p without line break and move p behind it
+std::string get_line(char const*& p, char const* last)
+{
+    char const* end = static_cast<char const*>(std::memchr(p, '\n', last - p));
+    if (!end) end = last;
+    std::string line(p, end);
+    if (!line.empty() and line.back() == '\r') line.pop_back();
+    p = end == last ? last : end + 1;
+    return line;
+}
+
+InteractionType interaction_type_from_compat(int type)
+{
+    switch (static_cast<CompatInteractionType>(type)) {
+        case CompatInteractionType::NONE:
+            return InteractionType_NONE;
+        case CompatInteractionType::ALL:
+            return InteractionType_ALL;
+        default:
+            return from_compat(static_cast<CompatInteractionType>(type));
+    }
+}
+
+} // namespace
+
+CompatPairwiseForces::CompatPairwiseForces(std::string const& filename)
+ : filename(filename),
+   file(std::make_shared<MappedFile>(filename)),
+   dimension(0),
+   realsize(sizeof(real)),
+   is_delta_encoded(false),
+   is_binary(false)
+{
+    build_frame_index(read_header());
+}
+
+bool CompatPairwiseForces::is_compat(std::string const& filename)
+{
+    std::ifstream is(filename);
+    std::string line;
+    std::getline(is, line);
+    return line.compare(0, begin_block.size(), begin_block) == 0;
+}
+
+char const* CompatPairwiseForces::read_header()
+{
+    char const* p = file->begin();
+    char const* last = file->end();
+
+    if (get_line(p, last) != begin_block) gmx_fatal(FARGS, "File %s is not in compat format.", filename.c_str());
+    for (;;) {
+        if (p == last) gmx_fatal(FARGS, "Incomplete compat header in file %s.", filename.c_str());
+        std::string line = get_line(p, last);
+        if (line == end_block) break;
+        if (line.empty() or line[0] == ';') continue;
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) continue;
+        std::string key = line.substr(0, pos);
+        std::string value = line.substr(pos + 1);
+        if (key == "version") version = value;
+        else if (key == "fmdim") dimension = std::stoi(value);
+        else if (key == "realsize") realsize = std::stoi(value);
+        else if (key == "keyencoding") is_delta_encoded = value == "delta";
+    }
+
+    if (version != "1.5" and version != "2.0")
+        gmx_fatal(FARGS, "Compat version %s of file %s is not supported.", version.c_str(), filename.c_str());
+    if (dimension <= 0) gmx_fatal(FARGS, "Missing force matrix dimension in file %s.", filename.c_str());
+    if (realsize != sizeof(float) and realsize != sizeof(double))
+        gmx_fatal(FARGS, "Wrong real size %d in file %s.", realsize, filename.c_str());
+
+    is_binary = p != last and (static_cast<size_t>(last - p) < begin_block.size()
+        or std::strncmp(p, begin_block.c_str(), begin_block.size()) != 0);
+    if (is_binary and version == "1.5")
+        gmx_fatal(FARGS, "Binary compat files of version 1.5 are not supported, please use compat_ascii or version 2.0.");
+    return p;
+}
+
+void CompatPairwiseForces::build_frame_index(char const* p)
+{
+    char const* first = file->begin();
+    char const* last = file->end();
+
+    if (is_binary) {
+        int step;
+        while (p != last) {
+            char const* q = skip_binary_frame(p, step);
+            // Drop an incomplete last frame of an aborted run
+            if (!q) break;
+            frame_offsets.push_back(p - first);
+            steps.push_back(step);
+            p = q;
+        }
+    } else {
+        while (p != last) {
+            std::string line = get_line(p, last);
+            if (line != begin_block) continue;
+            frame_offsets.push_back(p - first);
+            steps.push_back(std::stoi(get_line(p, last)));
+        }
+    }
+}
+
+char const* CompatPairwiseForces::skip_binary_frame(char const* p, int& step) const
+{
+    char const* last = file->end();
+    const size_t frame_header_size = sizeof(int) + 2 * sizeof(uint64_t);
+    if (static_cast<size_t>(last - p) < frame_header_size) return nullptr;
+
+    step = load_unaligned<int>(p);
+    uint64_t nb_interactions = load_unaligned<uint64_t>(p + sizeof(int));
+    uint64_t nb_atoms = load_unaligned<uint64_t>(p + sizeof(int) + sizeof(uint64_t));
+    p += frame_header_size;
+
+    uint64_t value;
+    for (uint64_t n = 0; n != nb_atoms + nb_interactions; ++n) {
+        p = read_varint(p, last, value);
+        if (!p) return nullptr;
+    }
+
+    uint64_t size = nb_interactions * (realsize + 1);
+    if (static_cast<uint64_t>(last - p) < size) return nullptr;
+    return p + size;
+}
+
+void CompatPairwiseForces::add(std::vector<PairwiseForce<Force<real>>>& pairwise_forces, int64_t key, real force, int type) const
+{
+    if (key < 0 or key >= static_cast<int64_t>(dimension) * dimension)
+        gmx_fatal(FARGS, "Pair key %ld is out of range in file %s.", static_cast<long>(key), filename.c_str());
+    pairwise_forces.push_back(PairwiseForce<Force<real>>(key / dimension, key % dimension,
+        Force<real>(force, interaction_type_from_compat(type))));
+}
+
+std::vector<PairwiseForce<Force<real>>> CompatPairwiseForces::get_pairwise_forces(size_t frame) const
+{
+    if (frame >= get_number_of_frames()) gmx_fatal(FARGS, "Frame not found.");
+
+    char const* p = file->begin() + frame_offsets[frame];
+    char const* last = file->end();
+    std::vector<int64_t> keys;
+    std::vector<real> forces;
+    std::vector<int> types;
+
+    if (is_binary) {
+        uint64_t nb_interactions = load_unaligned<uint64_t>(p + sizeof(int));
+        uint64_t nb_atoms = load_unaligned<uint64_t>(p + sizeof(int) + sizeof(uint64_t));
+        p += sizeof(int) + 2 * sizeof(uint64_t);
+
+        uint64_t value;
+        for (uint64_t n = 0; n != nb_atoms; ++n) p = read_varint(p, last, value);
+        keys.reserve(nb_interactions);
+        int64_t key = 0;
+        for (uint64_t n = 0; n != nb_interactions; ++n) {
+            p = read_varint(p, last, value);
+            key += value;
+            keys.push_back(key);
+        }
+        forces.reserve(nb_interactions);
+        for (uint64_t n = 0; n != nb_interactions; ++n, p += realsize) {
+            if (realsize == sizeof(float)) forces.push_back(load_unaligned<float>(p));
+            else forces.push_back(load_unaligned<double>(p));
+        }
+        types.assign(reinterpret_cast<unsigned char const*>(p), reinterpret_cast<unsigned char const*>(p) + nb_interactions);
+    } else {
+        TextParser parser(p, last);
+        auto check = [&](bool success) {
+            if (!success) gmx_fatal(FARGS, "Wrong format of frame %zu in file %s", frame, filename.c_str());
+        };
+        int step;
+        int64_t nb_interactions;
+        check(parser.next(step));
+        parser.next_line();
+        check(parser.next(nb_interactions));
+        parser.next_line();
+        // Skip the particles with interactions
+        parser.next_line();
+
+        keys.resize(nb_interactions);
+        forces.resize(nb_interactions);
+        types.resize(nb_interactions);
+        int64_t key = 0;
+        for (auto& k : keys) {
+            check(parser.next(k));
+            if (is_delta_encoded) k = key += k;
+        }
+        parser.next_line();
+        for (auto& f : forces) check(parser.next(f));
+        parser.next_line();
+        for (auto& t : types) check(parser.next(t));
+    }
+
+    std::vector<PairwiseForce<Force<real>>> pairwise_forces;
+    pairwise_forces.reserve(keys.size());
+    for (size_t n = 0; n != keys.size(); ++n) add(pairwise_forces, keys[n], forces[n], types[n]);
+
+    // Version 1.5 keys are not sorted
+    if (!is_delta_encoded) {
+        std::stable_sort(pairwise_forces.begin(), pairwise_forces.end(),
+            [](PairwiseForce<Force<real>> const& pf1, PairwiseForce<Force<real>> const& pf2) {
+                return pf1.i < pf2.i or (pf1.i == pf2.i and pf1.j < pf2.j);
+            });
+    }
+    return pairwise_forces;
+}
+
+void CompatPairwiseForces::write(std::string const& out_filename, bool out_binary) const
+{
+    size_t nb_frames = get_number_of_frames();
+    if (out_binary) {
+        std::ofstream os(out_filename, std::ofstream::binary);
+        if (!os) gmx_fatal(FARGS, "Error opening file %s", out_filename.c_str());
+
+        char b = 'b';
+        os.write(&b, 1);
+
+        FrameIndex out_frame_index;
+        for (size_t frame = 0; frame != nb_frames; ++frame) {
+            out_frame_index.add(os.tellp());
+            PairwiseForces<Force<real>>::write_pairwise_forces_binary(os, get_pairwise_forces(frame));
+        }
+        out_frame_index.set_end_of_frames(os.tellp());
+        out_frame_index.write(os);
+    } else {
+        std::ofstream os(out_filename);
+        if (!os) gmx_fatal(FARGS, "Error opening file %s", out_filename.c_str());
+
+        os << "pairwise_forces_scalar\n";
+        for (size_t frame = 0; frame != nb_frames; ++frame) {
+            PairwiseForces<Force<real>>::write_pairwise_forces(os, get_pairwise_forces(frame), frame);
+        }
+    }
+}
+
+} // namespace fda
@@ -0,0 +1,93 @@
+#ifndef SRC_GROMACS_FDA_COMPATPAIRWISEFORCES_H_
+#define SRC_GROMACS_FDA_COMPATPAIRWISEFORCES_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "gromacs/fda/Force.h"
+#include "gromacs/fda/MappedFile.h"
+#include "gromacs/fda/PairwiseForces.h"
+#include "gromacs/utility/real.h"
+
+namespace fda {
+
+/**
+ * Read pairwise forces written in compat mode (compat_ascii, compat_bin).
+ *
+ * Version 2.0 (64-bit delta encoded keys, see CompatFormat.h) is supported in text and binary format.
+ * Version 1.5 is only supported in text format, because the binary format
+ * does not store the number of particles with interactions.
+ */
+class CompatPairwiseForces
+{
+public:
+
+    CompatPairwiseForces(std::string const& filename);
+
+    /// Return true if the file starts with a compat header
+    static bool is_compat(std::string const& filename);
+
+    /// Return the version of the header
+    std::string const& get_version() const { return version; }
+
+    /// Return the dimension of the force matrix
+    int get_dimension() const { return dimension; }
+
+    /// Returns true if the format is binary
+    bool get_is_binary() const { return is_binary; }
+
+    /// Return the number of frames
+    size_t get_number_of_frames() const { return frame_offsets.size(); }
+
+    /// Return the step number of a frame
+    int get_step(size_t frame) const { return steps[frame]; }
+
+    /// Return pairwise forces of a frame sorted by i and j
+    std::vector<PairwiseForce<Force<real>>> get_pairwise_forces(size_t frame) const;
+
+    /// Write all frames in the scalar pairwise forces format
+    void write(std::string const& filename, bool binary = false) const;
+
+private:
+
+    /// Parse the header block and return the position behind it
+    char const* read_header();
+
+    /// Scan the file for the beginning of all frames
+    void build_frame_index(char const* p);
+
+    /// Return the position behind the frame starting at p, nullptr if the frame is incomplete
+    char const* skip_binary_frame(char const* p, int& step) const;
+
+    /// Add a pairwise force decoded from key
+    void add(std::vector<PairwiseForce<Force<real>>>& pairwise_forces, int64_t key, real force, int type) const;
+
+    std::string filename;
+
+    /// Memory mapped file
+    std::shared_ptr<MappedFile> file;
+
+    std::string version;
+
+    /// Dimension of the force matrix (fmdim)
+    int dimension;
+
+    /// Size of real numbers in a binary file
+    int realsize;
+
+    /// True if the keys are stored as differences (version 2.0)
+    bool is_delta_encoded;
+
+    bool is_binary;
+
+    /// Beginning of all frames
+    std::vector<size_t> frame_offsets;
+
+    /// Step numbers of all frames
+    std::vector<int> steps;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_COMPATPAIRWISEFORCES_H_ */
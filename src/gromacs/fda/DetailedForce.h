@@ -36,6 +36,14 @@ struct DetailedForce
         ++number[i];
     }
 
+    void operator += (DetailedForce const& other)
+    {
+        for (int i = 0; i != static_cast<int>(PureInteractionType::NUMBER); ++i) {
+            force[i] += other.force[i];
+            number[i] += other.number[i];
+        }
+    }
+
     /// Vector force separated for each interaction type
     std::array<Vector, static_cast<int>(PureInteractionType::NUMBER)> force;
 
@@ -6,8 +6,12 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <string>
+#include "CompatFormat.h"
 #include "CompatInteractionType.h"
 #include "DistributedForces.h"
+#include "FrameView.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/utility/fatalerror.h"
 #include "Utilities.h"
@@ -18,7 +22,11 @@ DistributedForces::DistributedForces(int syslen, FDASettings const& fda_settings
  : syslen(syslen),
    indices(syslen),
    scalar_indices(syslen),
+   positions(syslen),
+   scalar_positions(syslen),
    scalar(syslen),
+   scalar_statistics(syslen),
+   total_forces_statistics(fda_settings.time_averages_statistics ? syslen : 0),
    summed(syslen),
    detailed(syslen),
    fda_settings(fda_settings)
@@ -27,48 +35,142 @@ DistributedForces::DistributedForces(int syslen, FDASettings const& fda_settings
 void DistributedForces::clear()
 {
     for (auto& e : indices) e.clear();
+    for (auto& e : positions) e.clear();
     for (auto& e : summed) e.clear();
     for (auto& e : detailed) e.clear();
+    for (int slot : bonded_touched) bonded_is_touched[slot] = 0;
+    bonded_touched.clear();
 }
 
 void DistributedForces::clear_scalar()
 {
     for (auto& e : scalar_indices) e.clear();
+    for (auto& e : scalar_positions) e.clear();
     for (auto& e : scalar) e.clear();
+    for (auto& e : scalar_statistics) e.clear();
+    for (auto& e : total_forces_statistics) e = RunningStatistics();
 }
 
-void DistributedForces::add_summed(int i, int j, Vector const& force, InteractionType type)
+void DistributedForces::swap_pairs(DistributedForces& other)
 {
-    if (i > j) throw std::runtime_error("Only upper triangle allowed (i < j).");
+    indices.swap(other.indices);
+    positions.swap(other.positions);
+    summed.swap(other.summed);
+    detailed.swap(other.detailed);
+    scalar_indices.swap(other.scalar_indices);
+    scalar_positions.swap(other.scalar_positions);
+    scalar.swap(other.scalar);
+    scalar_statistics.swap(other.scalar_statistics);
+    total_forces_statistics.swap(other.total_forces_statistics);
+}
 
-    auto & summed_i = summed[i];
-    auto & indices_i = indices[i];
+namespace {
 
-    auto iter = std::find(indices_i.begin(), indices_i.end(), j);
+/// Rows up to this length are searched linearly, which is faster than hashing for few neighbours
+const size_t linear_search_limit = 16;
 
-    if (iter == indices_i.end()) {
-        indices_i.push_back(j);
-        summed_i.push_back(Force<Vector>(force, type));
+/// Return the position of j in row indices_i, which is appended if not found
+int find_or_append(std::vector<int>& indices_i, PairIndex& positions_i, int j, bool& is_new)
+{
+    int p;
+    if (indices_i.size() <= linear_search_limit) {
+        p = std::distance(indices_i.begin(), std::find(indices_i.begin(), indices_i.end(), j));
+        is_new = p == static_cast<int>(indices_i.size());
+        if (is_new) {
+            indices_i.push_back(j);
+            if (indices_i.size() > linear_search_limit) {
+                for (size_t q = 0; q != indices_i.size(); ++q) positions_i.insert(indices_i[q], q);
+            }
+        }
     } else {
-        summed_i[std::distance(indices_i.begin(), iter)] += Force<Vector>(force, type);
+        p = positions_i.find(j);
+        is_new = p == PairIndex::npos;
+        if (is_new) {
+            p = indices_i.size();
+            positions_i.insert(j, p);
+            indices_i.push_back(j);
+        }
     }
+    return p;
+}
+
+} // namespace
+
+int DistributedForces::get_position(int i, int j, bool& is_new)
+{
+    return find_or_append(indices[i], positions[i], j, is_new);
+}
+
+int DistributedForces::get_scalar_position(int i, int j, bool& is_new)
+{
+    return find_or_append(scalar_indices[i], scalar_positions[i], j, is_new);
+}
+
+void DistributedForces::add_summed(int i, int j, Vector const& force, InteractionType type)
+{
+    if (i > j) throw std::runtime_error("Only upper triangle allowed (i < j).");
+
+    bool is_new;
+    int p = get_position(i, j, is_new);
+    if (is_new) summed[i].push_back(Force<Vector>(force, type));
+    else summed[i][p] += Force<Vector>(force, type);
 }
 
 void DistributedForces::add_detailed(int i, int j, Vector const& force, PureInteractionType type)
 {
     if (i > j) throw std::runtime_error("Only upper triangle allowed (i < j).");
 
-    auto & detailed_i = detailed[i];
-    auto & indices_i = indices[i];
+    bool is_new;
+    int p = get_position(i, j, is_new);
+    if (is_new) detailed[i].push_back(DetailedForce(force, type));
+    else detailed[i][p].add(force, type);
+}
+
+void DistributedForces::add_row(int i, DistributedForces const& other)
+{
+    auto const& other_indices_i = other.indices[i];
+    bool other_summed = !other.summed[i].empty();
+
+    for (size_t q = 0; q != other_indices_i.size(); ++q) {
+        bool is_new;
+        int p = get_position(i, other_indices_i[q], is_new);
+        if (other_summed) {
+            if (is_new) summed[i].push_back(other.summed[i][q]);
+            else summed[i][p] += other.summed[i][q];
+        } else {
+            if (is_new) detailed[i].push_back(other.detailed[i][q]);
+            else detailed[i][p] += other.detailed[i][q];
+        }
+    }
+}
 
-    auto iter = std::find(indices_i.begin(), indices_i.end(), j);
+void DistributedForces::set_bonded_pairs(PairList const& pairs)
+{
+    bonded_pairs = pairs;
+    if (fda_settings.one_pair == OnePair::SUMMED) bonded_summed.resize(pairs.size());
+    else bonded_detailed.resize(pairs.size());
+    bonded_is_touched.assign(pairs.size(), 0);
+    bonded_touched.clear();
+    bonded_touched.reserve(pairs.size());
+}
 
-    if (iter == indices_i.end()) {
-        indices_i.push_back(j);
-        detailed_i.push_back(DetailedForce(force, type));
-    } else {
-        detailed_i[std::distance(indices_i.begin(), iter)].add(force, type);
+void DistributedForces::merge_bonded()
+{
+    for (int slot : bonded_touched) {
+        int i = bonded_pairs[slot].first;
+        int j = bonded_pairs[slot].second;
+        bool is_new;
+        int p = get_position(i, j, is_new);
+        if (fda_settings.one_pair == OnePair::SUMMED) {
+            if (is_new) summed[i].push_back(bonded_summed[slot]);
+            else summed[i][p] += bonded_summed[slot];
+        } else {
+            if (is_new) detailed[i].push_back(bonded_detailed[slot]);
+            else detailed[i][p] += bonded_detailed[slot];
+        }
+        bonded_is_touched[slot] = 0;
     }
+    bonded_touched.clear();
 }
 
 void DistributedForces::write_detailed_vector(std::ostream& os) const
@@ -84,7 +186,7 @@ void DistributedForces::write_detailed_vector(std::ostream& os) const
                 Vector const& force = detailed_j.force[type];
                 os << i << " " << j << " "
                    << force[XX] << " " << force[YY] << " " << force[ZZ] << " "
-                   << from_pure(static_cast<PureInteractionType>(type)) << std::endl;
+                   << from_pure(static_cast<PureInteractionType>(type)) << "\n";
             }
         }
     }
@@ -103,7 +205,7 @@ void DistributedForces::write_detailed_scalar(std::ostream& os, gmx::HostVector<
                 Vector const& force = detailed_j.force[type];
                 os << i << " " << j << " "
                    << vector2signedscalar(force.get_pointer(), x[i], x[j], box, fda_settings.v2s) << " "
-                   << from_pure(static_cast<PureInteractionType>(type)) << std::endl;
+                   << from_pure(static_cast<PureInteractionType>(type)) << "\n";
             }
         }
     }
@@ -111,7 +213,9 @@ void DistributedForces::write_detailed_scalar(std::ostream& os, gmx::HostVector<
 
 void DistributedForces::write_summed_vector(std::ostream& os) const
 {
-    if (fda_settings.binary_result_file) {
+    if (fda_settings.compressed_result_file()) {
+        write_compressed(os, summed, indices, [](int, int, Force<Vector> const& f) { return f.force; });
+    } else if (fda_settings.binary_result_file) {
         uint num = number_of_interactions(summed);
         os.write(reinterpret_cast<char*>(&num), sizeof(uint));
         for (uint i = 0; i != summed.size(); ++i) {
@@ -136,7 +240,7 @@ void DistributedForces::write_summed_vector(std::ostream& os) const
                 Vector const& force = summed_j.force;
                 os << i << " " << j << " "
                    << force[XX] << " " << force[YY] << " " << force[ZZ] << " "
-                   << summed_j.type << std::endl;
+                   << summed_j.type << "\n";
             }
         }
     }
@@ -144,7 +248,11 @@ void DistributedForces::write_summed_vector(std::ostream& os) const
 
 void DistributedForces::write_summed_scalar(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const
 {
-    if (fda_settings.binary_result_file) {
+    if (fda_settings.compressed_result_file()) {
+        write_compressed(os, summed, indices, [&](int i, int j, Force<Vector> const& f) {
+            return vector2signedscalar(f.force.get_pointer(), x[i], x[j], box, fda_settings.v2s);
+        });
+    } else if (fda_settings.binary_result_file) {
         uint num = number_of_interactions(summed);
         os.write(reinterpret_cast<char*>(&num), sizeof(uint));
         for (uint i = 0; i != summed.size(); ++i) {
@@ -169,7 +277,7 @@ void DistributedForces::write_summed_scalar(std::ostream& os, gmx::HostVector<gm
                 auto const& summed_j = summed_i[p];
                 os << i << " " << j << " "
                    << vector2signedscalar(summed_j.force.get_pointer(), x[i], x[j], box, fda_settings.v2s) << " "
-                   << summed_j.type << std::endl;
+                   << summed_j.type << "\n";
             }
         }
     }
@@ -177,7 +285,9 @@ void DistributedForces::write_summed_scalar(std::ostream& os, gmx::HostVector<gm
 
 void DistributedForces::write_scalar(std::ostream& os) const
 {
-    if (fda_settings.binary_result_file) {
+    if (fda_settings.compressed_result_file()) {
+        write_compressed(os, scalar, scalar_indices, [](int, int, Force<real> const& f) { return f.force; });
+    } else if (fda_settings.binary_result_file) {
         uint num = number_of_interactions(scalar);
         os.write(reinterpret_cast<char*>(&num), sizeof(uint));
         for (uint i = 0; i != scalar.size(); ++i) {
@@ -186,7 +296,7 @@ void DistributedForces::write_scalar(std::ostream& os) const
             uint num_j = scalar[i].size();
             os.write(reinterpret_cast<char*>(&num_j), sizeof(uint));
             for (uint p = 0; p != num_j; ++p) {
-                uint j = indices[i][p];
+                uint j = scalar_indices[i][p];
                 os.write(reinterpret_cast<char*>(&j), sizeof(uint));
                 os.write(reinterpret_cast<const char*>(&scalar[i][p].force), sizeof(real));
                 os.write(reinterpret_cast<const char*>(&scalar[i][p].type), sizeof(uint));
@@ -201,13 +311,13 @@ void DistributedForces::write_scalar(std::ostream& os) const
                 auto const& scalar_j = scalar_i[p];
                 os << i << " " << j << " "
                    << scalar_j.force << " "
-                   << scalar_j.type << std::endl;
+                   << scalar_j.type << "\n";
             }
         }
     }
 }
 
-void DistributedForces::write_total_forces(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, bool normalize_psr) const
+std::vector<real> DistributedForces::get_total_forces(gmx::HostVector<gmx::RVec> const& x, bool normalize_psr) const
 {
     std::vector<real> total_forces(syslen, 0.0);
     for (size_t i = 0; i != summed.size(); ++i) {
@@ -233,6 +343,18 @@ void DistributedForces::write_total_forces(std::ostream& os, gmx::HostVector<gmx
         }
     }
 
+    if (normalize_psr) {
+        for (int i = 0; i < syslen; ++i) {
+            if (std::abs(total_forces[i]) != 0.0) total_forces[i] /= fda_settings.residue_size[i];
+        }
+    }
+    return total_forces;
+}
+
+void DistributedForces::write_total_forces(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, bool normalize_psr) const
+{
+    std::vector<real> total_forces = get_total_forces(x, normalize_psr);
+
     // Detect the last non-zero item
     // nb_non_zero_forces holds the index of first zero item or the length of force
     uint nb_non_zero_forces = total_forces.size();
@@ -242,12 +364,6 @@ void DistributedForces::write_total_forces(std::ostream& os, gmx::HostVector<gmx
                 break;
     }
 
-    if (normalize_psr) {
-        for (uint i = 0; i < nb_non_zero_forces; ++i) {
-            if (std::abs(total_forces[i]) != 0.0) total_forces[i] /= fda_settings.residue_size[i];
-        }
-    }
-
     if (fda_settings.binary_result_file) {
     	static bool was_called = false;
         if (was_called) {
@@ -265,191 +381,205 @@ void DistributedForces::write_total_forces(std::ostream& os, gmx::HostVector<gmx
                 os << " " << total_forces[i];
             }
         }
-        os << std::endl;
+        os << "\n";
     }
 }
 
-void DistributedForces::write_scalar_compat_ascii(std::ostream& os) const
+void DistributedForces::write_scalar_statistics(std::ostream& os, int nframes) const
 {
-    // Print total number of interactions
-    int nb_interactions = 0;
-    for (auto const& s : scalar) nb_interactions += s.size();
-    os << nb_interactions << std::endl;
-
-    // Print atom indices which have interactions
     for (size_t i = 0; i != scalar.size(); ++i) {
-        if (!scalar[i].empty()) os << i << " ";
-    }
-    os << std::endl;
-
-    // Print indices
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        auto const& scalar_indices_i = scalar_indices[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            size_t j = scalar_indices_i[p];
-            os << (i > j ? j * syslen + i : i * syslen + j) << " ";
+        for (size_t p = 0; p != scalar[i].size(); ++p) {
+            auto const& statistics = scalar_statistics[i][p];
+            os << i << " " << scalar_indices[i][p] << " "
+               << statistics.mean(nframes) << " "
+               << statistics.variance(nframes) << " "
+               << statistics.min(nframes) << " "
+               << statistics.max(nframes) << " "
+               << scalar[i][p].type << "\n";
         }
     }
-    os << std::endl;
+}
 
-    // Print forces
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            auto const& scalar_j = scalar_i[p];
-            os << scalar_j.force << " ";
+void DistributedForces::write_total_forces_statistics(std::ostream& os, int nframes) const
+{
+    auto write_line = [&](std::string const& name, double (RunningStatistics::*get)(int) const) {
+        os << name;
+        for (auto const& statistics : total_forces_statistics) os << " " << (statistics.*get)(nframes);
+        os << "\n";
+    };
+    write_line("mean", &RunningStatistics::mean);
+    write_line("variance", &RunningStatistics::variance);
+    write_line("min", &RunningStatistics::min);
+    write_line("max", &RunningStatistics::max);
+}
+
+ForceMatrix DistributedForces::get_summed_forcematrix(gmx::HostVector<gmx::RVec> const& x, const matrix box) const
+{
+    std::vector<ForceMatrixEntry> entries;
+    entries.reserve(2 * number_of_interactions(summed));
+    for (size_t i = 0; i != summed.size(); ++i) {
+        for (size_t p = 0; p != summed[i].size(); ++p) {
+            int j = indices[i][p];
+            double force = std::abs(vector2signedscalar(summed[i][p].force.get_pointer(), x[i], x[j], box, fda_settings.v2s));
+            entries.push_back(ForceMatrixEntry(i, j, force));
+            entries.push_back(ForceMatrixEntry(j, i, force));
         }
     }
-    os << std::endl;
+    return ForceMatrix(syslen, entries);
+}
 
-    // Print types
+ForceMatrix DistributedForces::get_scalar_forcematrix() const
+{
+    std::vector<ForceMatrixEntry> entries;
+    entries.reserve(2 * number_of_interactions(scalar));
     for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            auto const& scalar_j = scalar_i[p];
-            os << to_index(to_compat(scalar_j.type)) << " ";
+        for (size_t p = 0; p != scalar[i].size(); ++p) {
+            int j = scalar_indices[i][p];
+            double force = std::abs(scalar[i][p].force);
+            entries.push_back(ForceMatrixEntry(i, j, force));
+            entries.push_back(ForceMatrixEntry(j, i, force));
         }
     }
-    os << std::endl;
+    return ForceMatrix(syslen, entries);
 }
 
-void DistributedForces::write_summed_compat_ascii(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const
+template <class T, class Function>
+void DistributedForces::write_compressed(std::ostream& os, std::vector<std::vector<T>> const& rows,
+    std::vector<std::vector<int>> const& row_indices, Function&& get_force) const
 {
-    // Print total number of interactions
-    int nb_interactions = 0;
-    for (auto const& s : summed) nb_interactions += s.size();
-    os << nb_interactions << std::endl;
-
-    // Print atom indices which have interactions
-    for (size_t i = 0; i != summed.size(); ++i) {
-        if (!summed[i].empty()) os << i << " ";
-    }
-    os << std::endl;
-
-    // Print indices
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        auto const& summed_indices_i = indices[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            size_t j = summed_indices_i[p];
-            os << (i > j ? j * syslen + i : i * syslen + j) << " ";
+    std::string row_section, force_section, type_section;
+    std::vector<int> order;
+    uint64_t nb_interactions = 0, nb_rows = 0, run = 0;
+    int last_i = 0;
+    InteractionType run_type = InteractionType_NONE;
+
+    for (size_t i = 0; i != rows.size(); ++i) {
+        auto const& rows_i = rows[i];
+        if (rows_i.empty()) continue;
+        auto const& indices_i = row_indices[i];
+        ++nb_rows;
+        nb_interactions += rows_i.size();
+        append_varint(row_section, i - last_i);
+        append_varint(row_section, rows_i.size());
+        last_i = i;
+
+        // Sorted j indices have small differences
+        order.resize(rows_i.size());
+        for (size_t p = 0; p != order.size(); ++p) order[p] = p;
+        std::sort(order.begin(), order.end(), [&indices_i](int p1, int p2) { return indices_i[p1] < indices_i[p2]; });
+
+        int last_j = i;
+        for (size_t k = 0; k != order.size(); ++k) {
+            int p = order[k];
+            int j = indices_i[p];
+            append_varint(row_section, k == 0 ? zigzag_encode(j - last_j) : j - last_j);
+            last_j = j;
+
+            auto force = get_force(i, j, rows_i[p]);
+            real const* components = get_components(force);
+            for (int c = 0; c != NumberOfComponents<decltype(force)>::value; ++c)
+                append_varint(force_section, zigzag_encode(std::llround(components[c] * fda_settings.compression_precision)));
+
+            if (run and rows_i[p].type == run_type) {
+                ++run;
+            } else {
+                if (run) {
+                    append_varint(type_section, run_type);
+                    append_varint(type_section, run);
+                }
+                run_type = rows_i[p].type;
+                run = 1;
+            }
         }
     }
-    os << std::endl;
-
-    // Print forces
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        auto const& summed_indices_i = indices[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            size_t j = summed_indices_i[p];
-            auto const& summed_j = summed_i[p];
-            os << vector2signedscalar(summed_j.force.get_pointer(), x[i], x[j], box, fda_settings.v2s) << " ";
-        }
+    if (run) {
+        append_varint(type_section, run_type);
+        append_varint(type_section, run);
     }
-    os << std::endl;
 
-    // Print types
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            auto const& summed_j = summed_i[p];
-            os << to_index(to_compat(summed_j.type)) << " ";
-        }
-    }
-    os << std::endl;
+    std::string header;
+    append_varint(header, nb_interactions);
+    append_varint(header, nb_rows);
+    os.write(header.data(), header.size());
+    os.write(row_section.data(), row_section.size());
+    os.write(force_section.data(), force_section.size());
+    os.write(type_section.data(), type_section.size());
 }
 
-void DistributedForces::write_scalar_compat_bin(std::ostream& os) const
+template <class T, class Function>
+void DistributedForces::write_compat(std::ostream& os, bool binary, std::vector<std::vector<T>> const& rows,
+    std::vector<std::vector<int>> const& row_indices, Function&& get_force) const
 {
-    // Print total number of interactions
-    int nb_interactions = 0;
-    for (auto const& s : scalar) nb_interactions += s.size();
-    os.write(reinterpret_cast<const char*>(&nb_interactions), sizeof(nb_interactions));
-
-    // Print atom indices which have interactions
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        if (!scalar[i].empty())
-            os.write(reinterpret_cast<const char*>(&i), sizeof(i));
-    }
-
-    // Print indices
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        auto const& scalar_indices_i = scalar_indices[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            size_t j = scalar_indices_i[p];
-            int index = i > j ? j * syslen + i : i * syslen + j;
-            os.write(reinterpret_cast<const char*>(&index), sizeof(index));
+    std::vector<int> atoms;
+    std::vector<int64_t> keys;
+    std::vector<real> forces;
+    std::vector<char> types;
+    std::vector<int> order;
+
+    // The pairs of a row are sorted by j, so that all keys of the frame are ascending
+    for (size_t i = 0; i != rows.size(); ++i) {
+        auto const& rows_i = rows[i];
+        if (rows_i.empty()) continue;
+        auto const& indices_i = row_indices[i];
+        atoms.push_back(i);
+        order.resize(rows_i.size());
+        for (size_t p = 0; p != order.size(); ++p) order[p] = p;
+        std::sort(order.begin(), order.end(), [&indices_i](int p1, int p2) { return indices_i[p1] < indices_i[p2]; });
+        for (int p : order) {
+            keys.push_back(compat_pair_key(i, indices_i[p], syslen));
+            forces.push_back(get_force(i, indices_i[p], rows_i[p]));
+            types.push_back(to_index(to_compat(rows_i[p].type)));
         }
     }
 
-    // Print forces
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            auto const& scalar_j = scalar_i[p];
-            os.write(reinterpret_cast<const char*>(&scalar_j.force), sizeof(scalar_j.force));
+    if (binary) {
+        uint64_t nb_interactions = keys.size();
+        uint64_t nb_atoms = atoms.size();
+        os.write(reinterpret_cast<const char*>(&nb_interactions), sizeof(nb_interactions));
+        os.write(reinterpret_cast<const char*>(&nb_atoms), sizeof(nb_atoms));
+        int last_atom = 0;
+        for (int atom : atoms) {
+            write_varint(os, atom - last_atom);
+            last_atom = atom;
         }
-    }
-
-    // Print types
-    for (size_t i = 0; i != scalar.size(); ++i) {
-        auto const& scalar_i = scalar[i];
-        for (size_t p = 0; p != scalar_i.size(); ++p) {
-            auto const& scalar_j = scalar_i[p];
-            auto type = to_index(to_compat(scalar_j.type));
-            os.write(reinterpret_cast<const char*>(&type), sizeof(type));
+        int64_t last_key = 0;
+        for (int64_t key : keys) {
+            write_varint(os, key - last_key);
+            last_key = key;
         }
+        os.write(reinterpret_cast<const char*>(forces.data()), forces.size() * sizeof(real));
+        os.write(types.data(), types.size());
+    } else {
+        os << keys.size() << "\n";
+        int last_atom = 0;
+        for (int atom : atoms) {
+            os << atom - last_atom << " ";
+            last_atom = atom;
+        }
+        os << "\n";
+        int64_t last_key = 0;
+        for (int64_t key : keys) {
+            os << key - last_key << " ";
+            last_key = key;
+        }
+        os << "\n";
+        for (real force : forces) os << force << " ";
+        os << "\n";
+        for (char type : types) os << static_cast<int>(type) << " ";
+        os << "\n";
     }
 }
 
-void DistributedForces::write_summed_compat_bin(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const
+void DistributedForces::write_scalar_compat(std::ostream& os, bool binary) const
 {
-    // Print total number of interactions
-    int nb_interactions = 0;
-    for (auto const& s : summed) nb_interactions += s.size();
-    os.write(reinterpret_cast<const char*>(&nb_interactions), sizeof(nb_interactions));
-
-    // Print atom indices which have interactions
-    for (size_t i = 0; i != summed.size(); ++i) {
-        if (!scalar[i].empty())
-            os.write(reinterpret_cast<const char*>(&i), sizeof(i));
-    }
-
-    // Print indices
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        auto const& summed_indices_i = indices[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            size_t j = summed_indices_i[p];
-            int index = i > j ? j * syslen + i : i * syslen + j;
-            os.write(reinterpret_cast<const char*>(&index), sizeof(index));
-        }
-    }
-
-    // Print forces
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        auto const& summed_indices_i = indices[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            size_t j = summed_indices_i[p];
-            auto const& summed_j = summed_i[p];
-            real force = vector2signedscalar(summed_j.force.get_pointer(), x[i], x[j], box, fda_settings.v2s);
-            os.write(reinterpret_cast<const char*>(&force), sizeof(force));
-        }
-    }
+    write_compat(os, binary, scalar, scalar_indices, [](int, int, Force<real> const& f) { return f.force; });
+}
 
-    // Print types
-    for (size_t i = 0; i != summed.size(); ++i) {
-        auto const& summed_i = summed[i];
-        for (size_t p = 0; p != summed_i.size(); ++p) {
-            auto const& summed_j = summed_i[p];
-            auto type = to_index(to_compat(summed_j.type));
-            os.write(reinterpret_cast<const char*>(&type), sizeof(type));
-        }
-    }
+void DistributedForces::write_summed_compat(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool binary) const
+{
+    write_compat(os, binary, summed, indices, [&](int i, int j, Force<Vector> const& f) {
+        return vector2signedscalar(f.force.get_pointer(), x[i], x[j], box, fda_settings.v2s);
+    });
 }
 
 void DistributedForces::scalar_real_divide(real divisor)
@@ -463,24 +593,30 @@ void DistributedForces::summed_merge_to_scalar(gmx::HostVector<gmx::RVec> const&
 {
     for (size_t i = 0; i != summed.size(); ++i) {
         auto & scalar_i = scalar[i];
-        auto & scalar_indices_i = scalar_indices[i];
         auto const& summed_i = summed[i];
         auto const& indices_i = indices[i];
         for (size_t p = 0; p != summed_i.size(); ++p) {
             size_t j = indices_i[p];
             auto const& summed_j = summed_i[p];
-            auto iter = std::find(scalar_indices_i.begin(), scalar_indices_i.end(), j);
             Force<real> scalar_force(vector2signedscalar(summed_j.force.get_pointer(), x[i], x[j], box, fda_settings.v2s), summed_j.type);
-            if (iter == scalar_indices_i.end()) {
-                scalar_indices_i.push_back(j);
-                scalar_i.push_back(scalar_force);
-            } else {
-                scalar_i[std::distance(scalar_indices_i.begin(), iter)] += scalar_force;
+            bool is_new;
+            int q = get_scalar_position(i, j, is_new);
+            if (is_new) scalar_i.push_back(scalar_force);
+            else scalar_i[q] += scalar_force;
+            if (fda_settings.time_averages_statistics) {
+                if (is_new) scalar_statistics[i].push_back(RunningStatistics());
+                scalar_statistics[i][q].add(scalar_force.force);
             }
         }
     }
 }
 
+void DistributedForces::summed_merge_to_total_forces_statistics(gmx::HostVector<gmx::RVec> const& x, bool normalize_psr)
+{
+    std::vector<real> total_forces = get_total_forces(x, normalize_psr);
+    for (int i = 0; i < syslen; ++i) total_forces_statistics[i].add(total_forces[i]);
+}
+
 template <class T>
 int DistributedForces::number_of_interactions(std::vector<T> const& v) const
 {
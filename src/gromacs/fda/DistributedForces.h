@@ -9,12 +9,16 @@
 #define SRC_GROMACS_FDA_DISTRIBUTEDFORCES_H_
 
 #include <vector>
+#include "BondedSlots.h"
 #include "gromacs/gpu_utils/hostallocator.h"
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/real.h"
 #include "DetailedForce.h"
 #include "FDASettings.h"
 #include "Force.h"
+#include "ForceMatrix.h"
+#include "PairIndex.h"
+#include "RunningStatistics.h"
 #include "Vector.h"
 #include "Vector2Scalar.h"
 
@@ -27,14 +31,10 @@ namespace fda {
  * Storage container for distributed forces
  * Same structure for atom and residue based distribution
  *
- * TODO: the bonded interaction type might be possible to be reduced to a
- * single real vector (=eliminate jjnr) as the atoms interacting are known
- * at simulation start and do not change (also their order in the bond list
- * doesn't change). This would however require an extra step of looking up
- * the atom indices when writing out the force matrix. This would also require
- * a change in the way the atom structure is accessed, it makes no sense to
- * keep an array of t_pf_interaction items, but only an array of reals
- * representing forces.
+ * Bonded interactions with a precomputed slot (see BondedSlots) are accumulated
+ * in flat arrays indexed by the slot. They are merged into the pair rows by
+ * merge_bonded in the order of their first occurrence, so that the output is
+ * identical to adding them directly.
  */
 class DistributedForces
 {
@@ -49,10 +49,36 @@ public:
     /// Clear scalar array
     void clear_scalar();
 
+    /// Exchange the pairs of all rows with other, used to hand a frame over to the writer thread
+    void swap_pairs(DistributedForces& other);
+
     void add_summed(int i, int j, Vector const& force, InteractionType type);
 
     void add_detailed(int i, int j, Vector const& force, PureInteractionType type);
 
+    /// Add the summed and detailed pairs of row i of other, used to reduce thread-local buffers
+    void add_row(int i, DistributedForces const& other);
+
+    /// Set the pairs of the bonded slots and allocate the flat bonded arrays
+    void set_bonded_pairs(PairList const& pairs);
+
+    /// Add bonded force of pair in slot, the force must be oriented for i < j
+    void add_bonded(int slot, Vector const& force, InteractionType type)
+    {
+        if (!bonded_is_touched[slot]) {
+            bonded_is_touched[slot] = 1;
+            bonded_touched.push_back(slot);
+            if (fda_settings.one_pair == OnePair::SUMMED) bonded_summed[slot] = Force<Vector>(force, type);
+            else bonded_detailed[slot] = DetailedForce(force, to_pure(type));
+        } else {
+            if (fda_settings.one_pair == OnePair::SUMMED) bonded_summed[slot] += Force<Vector>(force, type);
+            else bonded_detailed[slot].add(force, to_pure(type));
+        }
+    }
+
+    /// Move the bonded forces of the flat arrays into the pair rows
+    void merge_bonded();
+
     void write_detailed_vector(std::ostream& os) const;
 
     void write_detailed_scalar(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const;
@@ -65,19 +91,36 @@ public:
 
     void write_total_forces(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, bool normalize_psr = false) const;
 
-    void write_scalar_compat_ascii(std::ostream& os) const;
+    /// Write mean, variance, minimum and maximum of the scalar pairs over nframes frames,
+    /// one line per pair: i j mean variance min max type
+    void write_scalar_statistics(std::ostream& os, int nframes) const;
+
+    /// Write mean, variance, minimum and maximum of the punctual stress over nframes frames,
+    /// one line per quantity with the values of all atoms/residues
+    void write_total_forces_statistics(std::ostream& os, int nframes) const;
 
-    void write_summed_compat_ascii(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const;
+    /// Return the absolute scalar forces of the summed pairs as symmetric force matrix
+    ForceMatrix get_summed_forcematrix(gmx::HostVector<gmx::RVec> const& x, const matrix box) const;
 
-    void write_scalar_compat_bin(std::ostream& os) const;
+    /// Return the absolute scalar pairs as symmetric force matrix
+    ForceMatrix get_scalar_forcematrix() const;
 
-    void write_summed_compat_bin(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box) const;
+    /// Write scalar pairs of a frame in compat format version 2.0 (see CompatFormat.h)
+    void write_scalar_compat(std::ostream& os, bool binary) const;
+
+    /// Write summed pairs of a frame in compat format version 2.0 (see CompatFormat.h)
+    void write_summed_compat(std::ostream& os, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool binary) const;
 
     /// Divide all scalar forces by the divisor
     void scalar_real_divide(real divisor);
 
+    /// Add the scalar forces of the summed pairs to the scalar pairs,
+    /// the statistics of the scalar pairs are updated if time_averages_statistics is set
     void summed_merge_to_scalar(gmx::HostVector<gmx::RVec> const& x, const matrix box);
 
+    /// Add the punctual stress of the summed pairs to the statistics of the atoms/residues
+    void summed_merge_to_total_forces_statistics(gmx::HostVector<gmx::RVec> const& x, bool normalize_psr = false);
+
 private:
 
     friend class ::FDA;
@@ -86,6 +129,28 @@ private:
     template <class T>
     int number_of_interactions(std::vector<T> const& v) const;
 
+    /// Write the pairs of rows as compressed binary frame, see CompressedPairwiseForcesFrame.
+    /// get_force(i, j, pair) returns the force as real or Vector.
+    template <class T, class Function>
+    void write_compressed(std::ostream& os, std::vector<std::vector<T>> const& rows,
+        std::vector<std::vector<int>> const& row_indices, Function&& get_force) const;
+
+    /// Write the pairs of rows with 64-bit delta encoded keys sorted ascending,
+    /// get_force(i, j, pair) returns the scalar force
+    template <class T, class Function>
+    void write_compat(std::ostream& os, bool binary, std::vector<std::vector<T>> const& rows,
+        std::vector<std::vector<int>> const& row_indices, Function&& get_force) const;
+
+    /// Return the sum of the unsigned scalar forces of each atom/residue
+    std::vector<real> get_total_forces(gmx::HostVector<gmx::RVec> const& x, bool normalize_psr) const;
+
+    /// Return the position of pair (i,j), a new pair is appended at the end of row i,
+    /// so that the insertion order of the output is preserved
+    int get_position(int i, int j, bool& is_new);
+
+    /// Same as get_position for the scalar pairs
+    int get_scalar_position(int i, int j, bool& is_new);
+
     /// Total number of atoms/residues in the system
     int syslen;
 
@@ -95,15 +160,43 @@ private:
     /// Indices of second atom (j)
     std::vector<std::vector<int>> scalar_indices;
 
+    /// Position of second atom (j) in indices, avoiding linear search over all neighbours.
+    /// Only filled for rows with more than a few neighbours.
+    std::vector<PairIndex> positions;
+
+    /// Position of second atom (j) in scalar_indices
+    std::vector<PairIndex> scalar_positions;
+
     /// Scalar force pairs
     std::vector<std::vector<Force<real>>> scalar;
 
+    /// Statistics of the scalar force pairs, only used if time_averages_statistics is set
+    std::vector<std::vector<RunningStatistics>> scalar_statistics;
+
+    /// Statistics of the punctual stress, only used if time_averages_statistics is set
+    std::vector<RunningStatistics> total_forces_statistics;
+
     /// Summed vector force pairs
     std::vector<std::vector<Force<Vector>>> summed;
 
     /// Detailed force pairs
     std::vector<std::vector<DetailedForce>> detailed;
 
+    /// Pairs (i,j) of the bonded slots
+    PairList bonded_pairs;
+
+    /// Summed bonded forces indexed by slot
+    std::vector<Force<Vector>> bonded_summed;
+
+    /// Detailed bonded forces indexed by slot
+    std::vector<DetailedForce> bonded_detailed;
+
+    /// Non-zero if slot was used in the current frame
+    std::vector<char> bonded_is_touched;
+
+    /// Used slots in order of first occurrence, capacity is reserved for all slots
+    std::vector<int> bonded_touched;
+
     /// FDA settings
     FDASettings const& fda_settings;
 
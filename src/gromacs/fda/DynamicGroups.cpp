@@ -0,0 +1,63 @@
+#include <algorithm>
+#include "DynamicGroups.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace fda {
+
+DynamicGroups::DynamicGroups(std::string const& selection_group1, std::string const& selection_group2, gmx_mtop_t *mtop,
+    std::vector<char> const& index_group1, std::vector<char> const& index_group2)
+ : index_group1(index_group1),
+   index_group2(index_group2),
+   in_group1(index_group1),
+   in_group2(index_group2)
+{
+    selections.setReferencePosType("atom");
+    selections.setOutputPosType("atom");
+    selections.setTopology(mtop, index_group1.size());
+    selection1 = parse(selection_group1);
+    selection2 = parse(selection_group2);
+    selections.compile();
+}
+
+gmx::Selection DynamicGroups::parse(std::string const& selection_string)
+{
+    if (selection_string.empty()) return gmx::Selection();
+    gmx::SelectionList list = selections.parseFromString(selection_string);
+    if (list.size() != 1)
+        gmx_fatal(FARGS, "FDA group selection '%s' must define exactly one selection.\n", selection_string.c_str());
+    return list[0];
+}
+
+void DynamicGroups::update(const rvec *x, const matrix box, int ePBC)
+{
+    t_trxframe frame;
+    clear_trxframe(&frame, TRUE);
+    frame.natoms = in_group1.size();
+    // clear_trxframe does not reset the index, all atoms are present
+    frame.bIndex = FALSE;
+    frame.index = nullptr;
+    frame.bX = TRUE;
+    frame.x = const_cast<rvec*>(x);
+    frame.bBox = TRUE;
+    copy_mat(box, frame.box);
+
+    t_pbc pbc;
+    set_pbc(&pbc, ePBC, box);
+    selections.evaluate(&frame, ePBC != epbcNONE ? &pbc : nullptr);
+
+    set_group(selection1, index_group1, in_group1);
+    set_group(selection2, index_group2, in_group2);
+}
+
+void DynamicGroups::set_group(gmx::Selection const& selection, std::vector<char> const& index_group, std::vector<char>& in_group) const
+{
+    if (!selection.isValid()) return;
+    std::fill(in_group.begin(), in_group.end(), 0);
+    for (int a : selection.atomIndices()) in_group[a] = index_group[a];
+}
+
+} // namespace fda
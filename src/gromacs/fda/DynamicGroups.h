@@ -0,0 +1,64 @@
+#ifndef SRC_GROMACS_FDA_DYNAMICGROUPS_H_
+#define SRC_GROMACS_FDA_DYNAMICGROUPS_H_
+
+#include <string>
+#include <vector>
+#include "gromacs/math/vectypes.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectioncollection.h"
+#include "gromacs/topology/topology.h"
+
+namespace fda {
+
+/**
+ * FDA groups defined by selections, which are evaluated for each frame
+ *
+ * A dynamic group is the intersection of its index group and its selection.
+ * The index groups are kept for the whole run, so that the output layout,
+ * the pair search flags and the bonded exclusions set up from them remain valid.
+ * A group without selection is identical to its index group.
+ */
+class DynamicGroups
+{
+public:
+
+    /// mtop can be nullptr if the selections do not need a topology
+    DynamicGroups(std::string const& selection_group1, std::string const& selection_group2, gmx_mtop_t *mtop,
+                  std::vector<char> const& index_group1, std::vector<char> const& index_group2);
+
+    /// Evaluate the selections for the global coordinates of a frame
+    void update(const rvec *x, const matrix box, int ePBC);
+
+    /// Membership of the atoms in group 1 for the current frame
+    std::vector<char> const& get_in_group1() const { return in_group1; }
+
+    /// Membership of the atoms in group 2 for the current frame
+    std::vector<char> const& get_in_group2() const { return in_group2; }
+
+private:
+
+    /// Parse a single selection, an empty string gives an invalid selection
+    gmx::Selection parse(std::string const& selection_string);
+
+    /// Set the membership of the atoms in the index group which are selected
+    void set_group(gmx::Selection const& selection, std::vector<char> const& index_group, std::vector<char>& in_group) const;
+
+    gmx::SelectionCollection selections;
+
+    gmx::Selection selection1;
+
+    gmx::Selection selection2;
+
+    std::vector<char> index_group1;
+
+    std::vector<char> index_group2;
+
+    std::vector<char> in_group1;
+
+    std::vector<char> in_group2;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_DYNAMICGROUPS_H_ */
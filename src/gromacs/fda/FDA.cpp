@@ -5,14 +5,22 @@
  *      Author: Bernd Doser, HITS gGmbH <bernd.doser@h-its.org>
  */
 
+#include <cinttypes>
 #include <limits>
 #include <sstream>
+#include "config.h"
 #include "FDA.h"
+#include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/fileio/readinp.h"
+#include "gromacs/gmxlib/network.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/math/vectypes.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/topology/symtab.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 #include "Utilities.h"
@@ -37,19 +45,27 @@ static int FDA_egp_flags[FDA_GROUP_DIM2] = {
     1, 1, 1, 1
 };
 
-FDA::FDA(fda::FDASettings const& fda_settings)
+FDA::FDA(fda::FDASettings const& fda_settings, bool is_master_rank)
  : fda_settings(fda_settings),
    atom_based(fda_settings.atom_based_result_type,
               fda_settings.syslen_atoms,
               fda_settings.atom_based_result_filename,
-              fda_settings),
+              fda_settings,
+              is_master_rank),
    residue_based(fda_settings.residue_based_result_type,
                  fda_settings.syslen_residues,
                  fda_settings.residue_based_result_filename,
-                 fda_settings),
+                 fda_settings,
+                 is_master_rank),
    time_averaging_steps(0),
    time_averaging_com(nullptr),
-   nsteps(0)
+   nsteps(0),
+   nonbonded_staging(1),
+   is_master_rank(is_master_rank),
+   cr(nullptr),
+   global_atom_indices(nullptr),
+   wcycle(nullptr),
+   pair_counters(1)
 {
     if (fda_settings.time_averaging_period != 1) {
         if (residue_based.PF_or_PS_mode()) {
@@ -61,8 +77,11 @@ FDA::FDA(fda::FDASettings const& fda_settings)
 
 FDA::~FDA()
 {
+    if (!is_master_rank) return;
     atom_based.write_compat_header(nsteps);
     residue_based.write_compat_header(nsteps);
+    atom_based.write_frame_index();
+    residue_based.write_frame_index();
 }
 
 void FDA::add_bonded_nocheck(int i, int j, fda::InteractionType type, rvec force)
@@ -80,9 +99,9 @@ void FDA::add_bonded_nocheck(int i, int j, fda::InteractionType type, rvec force
                         int_swap(&ri, &rj);
                         clear_rvec(force_residue);
                         rvec_dec(force_residue, force);
-                        residue_based.distributed_forces.add_detailed(ri, rj, force_residue, to_pure(type));
+                        residue_based.get_distributed_forces().add_detailed(ri, rj, force_residue, to_pure(type));
                     } else {
-                        residue_based.distributed_forces.add_detailed(ri, rj, force, to_pure(type));
+                        residue_based.get_distributed_forces().add_detailed(ri, rj, force, to_pure(type));
                     }
                     break;
                 case fda::OnePair::SUMMED:
@@ -90,9 +109,9 @@ void FDA::add_bonded_nocheck(int i, int j, fda::InteractionType type, rvec force
                         int_swap(&ri, &rj);
                         clear_rvec(force_residue);
                         rvec_dec(force_residue, force);
-                        residue_based.distributed_forces.add_summed(ri, rj, force_residue, type);
+                        residue_based.get_distributed_forces().add_summed(ri, rj, force_residue, type);
                     } else {
-                        residue_based.distributed_forces.add_summed(ri, rj, force, type);
+                        residue_based.get_distributed_forces().add_summed(ri, rj, force, type);
                     }
                     break;
             }
@@ -106,10 +125,10 @@ void FDA::add_bonded_nocheck(int i, int j, fda::InteractionType type, rvec force
         }
         switch(fda_settings.one_pair) {
             case fda::OnePair::DETAILED:
-                atom_based.distributed_forces.add_detailed(i, j, force, to_pure(type));
+                atom_based.get_distributed_forces().add_detailed(i, j, force, to_pure(type));
                 break;
             case fda::OnePair::SUMMED:
-                atom_based.distributed_forces.add_summed(i, j, force, type);
+                atom_based.get_distributed_forces().add_summed(i, j, force, type);
                 break;
         }
     }
@@ -117,21 +136,65 @@ void FDA::add_bonded_nocheck(int i, int j, fda::InteractionType type, rvec force
 
 void FDA::add_bonded(int i, int j, fda::InteractionType type, rvec force)
 {
+    PairCounters& counters = get_pair_counters();
+    ++counters.seen;
+
     // leave early if the interaction is not interesting
     if (!(fda_settings.type & type)) return;
+    i = global_atom(i);
+    j = global_atom(j);
     if (!fda_settings.atoms_in_groups(i, j)) return;
     if (!(std::abs(force[0]) > fda_settings.threshold or
           std::abs(force[1]) > fda_settings.threshold or
           std::abs(force[2]) > fda_settings.threshold)) return;
+    ++counters.kept;
 
-    add_bonded_nocheck(i, j, type, force);
+    int slot = bonded_slots.find(i, j);
+    if (slot == fda::BondedSlots::npos) add_bonded_nocheck(i, j, type, force);
+    else add_bonded_slot(slot, i, j, type, force);
+}
+
+void FDA::set_bonded_slots(t_idef const& idef)
+{
+    bonded_slots = fda::BondedSlots(idef, fda_settings, residue_based.PF_or_PS_mode());
+    atom_based.set_bonded_pairs(bonded_slots.get_atom_pairs());
+    residue_based.set_bonded_pairs(bonded_slots.get_residue_pairs());
+}
+
+void FDA::add_bonded_slot(int slot, int i, int j, fda::InteractionType type, rvec force)
+{
+    // the slots store the pairs with the lower index first, same orientation as in add_bonded_nocheck
+    if (residue_based.PF_or_PS_mode()) {
+        int residue_slot = bonded_slots.get_residue_slot(slot);
+        if (residue_slot != fda::BondedSlots::npos) {
+            rvec force_residue;
+            if (fda_settings.get_atom2residue(i) > fda_settings.get_atom2residue(j)) {
+                clear_rvec(force_residue);
+                rvec_dec(force_residue, force);
+            } else {
+                copy_rvec(force, force_residue);
+            }
+            residue_based.get_distributed_forces().add_bonded(residue_slot, force_residue, type);
+        }
+    }
+
+    if (atom_based.PF_or_PS_mode()) {
+        if (i > j) rvec_opp(force);
+        atom_based.get_distributed_forces().add_bonded(slot, force, type);
+    }
 }
 
 void FDA::add_nonbonded_single(int i, int j, fda::InteractionType type, real force, real dx, real dy, real dz)
 {
+    PairCounters& counters = get_pair_counters();
+    ++counters.seen;
+
     // leave early if the interaction is not interesting
     if (!(fda_settings.type & type)) return;
+    i = global_atom(i);
+    j = global_atom(j);
     if (!fda_settings.atoms_in_groups(i, j)) return;
+    ++counters.kept;
 
     rvec force_v;
     force_v[0] = force * dx;
@@ -159,7 +222,13 @@ void FDA::add_nonbonded(int i, int j, real pf_coul, real pf_lj, real dx, real dy
             return;
         }
 
+    // pairs with a single interaction type are counted in add_nonbonded_single
+    PairCounters& counters = get_pair_counters();
+    ++counters.seen;
+    i = global_atom(i);
+    j = global_atom(j);
     if (!fda_settings.atoms_in_groups(i, j)) return;
+    ++counters.kept;
 
     /* checking is symmetrical for atoms i and j; one of them has to be from g1, the other one from g2
      * however, if only residue_based_result_type is non-zero, atoms won't be initialized... so the conversion to residue numebers needs to be done here already;
@@ -188,18 +257,18 @@ void FDA::add_nonbonded(int i, int j, real pf_coul, real pf_lj, real dx, real dy
                     pf_coul_residue_v[0] = pf_coul_residue * dx;
                     pf_coul_residue_v[1] = pf_coul_residue * dy;
                     pf_coul_residue_v[2] = pf_coul_residue * dz;
-                    residue_based.distributed_forces.add_detailed(ri, rj, pf_coul_residue_v, fda::PureInteractionType::COULOMB);
+                    residue_based.get_distributed_forces().add_detailed(ri, rj, pf_coul_residue_v, fda::PureInteractionType::COULOMB);
                     pf_lj_residue_v[0] = pf_lj_residue * dx;
                     pf_lj_residue_v[1] = pf_lj_residue * dy;
                     pf_lj_residue_v[2] = pf_lj_residue * dz;
-                    residue_based.distributed_forces.add_detailed(ri, rj, pf_lj_residue_v, fda::PureInteractionType::LJ);
+                    residue_based.get_distributed_forces().add_detailed(ri, rj, pf_lj_residue_v, fda::PureInteractionType::LJ);
                     break;
                 case fda::OnePair::SUMMED:
                     pf_lj_coul = pf_lj_residue + pf_coul_residue;
                     pf_coul_residue_v[0] = pf_lj_coul * dx;
                     pf_coul_residue_v[1] = pf_lj_coul * dy;
                     pf_coul_residue_v[2] = pf_lj_coul * dz;
-                    residue_based.distributed_forces.add_summed(ri, rj, pf_coul_residue_v, fda::InteractionType_COULOMB | fda::InteractionType_LJ);
+                    residue_based.get_distributed_forces().add_summed(ri, rj, pf_coul_residue_v, fda::InteractionType_COULOMB | fda::InteractionType_LJ);
                     break;
             }
         }
@@ -217,18 +286,18 @@ void FDA::add_nonbonded(int i, int j, real pf_coul, real pf_lj, real dx, real dy
                 pf_coul_atom_v[0] = pf_coul * dx;
                 pf_coul_atom_v[1] = pf_coul * dy;
                 pf_coul_atom_v[2] = pf_coul * dz;
-                atom_based.distributed_forces.add_detailed(i, j, pf_coul_atom_v, fda::PureInteractionType::COULOMB);
+                atom_based.get_distributed_forces().add_detailed(i, j, pf_coul_atom_v, fda::PureInteractionType::COULOMB);
                 pf_lj_atom_v[0] = pf_lj * dx;
                 pf_lj_atom_v[1] = pf_lj * dy;
                 pf_lj_atom_v[2] = pf_lj * dz;
-                atom_based.distributed_forces.add_detailed(i, j, pf_lj_atom_v, fda::PureInteractionType::LJ);
+                atom_based.get_distributed_forces().add_detailed(i, j, pf_lj_atom_v, fda::PureInteractionType::LJ);
                 break;
             case fda::OnePair::SUMMED:
                 pf_lj_coul = pf_lj + pf_coul;
                 pf_coul_atom_v[0] = pf_lj_coul * dx;
                 pf_coul_atom_v[1] = pf_lj_coul * dy;
                 pf_coul_atom_v[2] = pf_lj_coul * dz;
-                atom_based.distributed_forces.add_summed(i, j, pf_coul_atom_v, fda::InteractionType_COULOMB | fda::InteractionType_LJ);
+                atom_based.get_distributed_forces().add_summed(i, j, pf_coul_atom_v, fda::InteractionType_COULOMB | fda::InteractionType_LJ);
                 break;
         }
     }
@@ -349,12 +418,8 @@ void FDA::add_virial(int ai, tensor v, real s)
     // Only symmetric tensor is used, therefore full multiplication is not as efficient
     // atom_vir[ai] += s * v;
 
-    atom_based.virial_stress[ai](XX, XX) += s * v[XX][XX];
-    atom_based.virial_stress[ai](YY, YY) += s * v[YY][YY];
-    atom_based.virial_stress[ai](ZZ, ZZ) += s * v[ZZ][ZZ];
-    atom_based.virial_stress[ai](XX, YY) += s * v[XX][YY];
-    atom_based.virial_stress[ai](XX, ZZ) += s * v[XX][ZZ];
-    atom_based.virial_stress[ai](YY, ZZ) += s * v[YY][ZZ];
+    // Each thread accumulates into its own buffer, which are reduced once per frame
+    atom_based.get_virial_stress().add(global_atom(ai), v, s);
 }
 
 void FDA::add_virial_bond(int ai, int aj, real f, real dx, real dy, real dz)
@@ -409,36 +474,126 @@ void FDA::add_virial_dihedral(int i, int j, int k, int l,
     add_virial(l, v, QUARTER);
 }
 
-void FDA::save_and_write_scalar_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box, gmx_mtop_t *mtop)
+void FDA::set_number_of_threads(int nthreads)
+{
+    atom_based.set_number_of_threads(nthreads);
+    residue_based.set_number_of_threads(nthreads);
+    nonbonded_staging.resize(nthreads);
+    pair_counters.resize(nthreads);
+}
+
+void FDA::set_nbnxn_atom_order(std::vector<int> const& cellInv)
 {
+    // Padding for SIMD loads of the last j-cluster
+    size_t size = cellInv.size() + GMX_REAL_MAX_SIMD_WIDTH;
+    nbnxn_in_group1.assign(size, 0.0);
+    nbnxn_in_group2.assign(size, 0.0);
+    for (size_t i = 0; i != cellInv.size(); ++i) {
+        if (cellInv[i] < 0) continue;
+        int a = global_atom(cellInv[i]);
+        nbnxn_in_group1[i] = fda_settings.get_in_group1()[a];
+        nbnxn_in_group2[i] = fda_settings.get_in_group2()[a];
+    }
+}
+
+void FDA::update_dynamic_groups(gmx::HostVector<gmx::RVec> const& x, const matrix box, int ePBC)
+{
+    if (!fda_settings.dynamic_groups) return;
+    wallcycle_start(wcycle, ewcFDA);
+    fda_settings.dynamic_groups->update(as_rvec_array(x.data()), box, ePBC);
+    wallcycle_stop(wcycle, ewcFDA);
+}
+
+void FDA::flush_nonbonded_staging(int const* cellInv)
+{
+    fda::NonbondedStaging& staging = get_nonbonded_staging();
+    int const unrollj = staging.get_unrollj();
+    int const stride = fda::NonbondedStaging::nb_rows * unrollj;
+
+    for (int b = 0; b != staging.get_number_of_blocks(); ++b) {
+        real const* fcoul = staging.get_block(b);
+        real const* fvdw = fcoul + stride;
+        real const* dx = fvdw + stride;
+        real const* dy = dx + stride;
+        real const* dz = dy + stride;
+        int ai = staging.get_i(b);
+        int aj = staging.get_j(b);
+
+        // Same order as the former lane loop of the kernels: j-atoms outside, i-atoms inside
+        for (int j = 0; j < unrollj; ++j) {
+            for (int r = 0; r < fda::NonbondedStaging::nb_rows; ++r) {
+                int k = r * unrollj + j;
+                if (fcoul[k] != 0.0 and fvdw[k] != 0.0) {
+                    add_nonbonded(cellInv[ai + r], cellInv[aj + j], fcoul[k], fvdw[k], dx[k], dy[k], dz[k]);
+                } else if (fvdw[k] != 0.0) {
+                    add_nonbonded_single(cellInv[ai + r], cellInv[aj + j], fda::InteractionType_LJ, fvdw[k], dx[k], dy[k], dz[k]);
+                } else if (fcoul[k] != 0.0) {
+                    add_nonbonded_single(cellInv[ai + r], cellInv[aj + j], fda::InteractionType_COULOMB, fcoul[k], dx[k], dy[k], dz[k]);
+                }
+            }
+        }
+    }
+    staging.clear();
+}
+
+void FDA::save_and_write_scalar_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box)
+{
+    wallcycle_start(wcycle, ewcFDA);
+
+    wallcycle_sub_start(wcycle, ewcsFDA_REDUCE);
+    atom_based.reduce_thread_distributed_forces();
+    residue_based.reduce_thread_distributed_forces();
+
+    if (cr) {
+        reduce_rank_distributed_forces();
+        if (!is_master_rank) {
+            atom_based.distributed_forces.clear();
+            residue_based.distributed_forces.clear();
+            wallcycle_sub_stop(wcycle, ewcsFDA_REDUCE);
+            wallcycle_stop(wcycle, ewcFDA);
+            return;
+        }
+    }
+    wallcycle_sub_stop(wcycle, ewcsFDA_REDUCE);
+
     if (fda_settings.time_averaging_period != 1) {
-        if (atom_based.PF_or_PS_mode())
-            atom_based.distributed_forces.summed_merge_to_scalar(x, box);
+        if (atom_based.PF_or_PS_mode()) {
+            wallcycle_sub_start(wcycle, ewcsFDA_TIME_AVERAGES);
+            atom_based.summed_merge_to_time_averages(x, box);
+            wallcycle_sub_stop(wcycle, ewcsFDA_TIME_AVERAGES);
+        }
         if (residue_based.PF_or_PS_mode()) {
-            gmx::HostVector<gmx::RVec> com = get_residues_com(x, mtop);
-            residue_based.distributed_forces.summed_merge_to_scalar(com, box);
+            gmx::HostVector<gmx::RVec> com = get_residues_com(x);
+            wallcycle_sub_start(wcycle, ewcsFDA_TIME_AVERAGES);
+            residue_based.summed_merge_to_time_averages(com, box);
             for (int i = 0; i != fda_settings.syslen_residues; ++i) {
                 rvec_inc(time_averaging_com[i], com[i]);
             }
+            wallcycle_sub_stop(wcycle, ewcsFDA_TIME_AVERAGES);
         }
         ++time_averaging_steps;
         if (fda_settings.time_averaging_period != 0 and time_averaging_steps >= fda_settings.time_averaging_period)
             write_scalar_time_averages();
     } else {
-        write_frame(x, box, mtop);
+        write_frame(x, box);
     }
     // Clear arrays for next frame
     atom_based.distributed_forces.clear();
     residue_based.distributed_forces.clear();
+
+    wallcycle_stop(wcycle, ewcFDA);
 }
 
 void FDA::write_scalar_time_averages()
 {
-    if (time_averaging_steps == 0) return;
+    if (!is_master_rank or time_averaging_steps == 0) return;
 
+    wallcycle_sub_start(wcycle, ewcsFDA_OUTPUT);
     if (atom_based.PF_or_PS_mode()) {
         atom_based.distributed_forces.scalar_real_divide(time_averaging_steps);
-        if (atom_based.compatibility_mode())
+        if (fda_settings.time_averages_statistics)
+            atom_based.write_frame_statistics(nsteps, time_averaging_steps);
+        else if (atom_based.compatibility_mode())
             atom_based.write_frame_scalar_compat(nsteps);
         else
             atom_based.write_frame_scalar(nsteps);
@@ -450,24 +605,126 @@ void FDA::write_scalar_time_averages()
         //pf_x_real_div(time_averaging_com, fda_settings.syslen_residues, time_averaging_steps);
         for (size_t i = 0; i != residue_based.distributed_forces.scalar.size(); ++i)
             svdiv(time_averaging_steps, time_averaging_com[i]);
-        if (residue_based.compatibility_mode())
+        if (fda_settings.time_averages_statistics)
+            residue_based.write_frame_statistics(nsteps, time_averaging_steps);
+        else if (residue_based.compatibility_mode())
             residue_based.write_frame_scalar_compat(nsteps);
         else
             residue_based.write_frame_scalar(nsteps);
         residue_based.distributed_forces.clear_scalar();
         clear_rvecs(fda_settings.syslen_residues, time_averaging_com);
     }
+    wallcycle_sub_stop(wcycle, ewcsFDA_OUTPUT);
 
     time_averaging_steps = 0;
 }
 
-void FDA::write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box, gmx_mtop_t *mtop)
+void FDA::write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box)
 {
+    gmx::HostVector<gmx::RVec> com;
+    if (residue_based.PF_or_PS_mode()) com = get_residues_com(x);
+    wallcycle_sub_start(wcycle, ewcsFDA_OUTPUT);
     atom_based.write_frame(x, box, nsteps);
-    residue_based.write_frame(get_residues_com(x, mtop), box, nsteps);
+    residue_based.write_frame(com, box, nsteps);
+    wallcycle_sub_stop(wcycle, ewcsFDA_OUTPUT);
     ++nsteps;
 }
 
+void FDA::print_counters(FILE *fplog)
+{
+    int64_t counts[2] = {0, 0};
+    for (auto const& counters : pair_counters) {
+        counts[0] += counters.seen;
+        counts[1] += counters.kept;
+    }
+    if (cr) gmx_sumli(2, counts, cr);
+
+    if (!is_master_rank or !fplog) return;
+
+    fprintf(fplog, "\n Force distribution analysis:\n");
+    fprintf(fplog, " %-26s %16" PRId64 "\n", "Pairs seen", counts[0]);
+    fprintf(fplog, " %-26s %16" PRId64 "\n", "Pairs kept", counts[1]);
+    if (atom_based.PF_or_PS_mode())
+        fprintf(fplog, " %-26s %16" PRId64 "\n", "Atom-based bytes written", atom_based.get_bytes_written());
+    if (residue_based.PF_or_PS_mode())
+        fprintf(fplog, " %-26s %16" PRId64 "\n", "Residue-based bytes written", residue_based.get_bytes_written());
+    fprintf(fplog, "\n");
+}
+
+void FDA::set_cginfo_groups(int *cginfo) const
+{
+    if (!(fda_settings.type & fda::InteractionType_NONBONDED)) return;
+
+    for (int i = 0; i != fda_settings.syslen_atoms; ++i) {
+        if (fda_settings.sys_in_group1[i]) SET_CGINFO_FDA_GROUP1(cginfo[i]);
+        if (fda_settings.sys_in_group2[i]) SET_CGINFO_FDA_GROUP2(cginfo[i]);
+    }
+}
+
+void FDA::set_cginfo_groups(cginfo_mb_t *cginfo_mb, int nmolblock) const
+{
+    if (!(fda_settings.type & fda::InteractionType_NONBONDED)) return;
+
+    for (int mb = 0; mb != nmolblock; ++mb) {
+        cginfo_mb_t& block = cginfo_mb[mb];
+        // Identical molecules share the atom info, their group flags must be identical as well
+        std::vector<int> flags(block.cg_mod, -1);
+        for (int i = block.cg_start; i != block.cg_end; ++i) {
+            int k = (i - block.cg_start) % block.cg_mod;
+            int groups = 0;
+            if (fda_settings.sys_in_group1[i]) SET_CGINFO_FDA_GROUP1(groups);
+            if (fda_settings.sys_in_group2[i]) SET_CGINFO_FDA_GROUP2(groups);
+            if (flags[k] == -1) {
+                flags[k] = groups;
+                block.cginfo[k] |= groups;
+            } else if (flags[k] != groups) {
+                gmx_fatal(FARGS, "FDA groups differ between identical molecules, which is not supported with domain decomposition.\n");
+            }
+        }
+    }
+}
+
+void FDA::set_domain_decomposition(t_commrec const* cr)
+{
+#if GMX_THREAD_MPI
+    this->cr = cr;
+    global_atom_indices = &cr->dd->globalAtomIndices;
+
+    // The ranks are threads of the same process, so that the master rank can read the forces of the other ranks directly.
+    // The broadcast of the master pointer relies on this shared address space and must stay restricted to thread-MPI.
+    if (is_master_rank) ranks.resize(cr->dd->nnodes, nullptr);
+    GMX_RELEASE_ASSERT(GMX_THREAD_MPI, "The FDA master pointer can only be broadcast to thread-MPI ranks");
+    FDA *master = this;
+    gmx_bcast(sizeof(master), &master, cr);
+    master->ranks[cr->dd->rank] = this;
+    gmx_barrier(cr);
+#else
+    GMX_UNUSED_VALUE(cr);
+    gmx_fatal(FARGS, "FDA with domain decomposition is only supported with thread-MPI.\n");
+#endif
+}
+
+void FDA::reduce_rank_distributed_forces()
+{
+    // Wait until all ranks have finished the forces of this frame
+    gmx_barrier(cr);
+
+    if (is_master_rank) {
+        std::vector<FDABase<Atom>*> atom_based_ranks;
+        std::vector<FDABase<Residue>*> residue_based_ranks;
+        for (auto r : ranks) {
+            if (r == this) continue;
+            atom_based_ranks.push_back(&r->atom_based);
+            residue_based_ranks.push_back(&r->residue_based);
+        }
+        atom_based.reduce_rank_distributed_forces(atom_based_ranks);
+        residue_based.reduce_rank_distributed_forces(residue_based_ranks);
+    }
+
+    // The other ranks must not add forces before the master rank has read them
+    gmx_barrier(cr);
+}
+
 void FDA::modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec) const
 {
     if (!fda_settings.nonbonded_exclusion_on) {
@@ -514,9 +771,9 @@ void FDA::modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec)
         respect_charge_groups(mtop->groups.grpnr[egcENER],mtop);
 
         // Search FDA group names in mtop->groups (tpr-file)
-        int mtop_g1idx = add_name_to_energygrp("FDA1", &mtop->groups);
-        int mtop_g2idx = add_name_to_energygrp("FDA2", &mtop->groups);
-        int mtop_g3idx = add_name_to_energygrp("FDA12", &mtop->groups);
+        int mtop_g1idx = add_name_to_energygrp("FDA1", mtop);
+        int mtop_g2idx = add_name_to_energygrp("FDA2", mtop);
+        int mtop_g3idx = add_name_to_energygrp("FDA12", mtop);
         int mtop_rest_idx = get_index_in_energygrp("rest", &mtop->groups);
 
         #ifdef FDA_PRINT_DEBUG_ON
@@ -529,10 +786,10 @@ void FDA::modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec)
         // Lookup table energy group index to group index
         mtop->groups.grps[egcENER].nr = FDA_GROUP_DIM;
         snew(mtop->groups.grps[egcENER].nm_ind, FDA_GROUP_DIM);
-        mtop->groups.grps[egcENER].nm_ind[0] = mtop_g1idx;
-        mtop->groups.grps[egcENER].nm_ind[1] = mtop_g2idx;
-        mtop->groups.grps[egcENER].nm_ind[1] = mtop_g3idx;
-        mtop->groups.grps[egcENER].nm_ind[2] = mtop_rest_idx;
+        mtop->groups.grps[egcENER].nm_ind[FDA_GROUP_IDX_FDA1] = mtop_g1idx;
+        mtop->groups.grps[egcENER].nm_ind[FDA_GROUP_IDX_FDA2] = mtop_g2idx;
+        mtop->groups.grps[egcENER].nm_ind[FDA_GROUP_IDX_FDA12] = mtop_g3idx;
+        mtop->groups.grps[egcENER].nm_ind[FDA_GROUP_IDX_REST] = mtop_rest_idx;
 
         // Write egp_flags table
         inputrec->opts.ngener = FDA_GROUP_DIM;
@@ -614,16 +871,13 @@ void FDA::modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec)
         char buffer[15];
         for (int i = 0; i < inputrec->opts.ngener; ++i) {
             sprintf(buffer, "FDA%d", i);
-            char **tmp;
-            snew(tmp,1);
-            tmp[0] = strdup(&buffer[0]);
-            mtop->groups.grpname[i+startIdx] = tmp;
+            mtop->groups.grpname[i+startIdx] = put_symtab(&mtop->symtab, buffer);
         }
 
         // Add additional group names
         for (int i = 0; i < inputrec->opts.ngener * (FDA_GROUP_DIM - 1); ++i) {
             sprintf(buffer, "FDA%d", i + inputrec->opts.ngener);
-            add_name_to_energygrp(buffer, &mtop->groups);
+            add_name_to_energygrp(buffer, mtop);
         }
 
         // Update lookup table energy group index to group index
@@ -688,62 +942,47 @@ void FDA::modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec)
 
 }
 
-gmx::HostVector<gmx::RVec> FDA::get_residues_com(gmx::HostVector<gmx::RVec> const& x, gmx_mtop_t *mtop) const
+gmx::HostVector<gmx::RVec> FDA::get_residues_com(gmx::HostVector<gmx::RVec> const& x) const
 {
-    int mol_index, d;
-    int i, atom_index, atom_global_index, residue_global_index;
-    t_atoms *atoms;
-    t_atom *atom_info;
-    rvec r;
-
-    std::vector<real> mass(fda_settings.syslen_residues);
-    gmx::HostVector<gmx::RVec> com(fda_settings.syslen_residues);
-
-    for (i = 0; i < fda_settings.syslen_residues; i++) {
-        mass[i] = 0.0;
-        for (d = 0; d < DIM; d++)
-            com[i][d] = 0.0;
-    }
-
-    atom_global_index = 0;
-    for (auto const& mb : mtop->molblock) {
-        for (mol_index = 0; mol_index < mb.nmol; mol_index++) {
-        atoms = &mtop->moltype[mb.type].atoms;
-            for(atom_index = 0; atom_index < atoms->nr; atom_index++) {
-                if (fda_settings.atom_in_groups(atom_global_index)) {
-                    residue_global_index = fda_settings.atom_2_residue[atom_global_index];
-                    atom_info=&atoms->atom[atom_index];
-                    mass[residue_global_index] += atom_info->m;
-                    svmul(atom_info->m, x[atom_global_index], r);
-                    rvec_inc(com[residue_global_index], r);
-                }
-                atom_global_index++;
-            }
+    wallcycle_sub_start(wcycle, ewcsFDA_RESIDUE_COM);
+    gmx::HostVector<gmx::RVec> com(fda_settings.syslen_residues, gmx::RVec(0.0, 0.0, 0.0));
+
+    // Only the residues in the fda groups are visited, their atoms are stored contiguously
+    int const* atoms = fda_settings.com_atoms.data();
+    real const* masses = fda_settings.com_atom_masses.data();
+    for (size_t k = 0; k != fda_settings.com_residues.size(); ++k) {
+        real sx = 0.0, sy = 0.0, sz = 0.0;
+        for (int a = fda_settings.com_offsets[k]; a != fda_settings.com_offsets[k + 1]; ++a) {
+            gmx::RVec const& xa = x[atoms[a]];
+            sx += masses[a] * xa[XX];
+            sy += masses[a] * xa[YY];
+            sz += masses[a] * xa[ZZ];
+        }
+        // There might be residues with no mass, e.g. consisting only of virtual sites;
+        // the comparison is used only to prevent division by 0
+        real mass = fda_settings.com_residue_masses[k];
+        if (mass != 0.0) {
+            gmx::RVec& c = com[fda_settings.com_residues[k]];
+            c[XX] = sx / mass;
+            c[YY] = sy / mass;
+            c[ZZ] = sz / mass;
         }
     }
-
-    // There might be residues with no interesting atoms, so their mass would be set to the initial 0.0;
-    // float/double comparison can be tricky in general, but here it's used only to prevent division by 0
-    for (i = 0; i < fda_settings.syslen_residues; ++i) {
-        if (mass[i] != 0.0)
-            for (d = 0; d < DIM; d++)
-                com[i][d] /= mass[i];
-    }
+    wallcycle_sub_stop(wcycle, ewcsFDA_RESIDUE_COM);
 
     return com;
 }
 
-int FDA::add_name_to_energygrp(char const* name, gmx_groups_t* groups) const
+int FDA::add_name_to_energygrp(char const* name, gmx_mtop_t* mtop) const
 {
+    gmx_groups_t* groups = &mtop->groups;
     int index = groups->ngrpname;
     if (index == 255)
         gmx_fatal(FARGS, "FDA error: Limit of energy groups (256) exceeded.");
     groups->ngrpname += 1;
     srenew(groups->grpname, groups->ngrpname);
-    char **tmp1;
-    snew(tmp1,1);
-    tmp1[0] = strdup(&name[0]);
-    groups->grpname[index] = tmp1;
+    // The name must be in the symbol table to broadcast the topology to other ranks
+    groups->grpname[index] = put_symtab(&mtop->symtab, name);
     return index;
 }
 
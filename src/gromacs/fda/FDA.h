@@ -12,20 +12,29 @@
 #include "gromacs/utility/real.h"
 
 #ifdef __cplusplus
+#include <cstdint>
 #include <cstdio>
 #include <vector>
+#include "BondedSlots.h"
 #include "FDABase.h"
 #include "FDASettings.h"
 #include "gromacs/gpu_utils/hostallocator.h"
 #include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/timing/wallcycle.h"
 #include "InteractionType.h"
+#include "NonbondedStaging.h"
 #include "PureInteractionType.h"
 
+struct cginfo_mb_t;
+struct t_commrec;
+
 class FDA {
 public:
 
     /// Default constructor
-    FDA(fda::FDASettings const& fda_settings = fda::FDASettings());
+    /// Under domain decomposition only the master rank writes results,
+    /// the other ranks pass is_master_rank = false and collect forces for the master rank.
+    FDA(fda::FDASettings const& fda_settings = fda::FDASettings(), bool is_master_rank = true);
 
     /// Destructor
     /// Write compat footer
@@ -47,6 +56,9 @@ public:
 
     void add_bonded(int i, int j, fda::InteractionType type, rvec force);
 
+    /// Build the static slot table of bonded pairs from the local topology
+    void set_bonded_slots(t_idef const& idef);
+
     /**
      * Add a particular type of nonbonded interaction for the kernels where only one type of interaction is computed;
      * force is passed as scalar along with the distance vector (as dx, dy, dz) from which the vector force is
@@ -62,13 +74,32 @@ public:
      */
     void add_nonbonded(int i, int j, real pf_coul, real pf_lj, real dx, real dy, real dz);
 
+    /**
+     * Store the group membership of the atoms in nbnxn order (cellInv maps nbnxn to global atom indices, -1 for fillers),
+     * so that the SIMD kernels can load the group flags of a j-cluster into a register.
+     * Must be called before the nonbonded kernels are started.
+     */
+    void set_nbnxn_atom_order(std::vector<int> const& cellInv);
+
+    /// 1 if atom in group1, 0 otherwise, in nbnxn order and padded for SIMD loads
+    real const* get_nbnxn_in_group1() const { return nbnxn_in_group1.data(); }
+
+    /// 1 if atom in group2, 0 otherwise, in nbnxn order and padded for SIMD loads
+    real const* get_nbnxn_in_group2() const { return nbnxn_in_group2.data(); }
+
+    /// Staging buffer of the calling thread for the SIMD nonbonded kernels
+    fda::NonbondedStaging& get_nonbonded_staging() { return nonbonded_staging[gmx_omp_get_thread_num()]; }
+
+    /// Add the pairwise forces of the staging buffer of the calling thread and clear it
+    void flush_nonbonded_staging(int const* cellInv);
+
     void add_angle(int ai, int aj, int ak, rvec f_i, rvec f_j, rvec f_k);
 
     void add_dihedral(int i, int j, int k, int l, rvec f_i, rvec f_j, rvec f_k, rvec f_l);
 
     /**
      * The atom virial can be expressed as a 6-real tensor, as it's symmetric.
-     * To avoid defining a new tensor type, the 9-real tensor is used instead.
+     * The 9-real tensor is passed, only its upper triangle is stored.
      */
     void add_virial(int ai, tensor v, real s);
 
@@ -94,6 +125,19 @@ public:
      */
     void add_virial_dihedral(int i, int j, int k, int l, rvec f_i, rvec f_k, rvec f_l, rvec r_ij, rvec r_kj, rvec r_kl);
 
+    /**
+     * Evaluate the selections of the dynamic fda groups for the global coordinates of a frame.
+     * Must be called on the master rank before the forces of the frame are computed.
+     */
+    void update_dynamic_groups(gmx::HostVector<gmx::RVec> const& x, const matrix box, int ePBC);
+
+    /**
+     * Allocate thread-local force buffers, so that the nonbonded and listed-force
+     * OpenMP threads can accumulate pairwise forces without synchronization.
+     * The buffers are reduced once per frame in save_and_write_scalar_time_averages.
+     */
+    void set_number_of_threads(int nthreads);
+
     /**
      * Main function for scalar time averages; saves data and decides when to write it out
      *
@@ -102,7 +146,7 @@ public:
      * writing because for this fda->atoms would need to be initialized (to get the atom
      * number or to get the sys2ps mapping) which only happens when AtomBased is non-zero
      */
-    void save_and_write_scalar_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box, gmx_mtop_t *mtop);
+    void save_and_write_scalar_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box);
 
     /**
      * Write scalar time averages; this is similar to pf_write_frame, except that time averages are used
@@ -117,25 +161,81 @@ public:
      */
     void write_scalar_time_averages();
 
-    void write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box, gmx_mtop_t *mtop);
+    void write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box);
 
     /// Main routine for FDA exclusions
     void modify_energy_group_exclusions(gmx_mtop_t *mtop, t_inputrec *inputrec) const;
 
-    fda::FDASettings get_settings() const { return fda_settings; }
+    /**
+     * Set the FDA group flags in the atom info of the Verlet scheme (one charge group per atom),
+     * which are used by the pair search to skip cluster pairs without an atom in each group.
+     * If no nonbonded interactions are needed, no flags are set and all cluster pairs are skipped.
+     */
+    void set_cginfo_groups(int *cginfo) const;
+
+    /**
+     * Same as above for domain decomposition, the flags are set in the atom info of the molecule blocks,
+     * which is copied into the local atom info at each repartitioning.
+     */
+    void set_cginfo_groups(cginfo_mb_t *cginfo_mb, int nmolblock) const;
+
+    /**
+     * Enable domain decomposition with thread-MPI ranks, must be called by all PP ranks.
+     * The pairs are stored with the global atom indices of the local atoms.
+     * The master rank merges the pairs of all ranks at each frame, as every interaction
+     * is computed on exactly one rank each pair contribution is counted once.
+     */
+    void set_domain_decomposition(t_commrec const* cr);
+
+    fda::FDASettings const& get_settings() const { return fda_settings; }
+
+    /// Cycle counting of the FDA phases, without wallcycle no counting is done
+    void set_wallcycle(gmx_wallcycle_t wcycle) { this->wcycle = wcycle; }
+
+    /**
+     * Print the number of pairs seen and kept by the filters and the bytes written to the log file,
+     * must be called by all PP ranks, as the pair counts are summed over the ranks.
+     */
+    void print_counters(FILE *fplog);
 
 private:
 
+    /// Pair counters of a thread, padded to a cache line to avoid false sharing between the threads
+    struct PairCounters
+    {
+        PairCounters() : seen(0), kept(0) {}
+
+        /// Pairs passed to the add functions
+        int64_t seen;
+
+        /// Pairs passing the interaction type, group and threshold filters
+        int64_t kept;
+
+        char padding[64 - 2 * sizeof(int64_t)];
+    };
+
+    /// Pair counters of the calling thread
+    PairCounters& get_pair_counters() { return pair_counters[gmx_omp_get_thread_num()]; }
+
     /**
      * Computes the COM for residues in system;
      * only the atoms for which sys_in_g is non-zero are considered, such that the COM might
      * not express the COM of the whole residue but the COM of the atoms of the residue which
      * are interesting for PF
      */
-    gmx::HostVector<gmx::RVec> get_residues_com(gmx::HostVector<gmx::RVec> const& x, gmx_mtop_t *mtop) const;
+    gmx::HostVector<gmx::RVec> get_residues_com(gmx::HostVector<gmx::RVec> const& x) const;
+
+    /// Return the global index of local atom i, without domain decomposition the indices are identical
+    int global_atom(int i) const { return global_atom_indices ? (*global_atom_indices)[i] : i; }
+
+    /// Merge the pairs of all ranks on the master rank
+    void reduce_rank_distributed_forces();
+
+    /// Direct indexed add of a bonded pair with precomputed slot
+    void add_bonded_slot(int slot, int i, int j, fda::InteractionType type, rvec force);
 
     /// Append group to energy groups, returns the position index
-    int add_name_to_energygrp(char const* name, gmx_groups_t* groups) const;
+    int add_name_to_energygrp(char const* name, gmx_mtop_t* mtop) const;
 
     /// FDA groups must not be defined over complete charge groups.
     /// This group redefine the energy group array with respect to the charge groups.
@@ -156,6 +256,9 @@ private:
     /// Residue-based operation
     fda::FDABase<fda::Residue> residue_based;
 
+    /// Slot table for bonded pairs
+    fda::BondedSlots bonded_slots;
+
     /// Counter for current step, incremented for every call of pf_save_and_write_scalar_averages()
     /// When it reaches time_averages_steps, data is written
     int time_averaging_steps;
@@ -168,6 +271,30 @@ private:
     /// Incremented for each step written during run, also used to write the total number of steps at the end
     int nsteps;
 
+    /// Group flags of the atoms in nbnxn order
+    std::vector<real, gmx::AlignedAllocator<real>> nbnxn_in_group1, nbnxn_in_group2;
+
+    /// Staging buffers of the SIMD nonbonded kernels, one per thread
+    std::vector<fda::NonbondedStaging> nonbonded_staging;
+
+    /// Only the master rank writes the results
+    bool is_master_rank;
+
+    /// Communication record, only set under domain decomposition
+    t_commrec const* cr;
+
+    /// Global indices of the local atoms, only set under domain decomposition
+    std::vector<int> const* global_atom_indices;
+
+    /// FDA instances of all PP ranks indexed by DD rank, only set on the master rank
+    std::vector<FDA*> ranks;
+
+    /// Cycle counters, nullptr if not set
+    gmx_wallcycle_t wcycle;
+
+    /// Pair counters, one per thread
+    std::vector<PairCounters> pair_counters;
+
 };
 
 #else
@@ -5,10 +5,13 @@
  *      Author: Bernd Doser, HITS gGmbH <bernd.doser@h-its.org>
  */
 
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <type_traits>
 #include "FDABase.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/futil.h"
 #include "PureInteractionType.h"
 #include "Utilities.h"
@@ -16,16 +19,27 @@
 namespace fda {
 
 template <class Base>
-FDABase<Base>::FDABase(ResultType result_type, int syslen, std::string const& result_filename, FDASettings const& fda_settings)
+FDABase<Base>::FDABase(ResultType result_type, int syslen, std::string const& result_filename, FDASettings const& fda_settings,
+                       bool write_results)
  : Base(result_type == ResultType::VIRIAL_STRESS or result_type == ResultType::VIRIAL_STRESS_VON_MISES, syslen),
    result_type(result_type),
    syslen(syslen),
    distributed_forces(syslen, fda_settings),
    fda_settings(fda_settings)
 {
+    if (!write_results) return;
     result_file << std::scientific << std::setprecision(6);
     if (PF_or_PS_mode()) make_backup(result_filename.c_str());
-    if (fda_settings.binary_result_file) {
+    if (compatibility_mode()) {
+        // The compat format starts with its own header
+        result_file.open(result_filename, std::ifstream::binary);
+    } else if (fda_settings.compressed_result_file() and
+               (result_type == ResultType::PAIRWISE_FORCES_VECTOR or result_type == ResultType::PAIRWISE_FORCES_SCALAR)) {
+        result_file.open(result_filename, std::ifstream::binary);
+        char c = 'c';
+        result_file.write(&c, 1);
+        result_file.write(reinterpret_cast<const char*>(&fda_settings.compression_precision), sizeof(double));
+    } else if (fda_settings.binary_result_file) {
     	result_file.open(result_filename, std::ifstream::binary);
     	char b = 'b';
 		result_file.write(&b, 1);
@@ -37,10 +51,161 @@ FDABase<Base>::FDABase(ResultType result_type, int syslen, std::string const& re
     	result_file << result_type << std::endl;
     }
     write_compat_header(1);
+    if (result_type == ResultType::FORCE_NETWORK)
+        online_analyses = make_online_analyses(fda_settings, std::is_same<Base, Residue>::value);
+    if (PF_or_PS_mode()) writer.reset(new AsyncWriter);
+}
+
+template <class Base>
+void FDABase<Base>::set_number_of_threads(int nthreads)
+{
+    Base::set_number_of_virial_threads(nthreads);
+    thread_distributed_forces.clear();
+    if (!PF_or_PS_mode()) return;
+    thread_distributed_forces.reserve(nthreads - 1);
+    for (int t = 1; t < nthreads; ++t) {
+        thread_distributed_forces.emplace_back(syslen, distributed_forces.fda_settings);
+        thread_distributed_forces.back().set_bonded_pairs(distributed_forces.bonded_pairs);
+    }
+}
+
+template <class Base>
+void FDABase<Base>::set_bonded_pairs(PairList const& pairs)
+{
+    if (!PF_or_PS_mode()) return;
+    distributed_forces.set_bonded_pairs(pairs);
+    for (auto& t : thread_distributed_forces) t.set_bonded_pairs(pairs);
+}
+
+template <class Base>
+void FDABase<Base>::reduce_thread_distributed_forces()
+{
+    Base::reduce_thread_virial_stress();
+    distributed_forces.merge_bonded();
+    if (thread_distributed_forces.empty()) return;
+
+    int nthreads = thread_distributed_forces.size() + 1;
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int t = 0; t < nthreads - 1; ++t) {
+        try {
+            thread_distributed_forces[t].merge_bonded();
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int i = 0; i < syslen; ++i) {
+        try {
+            for (auto& t : thread_distributed_forces) {
+                distributed_forces.add_row(i, t);
+                t.indices[i].clear();
+                t.positions[i].clear();
+                t.summed[i].clear();
+                t.detailed[i].clear();
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+}
+
+template <class Base>
+void FDABase<Base>::reduce_rank_distributed_forces(std::vector<FDABase*> const& ranks)
+{
+    if (ranks.empty()) return;
+
+    int nthreads = thread_distributed_forces.size() + 1;
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int i = 0; i < syslen; ++i) {
+        try {
+            for (auto r : ranks) {
+                distributed_forces.add_row(i, r->distributed_forces);
+                r->distributed_forces.indices[i].clear();
+                r->distributed_forces.positions[i].clear();
+                r->distributed_forces.summed[i].clear();
+                r->distributed_forces.detailed[i].clear();
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    for (auto r : ranks) Base::reduce_virial_stress(*r);
+}
+
+template <class Base>
+void FDABase<Base>::summed_merge_to_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box)
+{
+    if (result_type == ResultType::PUNCTUAL_STRESS)
+        distributed_forces.summed_merge_to_total_forces_statistics(x, std::is_same<Base, Residue>::value and fda_settings.normalize_psr);
+    else
+        distributed_forces.summed_merge_to_scalar(x, box);
 }
 
 template <class Base>
 void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps)
+{
+    if (!writer) {
+        write_frame(distributed_forces, x, box, nsteps);
+        return;
+    }
+    auto x_copy = std::make_shared<gmx::HostVector<gmx::RVec>>(x);
+    matrix box_copy;
+    copy_mat(box, box_copy);
+    write_async([this, x_copy, box_copy, nsteps](DistributedForces const& forces) {
+        write_frame(forces, *x_copy, box_copy, nsteps);
+    });
+}
+
+template <class Base>
+void FDABase<Base>::write_frame_scalar(int nsteps)
+{
+    if (!writer) {
+        write_frame_scalar(distributed_forces, nsteps);
+        return;
+    }
+    write_async([this, nsteps](DistributedForces const& forces) {
+        write_frame_scalar(forces, nsteps);
+    });
+}
+
+template <class Base>
+void FDABase<Base>::write_frame_statistics(int nsteps, int nframes)
+{
+    if (!writer) {
+        write_frame_statistics(distributed_forces, nsteps, nframes);
+        return;
+    }
+    write_async([this, nsteps, nframes](DistributedForces const& forces) {
+        write_frame_statistics(forces, nsteps, nframes);
+    });
+}
+
+template <class Base>
+void FDABase<Base>::write_async(std::function<void(DistributedForces const&)> task)
+{
+    std::shared_ptr<DistributedForces> buffer;
+    {
+        std::lock_guard<std::mutex> lock(free_buffers_mutex);
+        if (!free_buffers.empty()) {
+            buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+    }
+    if (!buffer) buffer = std::make_shared<DistributedForces>(syslen, fda_settings);
+    buffer->swap_pairs(distributed_forces);
+
+    writer->push([this, buffer, task]() {
+        task(*buffer);
+        // Flush once per frame instead of per line
+        result_file.flush();
+        buffer->clear();
+        buffer->clear_scalar();
+        std::lock_guard<std::mutex> lock(free_buffers_mutex);
+        free_buffers.push_back(buffer);
+    });
+}
+
+template <class Base>
+void FDABase<Base>::write_frame(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps)
 {
     switch (fda_settings.one_pair) {
         case OnePair::DETAILED:
@@ -49,10 +214,10 @@ void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matri
                     // do nothing
                     break;
                 case ResultType::PAIRWISE_FORCES_VECTOR:
-                    write_frame_detailed(x, box, true, nsteps);
+                    write_frame_detailed(forces, x, box, true, nsteps);
                     break;
                 case ResultType::PAIRWISE_FORCES_SCALAR:
-                    write_frame_detailed(x, box, false, nsteps);
+                    write_frame_detailed(forces, x, box, false, nsteps);
                     break;
                 case ResultType::PUNCTUAL_STRESS:
                     gmx_fatal(FARGS, "Punctual stress is not supported for detailed output.\n");
@@ -69,6 +234,9 @@ void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matri
                 case ResultType::COMPAT_ASCII:
                     gmx_fatal(FARGS, "Compatibility ascii mode is not supported for detailed output.\n");
                     break;
+                case ResultType::FORCE_NETWORK:
+                    gmx_fatal(FARGS, "Force network analysis is not supported for detailed output.\n");
+                    break;
             }
             break;
         case OnePair::SUMMED:
@@ -77,13 +245,13 @@ void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matri
                     // do nothing
                     break;
                 case ResultType::PAIRWISE_FORCES_VECTOR:
-                    write_frame_summed(x, box, true, nsteps);
+                    write_frame_summed(forces, x, box, true, nsteps);
                     break;
                 case ResultType::PAIRWISE_FORCES_SCALAR:
-                    write_frame_summed(x, box, false, nsteps);
+                    write_frame_summed(forces, x, box, false, nsteps);
                     break;
                 case ResultType::PUNCTUAL_STRESS:
-                    write_total_forces(x);
+                    write_total_forces(forces, x);
                     break;
                 case ResultType::VIRIAL_STRESS:
                     write_virial_sum();
@@ -92,10 +260,11 @@ void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matri
                     write_virial_sum_von_mises();
                     break;
                 case ResultType::COMPAT_BIN:
-                    gmx_fatal(FARGS, "Compatibility binary mode is not supported for summed output.\n");
-                    break;
                 case ResultType::COMPAT_ASCII:
-                    write_frame_summed_compat(x, box, nsteps);
+                    write_frame_summed_compat(forces, x, box, nsteps);
+                    break;
+                case ResultType::FORCE_NETWORK:
+                    write_force_network(forces.get_summed_forcematrix(x, box), nsteps);
                     break;
             }
             break;
@@ -103,48 +272,70 @@ void FDABase<Base>::write_frame(gmx::HostVector<gmx::RVec> const& x, const matri
 }
 
 template <class Base>
-void FDABase<Base>::write_frame_detailed(gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps)
+void FDABase<Base>::write_frame_detailed(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps)
 {
 	write_frame_number(nsteps);
     if (print_vector)
-        distributed_forces.write_detailed_vector(result_file);
+        forces.write_detailed_vector(result_file);
     else
-        distributed_forces.write_detailed_scalar(result_file, x, box);
+        forces.write_detailed_scalar(result_file, x, box);
 }
 
 template <class Base>
-void FDABase<Base>::write_frame_summed(gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps)
+void FDABase<Base>::write_frame_summed(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps)
 {
 	write_frame_number(nsteps);
     if (print_vector)
-        distributed_forces.write_summed_vector(result_file);
+        forces.write_summed_vector(result_file);
     else
-        distributed_forces.write_summed_scalar(result_file, x, box);
+        forces.write_summed_scalar(result_file, x, box);
 }
 
 template <class Base>
-void FDABase<Base>::write_frame_scalar(int nsteps)
+void FDABase<Base>::write_frame_scalar(DistributedForces const& forces, int nsteps)
+{
+    if (result_type == ResultType::FORCE_NETWORK) {
+        write_force_network(forces.get_scalar_forcematrix(), nsteps);
+        return;
+    }
+	write_frame_number(nsteps);
+    forces.write_scalar(result_file);
+}
+
+template <class Base>
+void FDABase<Base>::write_frame_statistics(DistributedForces const& forces, int nsteps, int nframes)
 {
 	write_frame_number(nsteps);
-    distributed_forces.write_scalar(result_file);
+    if (result_type == ResultType::PUNCTUAL_STRESS)
+        forces.write_total_forces_statistics(result_file, nframes);
+    else
+        forces.write_scalar_statistics(result_file, nframes);
 }
 
 template <>
-void FDABase<Atom>::write_total_forces(gmx::HostVector<gmx::RVec> const& x)
+void FDABase<Atom>::write_total_forces(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x)
 {
-    distributed_forces.write_total_forces(result_file, x);
+    if (fda_settings.binary_result_file) frame_index.add(result_file.tellp());
+    forces.write_total_forces(result_file, x);
 }
 
 template <>
-void FDABase<Residue>::write_total_forces(gmx::HostVector<gmx::RVec> const& x)
+void FDABase<Residue>::write_total_forces(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x)
 {
-    distributed_forces.write_total_forces(result_file, x, fda_settings.normalize_psr);
+    if (fda_settings.binary_result_file) frame_index.add(result_file.tellp());
+    forces.write_total_forces(result_file, x, fda_settings.normalize_psr);
 }
 
 template <class Base>
 void FDABase<Base>::write_compat_header(int nsteps)
 {
-    if (!PF_or_PS_mode() or !compatibility_mode()) return;
+    if (!PF_or_PS_mode() or !compatibility_mode() or !result_file.is_open()) return;
+
+    // The header is written again at the end with the final number of steps,
+    // which has a fixed width, so that the header can be overwritten in place.
+    // The stream position is only valid after the pending frames are written.
+    wait_for_writer();
+    if (result_file.tellp() > 0) result_file.seekp(0);
 
     result_file << "<begin_block>" << std::endl;
     result_file << "; Forcemat version " << FDASettings::compat_fm_version << std::endl;
@@ -159,6 +350,8 @@ void FDABase<Base>::write_compat_header(int nsteps)
     result_file << "fmdim=" << syslen << std::endl;
     result_file << "intsize=" << sizeof(int) << std::endl;
     result_file << "realsize=" << sizeof(real) << std::endl;
+    result_file << "keysize=" << sizeof(int64_t) << std::endl;
+    result_file << "keyencoding=delta" << std::endl;
     result_file << "<end_block>" << std::endl;
 }
 
@@ -168,37 +361,36 @@ void FDABase<Base>::write_frame_scalar_compat(int nsteps)
     if (result_type == ResultType::COMPAT_ASCII) {
         result_file << "<begin_block>" << std::endl;
         result_file << nsteps << std::endl;
-        distributed_forces.write_scalar_compat_ascii(result_file);
+        distributed_forces.write_scalar_compat(result_file, false);
         result_file << "<end_block>" << std::endl;
     } else {
         result_file.write(reinterpret_cast<const char *>(&nsteps), sizeof(nsteps));
-        distributed_forces.write_scalar_compat_bin(result_file);
+        distributed_forces.write_scalar_compat(result_file, true);
     }
 }
 
 template <class Base>
-void FDABase<Base>::write_frame_summed_compat(gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps)
+void FDABase<Base>::write_frame_summed_compat(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps)
 {
     if (result_type == ResultType::COMPAT_ASCII) {
         result_file << "<begin_block>" << std::endl;
         result_file << nsteps << std::endl;
-        distributed_forces.write_summed_compat_ascii(result_file, x, box);
+        forces.write_summed_compat(result_file, x, box, false);
         result_file << "<end_block>" << std::endl;
     } else {
         result_file.write(reinterpret_cast<const char *>(&nsteps), sizeof(nsteps));
-        distributed_forces.write_summed_compat_bin(result_file, x, box);
+        forces.write_summed_compat(result_file, x, box, true);
     }
 }
 
 template <>
 void FDABase<Atom>::write_virial_sum()
 {
-    bool first = true;
-    for (auto const& v : virial_stress) {
-        if (!first) result_file << " ";
-        else first = false;
-        result_file << -v(XX, XX) << " " << -v(YY, YY) << " " << -v(ZZ, ZZ) << " "
-                    << -v(XX, YY) << " " << -v(XX, ZZ) << " " << -v(YY, ZZ);
+    VirialStress const& v = virial_stress;
+    for (int i = 0; i != v.size(); ++i) {
+        if (i) result_file << " ";
+        result_file << -v.xx[i] << " " << -v.yy[i] << " " << -v.zz[i] << " "
+                    << -v.xy[i] << " " << -v.xz[i] << " " << -v.yz[i];
     }
     result_file << std::endl;
 }
@@ -210,11 +402,10 @@ void FDABase<Residue>::write_virial_sum()
 template <>
 void FDABase<Atom>::write_virial_sum_von_mises()
 {
-    bool first = true;
-    for (auto const& v : virial_stress) {
-        if (!first) result_file << " ";
-        else first = false;
-        result_file << tensor_to_vonmises(v);
+    std::vector<real> von_mises = virial_stress.von_mises();
+    for (size_t i = 0; i != von_mises.size(); ++i) {
+        if (i) result_file << " ";
+        result_file << von_mises[i];
     }
     result_file << std::endl;
 }
@@ -223,10 +414,37 @@ template <>
 void FDABase<Residue>::write_virial_sum_von_mises()
 {}
 
+template <class Base>
+void FDABase<Base>::write_frame_index()
+{
+    wait_for_writer();
+    if (!fda_settings.binary_result_file or !PF_or_PS_mode() or compatibility_mode()) return;
+    frame_index.set_end_of_frames(result_file.tellp());
+    frame_index.write(result_file);
+    result_file.flush();
+}
+
+template <class Base>
+int64_t FDABase<Base>::get_bytes_written()
+{
+    wait_for_writer();
+    if (!result_file.is_open()) return 0;
+    std::streamoff pos = result_file.tellp();
+    return pos < 0 ? 0 : static_cast<int64_t>(pos);
+}
+
 template <class Base>
 void FDABase<Base>::write_frame_number(int nsteps)
 {
-	if (!fda_settings.binary_result_file) result_file << "frame " << nsteps << std::endl;
+	if (fda_settings.binary_result_file) frame_index.add(result_file.tellp());
+	else result_file << "frame " << nsteps << "\n";
+}
+
+template <class Base>
+void FDABase<Base>::write_force_network(ForceMatrix const& forces, int nsteps)
+{
+    write_frame_number(nsteps);
+    for (auto const& analysis : online_analyses) analysis->analyse(forces, result_file);
 }
 
 /// template instantiation
@@ -9,18 +9,26 @@
 #define SRC_GROMACS_FDA_FDABASE_H_
 
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "AsyncWriter.h"
 #include "FDASettings.h"
 #include "DistributedForces.h"
+#include "FrameIndex.h"
 #include "gromacs/gpu_utils/hostallocator.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "OnePair.h"
+#include "OnlineAnalysis.h"
 #include "ResultType.h"
-#include "Tensor.h"
 #include "Vector2Scalar.h"
+#include "VirialStress.h"
 
 /// Forwarding needed for friend declaration
 class FDA;
@@ -35,14 +43,53 @@ struct Atom
      : virial_stress(VS_mode ? syslen : 0)
     {}
 
+    /// Allocate the thread-local virial stress for OpenMP threads 1 to nthreads-1,
+    /// thread 0 accumulates directly into @virial_stress
+    void set_number_of_virial_threads(int nthreads)
+    {
+        thread_virial_stress.clear();
+        if (virial_stress.size() == 0) return;
+        thread_virial_stress.resize(nthreads - 1, VirialStress(virial_stress.size()));
+    }
+
+    /// Return the virial stress of the calling OpenMP thread
+    VirialStress& get_virial_stress()
+    {
+        int thread = gmx_omp_get_thread_num();
+        if (thread == 0) return virial_stress;
+        GMX_ASSERT(thread <= static_cast<int>(thread_virial_stress.size()), "FDA thread virial stress not allocated");
+        return thread_virial_stress[thread - 1];
+    }
+
+    /// Add the thread-local virial stress to @virial_stress and clear them
+    void reduce_thread_virial_stress()
+    {
+        for (auto& t : thread_virial_stress) virial_stress.reduce(t);
+    }
+
+    /// Add the virial stress of other and clear it
+    void reduce_virial_stress(Atom& other)
+    {
+        virial_stress.reduce(other.virial_stress);
+    }
+
     /// Virial stress
-    std::vector<Tensor> virial_stress;
+    VirialStress virial_stress;
+
+    /// Thread-local virial stress of OpenMP threads 1 to nthreads-1
+    std::vector<VirialStress> thread_virial_stress;
 };
 
 /// Type for residue-based forces
 struct Residue
 {
     Residue(bool, int) {}
+
+    void set_number_of_virial_threads(int) {}
+
+    void reduce_thread_virial_stress() {}
+
+    void reduce_virial_stress(Residue&) {}
 };
 
 /**
@@ -56,7 +103,10 @@ class FDABase : Base
 {
 public:
 
-    FDABase(ResultType result_type, int syslen, std::string const& result_filename, FDASettings const& fda_settings);
+    /// The result file is only opened if write_results is true,
+    /// otherwise the forces are collected for the master rank
+    FDABase(ResultType result_type, int syslen, std::string const& result_filename, FDASettings const& fda_settings,
+            bool write_results = true);
 
     bool compatibility_mode() const {
         return result_type == ResultType::COMPAT_BIN or
@@ -72,7 +122,9 @@ public:
     bool PF_or_PS_mode() const {
         return result_type == ResultType::PAIRWISE_FORCES_VECTOR or
                result_type == ResultType::PAIRWISE_FORCES_SCALAR or
-               result_type == ResultType::PUNCTUAL_STRESS;
+               result_type == ResultType::PUNCTUAL_STRESS or
+               compatibility_mode() or
+               result_type == ResultType::FORCE_NETWORK;
     }
 
     bool VS_mode() const {
@@ -80,15 +132,44 @@ public:
                result_type == ResultType::VIRIAL_STRESS_VON_MISES;
     }
 
-    void write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps);
+    /// Allocate the thread-local force buffers for OpenMP threads 1 to nthreads-1,
+    /// thread 0 accumulates directly into @distributed_forces
+    void set_number_of_threads(int nthreads);
+
+    /// Return the force storage of the calling OpenMP thread
+    DistributedForces& get_distributed_forces()
+    {
+        int thread = gmx_omp_get_thread_num();
+        if (thread == 0) return distributed_forces;
+        GMX_ASSERT(thread <= static_cast<int>(thread_distributed_forces.size()), "FDA thread buffer not allocated");
+        return thread_distributed_forces[thread - 1];
+    }
+
+    /// Set the pairs of the bonded slots for all force buffers
+    void set_bonded_pairs(PairList const& pairs);
+
+    /// Merge the bonded slots into the pair rows and the thread-local force buffers
+    /// into @distributed_forces and clear them.
+    /// The threads are merged in ascending order, so that the result is reproducible.
+    void reduce_thread_distributed_forces();
 
-    void write_frame_detailed(gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps);
+    /// Add the pairs and the virial stress of the other ranks to this instance and clear them.
+    /// Used under domain decomposition, the ranks must not compute forces meanwhile.
+    void reduce_rank_distributed_forces(std::vector<FDABase*> const& ranks);
 
-    void write_frame_summed(gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps);
+    /// Add the current frame to the time averages, the punctual stress is only averaged with time_averages_statistics
+    void summed_merge_to_time_averages(gmx::HostVector<gmx::RVec> const& x, const matrix box);
 
+    /// Write the pairs of the current frame.
+    /// Pairwise forces and punctual stress are handed over to the writer thread and
+    /// @distributed_forces is left empty, so that the next frame can be computed while writing.
+    void write_frame(gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps);
+
+    /// Write the time averaged scalar pairs, handed over to the writer thread like write_frame
     void write_frame_scalar(int nsteps);
 
-    void write_total_forces(gmx::HostVector<gmx::RVec> const& x);
+    /// Write the statistics of the time averaging period over nframes frames, handed over to the writer thread like write_frame
+    void write_frame_statistics(int nsteps, int nframes);
 
     /**
      * Writes a header as in original PF implementation;
@@ -102,29 +183,46 @@ public:
 
     void write_frame_scalar_compat(int nsteps);
 
-    void write_frame_summed_compat(gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps);
-
     /// The stress is the negative atom_vir value.
     void write_virial_sum();
 
     /// For von Mises no negative values are needed, since all items are squared.
     void write_virial_sum_von_mises();
 
+    /// Append the frame index to binary pairwise force and punctual stress files
+    void write_frame_index();
+
+    /// Block until all frames are written
+    void wait_for_writer() { if (writer) writer->wait(); }
+
+    /// Number of bytes written into the result file, after all queued frames are written
+    int64_t get_bytes_written();
+
 private:
 
     friend class ::FDA;
 
+    void write_frame(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps);
+
+    void write_frame_detailed(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps);
+
+    void write_frame_summed(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, bool print_vector, int nsteps);
+
+    void write_frame_scalar(DistributedForces const& forces, int nsteps);
+
+    void write_frame_statistics(DistributedForces const& forces, int nsteps, int nframes);
+
+    void write_total_forces(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x);
+
+    void write_frame_summed_compat(DistributedForces const& forces, gmx::HostVector<gmx::RVec> const& x, const matrix box, int nsteps);
+
     void write_frame_number(int nsteps);
 
-    /// Convert a tensor to von Mises scalar value
-    real tensor_to_vonmises(Tensor t) const
-    {
-        real txy = t(XX, XX)-t(YY, YY);
-        real tyz = t(YY, YY)-t(ZZ, ZZ);
-        real tzx = t(ZZ, ZZ)-t(XX, XX);
-        return std::sqrt(0.5 * (txy*txy + tyz*tyz + tzx*tzx
-                         + 6 * (t(XX, YY)*t(XX, YY) + t(XX, ZZ)*t(XX, ZZ) + t(YY, ZZ)*t(YY, ZZ))));
-    }
+    /// Run the online analyses on the force matrix of a frame and write their results
+    void write_force_network(ForceMatrix const& forces, int nsteps);
+
+    /// Move the pairs of @distributed_forces into a free buffer and queue task(buffer) for the writer thread
+    void write_async(std::function<void(DistributedForces const&)> task);
 
     /// Result type
     ResultType result_type;
@@ -135,12 +233,30 @@ private:
     /// Distributed forces
     DistributedForces distributed_forces;
 
+    /// Thread-local distributed forces of OpenMP threads 1 to nthreads-1
+    std::vector<DistributedForces> thread_distributed_forces;
+
     /// Result file
     std::ofstream result_file;
 
     /// For atom/residue unrelated settings
     FDASettings fda_settings;
 
+    /// Online analyses of the force network mode
+    std::vector<std::unique_ptr<OnlineAnalysis>> online_analyses;
+
+    /// Offsets of the frames written into a binary result file
+    FrameIndex frame_index;
+
+    /// Cleared buffers for the frames handed over to the writer thread
+    std::vector<std::shared_ptr<DistributedForces>> free_buffers;
+
+    /// Protects @free_buffers, which are returned by the writer thread
+    std::mutex free_buffers_mutex;
+
+    /// Writer thread for pairwise forces and punctual stress, declared last to be stopped first
+    std::unique_ptr<AsyncWriter> writer;
+
 };
 
 } // namespace fda
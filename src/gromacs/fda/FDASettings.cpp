@@ -7,6 +7,7 @@
 
 #include <set>
 #include <sstream>
+#include "config.h"
 #include "FDASettings.h"
 #include "gromacs/fileio/readinp.h"
 #include "gromacs/fileio/warninp.h"
@@ -18,7 +19,7 @@
 
 using namespace fda;
 
-const std::string FDASettings::compat_fm_version = "1.5";
+const std::string FDASettings::compat_fm_version = "2.0";
 
 const int FDASettings::compat_new_entry = -280480;
 
@@ -32,6 +33,7 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
    syslen_atoms(mtop->natoms),
    syslen_residues(0),
    time_averaging_period(1),
+   time_averages_statistics(false),
    sys_in_group1(syslen_atoms, 0),
    sys_in_group2(syslen_atoms, 0),
    type(InteractionType_NONE),
@@ -44,9 +46,14 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
    normalize_psr(false),
    ignore_missing_potentials(false)
 {
-    /// Parallel execution not implemented yet
+    /// Multiple ranks are only supported with thread-MPI, where the master rank merges the forces of all ranks
+#if !GMX_THREAD_MPI
     if (parallel_execution)
-        gmx_fatal(FARGS, "FDA parallel execution not implemented yet! Please start with '-nt 1' on the mdrun command line\n");
+        gmx_fatal(FARGS, "FDA execution with multiple MPI ranks is not supported, please use thread-MPI (-ntmpi) "
+                         "or OpenMP threads (-ntomp).\n");
+#else
+    GMX_UNUSED_VALUE(parallel_execution);
+#endif
 
     // check for the pf configuration file (specified with -pfi option);
     // if it doesn't exist, return NULL to specify that no pf handling is done;
@@ -147,6 +154,9 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
     for (auto&& res : atom_2_residue) ++residue_size[res];
 
     // Set sys_in_group arrays
+    if (PF_or_PS_mode(atom_based_result_type)) sys2pf_atoms.assign(syslen_atoms, -1);
+    if (PF_or_PS_mode(residue_based_result_type)) sys2pf_residues.assign(syslen_residues, -1);
+    int npf_atoms = 0, npf_residues = 0;
     for (int i = 0; i != groups->nr; ++i) {
         std::vector<int> group_atoms;
         if (group_names[i] == name_group1) {
@@ -158,30 +168,58 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
             for (auto g : group_atoms) sys_in_group2[g] = 1;
         }
         if (PF_or_PS_mode(atom_based_result_type)) {
-            for (auto g : group_atoms) sys2pf_atoms[g] = sys2pf_atoms.size();
+            for (auto g : group_atoms) if (sys2pf_atoms[g] == -1) sys2pf_atoms[g] = npf_atoms++;
         }
         if (PF_or_PS_mode(residue_based_result_type)) {
             std::vector<int> group_residues = groupatoms2residues(group_atoms);
-            for (auto g : group_residues) sys2pf_residues[g] = sys2pf_residues.size();
+            for (auto g : group_residues) if (sys2pf_residues[g] == -1) sys2pf_residues[g] = npf_residues++;
         }
     }
 
+    if (PF_or_PS_mode(residue_based_result_type)) fill_residue_com_tables(mtop);
+
+    // Dynamic groups are selected within the index groups for each frame
+    std::string selection_group1 = get_estr(&inp, "group1_selection", "");
+    std::string selection_group2 = get_estr(&inp, "group2_selection", "");
+    if (!selection_group1.empty() or !selection_group2.empty()) {
+        if (compatibility_mode(atom_based_result_type) or compatibility_mode(residue_based_result_type))
+            gmx_fatal(FARGS, "Dynamic groups are not supported in compat mode.\n");
+        if (!selection_group1.empty()) std::cout << "Dynamic group1: " << selection_group1 << std::endl;
+        if (!selection_group2.empty()) std::cout << "Dynamic group2: " << selection_group2 << std::endl;
+        dynamic_groups = std::make_shared<DynamicGroups>(selection_group1, selection_group2, mtop, sys_in_group1, sys_in_group2);
+    }
+
     // Read time averaging period
     time_averaging_period = get_eint(&inp, "time_averages_period", 1, wi);
     if (time_averaging_period < 0)
         gmx_fatal(FARGS, "Invalid value for time_averages_period: %d\n", time_averaging_period);
 
+    // Read time averaging statistics
+    time_averages_statistics = strcasecmp(get_estr(&inp, "time_averages_statistics", "no"), "no");
+    if (time_averages_statistics) {
+        if (time_averaging_period == 1)
+            gmx_fatal(FARGS, "Time averaging statistics need a time_averages_period different from 1.\n");
+        for (auto r : {atom_based_result_type, residue_based_result_type}) {
+            if (r != ResultType::NO and r != ResultType::PAIRWISE_FORCES_SCALAR and r != ResultType::PUNCTUAL_STRESS)
+                gmx_fatal(FARGS, "Time averaging statistics are only supported for scalar pairwise forces and punctual stress.\n");
+        }
+        std::cout << "Time averaging statistics: " << time_averages_statistics << std::endl;
+    }
+
     // Check for valid input options using time averaging
     if (time_averaging_period != 1) {
         if (one_pair != OnePair::SUMMED)
             gmx_fatal(FARGS, "Can only save scalar time averages from summed interactions.\n");
-        if (PF_or_PS_mode(atom_based_result_type)) {
-            if (!(compatibility_mode(atom_based_result_type) or atom_based_result_type == ResultType::PAIRWISE_FORCES_SCALAR))
-                gmx_fatal(FARGS, "Can only use time averages with scalar or compatibility output.\n");
+        // Statistics are checked above
+        if (PF_or_PS_mode(atom_based_result_type) and !time_averages_statistics) {
+            if (!(compatibility_mode(atom_based_result_type) or atom_based_result_type == ResultType::PAIRWISE_FORCES_SCALAR or
+                  atom_based_result_type == ResultType::FORCE_NETWORK))
+                gmx_fatal(FARGS, "Can only use time averages with scalar, compatibility or force network output.\n");
         }
-        if (PF_or_PS_mode(residue_based_result_type)) {
-            if (!(compatibility_mode(residue_based_result_type) or residue_based_result_type == ResultType::PAIRWISE_FORCES_SCALAR))
-                gmx_fatal(FARGS, "Can only use time averages with scalar or compatibility output.\n");
+        if (PF_or_PS_mode(residue_based_result_type) and !time_averages_statistics) {
+            if (!(compatibility_mode(residue_based_result_type) or residue_based_result_type == ResultType::PAIRWISE_FORCES_SCALAR or
+                  residue_based_result_type == ResultType::FORCE_NETWORK))
+                gmx_fatal(FARGS, "Can only use time averages with scalar, compatibility or force network output.\n");
         }
     }
 
@@ -235,6 +273,18 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
     // Binary result file
     binary_result_file = strcasecmp(get_estr(&inp, "binary_result_file", "no"), "no");
     std::cout << "Binary mode: " << binary_result_file << std::endl;
+    if (binary_result_file and time_averages_statistics)
+        gmx_fatal(FARGS, "Time averaging statistics are only written in text format.\n");
+
+    // Precision of compressed pairwise forces in binary result files
+    compression_precision = get_ereal(&inp, "compression_precision", 0.0, wi);
+    if (compression_precision < 0.0)
+        gmx_fatal(FARGS, "Invalid value for compression_precision: %f\n", compression_precision);
+    if (compression_precision > 0.0 and !binary_result_file)
+        gmx_fatal(FARGS, "Compression is only supported for binary result files.\n");
+    if (compression_precision > 0.0 and one_pair != OnePair::SUMMED)
+        gmx_fatal(FARGS, "Compression is only supported for summed interactions.\n");
+    std::cout << "Compression precision: " << compression_precision << std::endl;
 
     // Read threshold
     threshold = get_ereal(&inp, "threshold", 1e-10, wi);
@@ -249,6 +299,32 @@ FDASettings::FDASettings(int nfile, const t_filenm fnm[], gmx_mtop_t *mtop, bool
     // Ignore missing potentials
     ignore_missing_potentials = strcasecmp(get_estr(&inp, "ignore_missing_potentials", "no"), "no");
     std::cout << "Ignore missing potentials: " << ignore_missing_potentials << std::endl;
+
+    // Online force network analysis
+    network_threshold = get_ereal(&inp, "network_threshold", 0.0, wi);
+    network_min_graph_order = get_eint(&inp, "network_min_graph_order", 2, wi);
+    shortest_path_source = get_eint(&inp, "shortest_path_source", 0, wi);
+    shortest_path_dest = get_eint(&inp, "shortest_path_dest", 0, wi);
+    number_of_shortest_paths = get_eint(&inp, "number_of_shortest_paths", 0, wi);
+    network_punctual_stress = strcasecmp(get_estr(&inp, "network_punctual_stress", "no"), "no");
+    if (atom_based_result_type == ResultType::FORCE_NETWORK or residue_based_result_type == ResultType::FORCE_NETWORK) {
+        if (one_pair != OnePair::SUMMED)
+            gmx_fatal(FARGS, "Force network analysis can only be computed from summed interactions.\n");
+        if (binary_result_file)
+            gmx_fatal(FARGS, "Force network analysis writes text results, binary_result_file is not supported.\n");
+        if (network_threshold < 0.0)
+            gmx_fatal(FARGS, "Invalid value for network_threshold: %f\n", network_threshold);
+        if (network_min_graph_order < 1)
+            gmx_fatal(FARGS, "Invalid value for network_min_graph_order: %d\n", network_min_graph_order);
+        if (number_of_shortest_paths < 0)
+            gmx_fatal(FARGS, "Invalid value for number_of_shortest_paths: %d\n", number_of_shortest_paths);
+        if (shortest_path_source < 0 or shortest_path_dest < 0)
+            gmx_fatal(FARGS, "Invalid shortest path source or destination: %d %d\n", shortest_path_source, shortest_path_dest);
+        std::cout << "Network threshold: " << network_threshold << std::endl;
+        std::cout << "Network minimal graph order: " << network_min_graph_order << std::endl;
+        std::cout << "Number of shortest paths: " << number_of_shortest_paths << std::endl;
+        std::cout << "Network punctual stress: " << network_punctual_stress << std::endl;
+    }
 }
 
 std::vector<int> FDASettings::groupatoms2residues(std::vector<int> const& group_atoms) const
@@ -327,6 +403,47 @@ void FDASettings::fill_atom2residue(gmx_mtop_t *mtop)
     }
 }
 
+void FDASettings::fill_residue_com_tables(gmx_mtop_t *mtop)
+{
+    // Counting sort of the atoms in the fda groups by residue, the atom order within a residue is kept
+    std::vector<int> residue_count(syslen_residues, 0);
+    std::vector<real> atom_mass(syslen_atoms, 0.0);
+    int atom_global_index = 0;
+    for (auto const& mb : mtop->molblock) {
+        t_atoms const& atoms = mtop->moltype[mb.type].atoms;
+        for (int mol_index = 0; mol_index < mb.nmol; ++mol_index) {
+            for (int atom_index = 0; atom_index < atoms.nr; ++atom_index, ++atom_global_index) {
+                if (!atom_in_groups(atom_global_index)) continue;
+                atom_mass[atom_global_index] = atoms.atom[atom_index].m;
+                ++residue_count[atom_2_residue[atom_global_index]];
+            }
+        }
+    }
+
+    std::vector<int> residue_position(syslen_residues, -1);
+    com_residues.clear();
+    com_offsets.assign(1, 0);
+    for (int r = 0; r != syslen_residues; ++r) {
+        if (residue_count[r] == 0) continue;
+        residue_position[r] = com_residues.size();
+        com_residues.push_back(r);
+        com_offsets.push_back(com_offsets.back() + residue_count[r]);
+    }
+
+    com_atoms.resize(com_offsets.back());
+    com_atom_masses.resize(com_offsets.back());
+    com_residue_masses.assign(com_residues.size(), 0.0);
+    std::vector<int> fill(com_offsets.begin(), com_offsets.end() - 1);
+    for (int a = 0; a != syslen_atoms; ++a) {
+        if (!atom_in_groups(a)) continue;
+        int k = residue_position[atom_2_residue[a]];
+        com_atoms[fill[k]] = a;
+        com_atom_masses[fill[k]] = atom_mass[a];
+        com_residue_masses[k] += atom_mass[a];
+        ++fill[k];
+    }
+}
+
 int FDASettings::get_global_residue_number(gmx_mtop_t *mtop, int atnr_global) const
 {
     int mb;
@@ -8,10 +8,13 @@
 #ifndef SRC_GROMACS_FDA_FDASETTINGS_H_
 #define SRC_GROMACS_FDA_FDASETTINGS_H_
 
-#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/real.h"
+#include "DynamicGroups.h"
 #include "InteractionType.h"
 #include "OnePair.h"
 #include "ResidueRenumber.h"
@@ -28,6 +31,7 @@ struct FDASettings
      : atom_based_result_type(ResultType::NO),
        residue_based_result_type(ResultType::NO),
 	   binary_result_file(false),
+       compression_precision(0.0),
        one_pair(OnePair::DETAILED),
        v2s(Vector2Scalar::NORM),
        residues_renumber(ResiduesRenumber::AUTO),
@@ -35,6 +39,7 @@ struct FDASettings
        syslen_atoms(0),
        syslen_residues(0),
        time_averaging_period(1),
+       time_averages_statistics(false),
        type(InteractionType_NONE),
        nonbonded_exclusion_on(true),
        bonded_exclusion_on(true),
@@ -42,7 +47,13 @@ struct FDASettings
        index_group2(-1),
        groups(nullptr),
        groupnames(nullptr),
-	   threshold(1e-10)
+	   threshold(1e-10),
+       network_threshold(0.0),
+       network_min_graph_order(2),
+       shortest_path_source(0),
+       shortest_path_dest(0),
+       number_of_shortest_paths(0),
+       network_punctual_stress(false)
     {}
 
     /// Construction by input file
@@ -53,11 +64,28 @@ struct FDASettings
         return (sys_in_group1[i] or sys_in_group2[i]);
     }
 
-    /// Returns true if atoms i and j are in fda groups
+    /// Returns true if atoms i and j are in fda groups, dynamic groups are taken for the current frame
     bool atoms_in_groups(int i, int j) const {
+        std::vector<char> const& in_group1 = get_in_group1();
+        std::vector<char> const& in_group2 = get_in_group2();
+        return ((in_group1[i] and in_group2[j]) or (in_group1[j] and in_group2[i]));
+    }
+
+    /// Returns true if atoms i and j are in the index groups, which contain the dynamic groups of all frames
+    bool atoms_in_index_groups(int i, int j) const {
         return ((sys_in_group1[i] and sys_in_group2[j]) or (sys_in_group1[j] and sys_in_group2[i]));
     }
 
+    /// Membership of the atoms in group 1 for the current frame
+    std::vector<char> const& get_in_group1() const {
+        return dynamic_groups ? dynamic_groups->get_in_group1() : sys_in_group1;
+    }
+
+    /// Membership of the atoms in group 2 for the current frame
+    std::vector<char> const& get_in_group2() const {
+        return dynamic_groups ? dynamic_groups->get_in_group2() : sys_in_group2;
+    }
+
     /// Makes a list of residue numbers based on atom numbers of this group.
     /// This is slightly more complex than needed to allow the residue numbers to retain the ordering given to atoms.
     std::vector<int> groupatoms2residues(std::vector<int> const& group_atoms) const;
@@ -70,8 +98,17 @@ struct FDASettings
     /// equivalent to a call to it with mtop->maxres_renum = INT_MAX
     int get_global_residue_number(gmx_mtop_t *mtop, int atnr_global) const;
 
+    /// Fill the flat tables of the residues in the fda groups for the COM computation,
+    /// must be called after the group membership of the atoms is set
+    void fill_residue_com_tables(gmx_mtop_t *mtop);
+
     int get_atom2residue(int i) const { return atom_2_residue[i]; }
 
+    /// Returns true if the pairwise forces are written as compressed binary frames
+    bool compressed_result_file() const {
+        return binary_result_file and compression_precision > 0.0;
+    }
+
     bool compatibility_mode(ResultType const& r) const {
         return r == ResultType::COMPAT_BIN or r == ResultType::COMPAT_ASCII;
     }
@@ -81,7 +118,8 @@ struct FDASettings
     }
 
     bool PF_or_PS_mode(ResultType const& r) const {
-        return r == ResultType::PAIRWISE_FORCES_VECTOR or r == ResultType::PAIRWISE_FORCES_SCALAR or r == ResultType::PUNCTUAL_STRESS;
+        return r == ResultType::PAIRWISE_FORCES_VECTOR or r == ResultType::PAIRWISE_FORCES_SCALAR or r == ResultType::PUNCTUAL_STRESS or
+               compatibility_mode(r) or r == ResultType::FORCE_NETWORK;
     }
 
     bool VS_mode(ResultType const& r) const {
@@ -97,6 +135,10 @@ struct FDASettings
     /// If true, the result files will be written in binary format
     bool binary_result_file;
 
+    /// Pairwise forces of binary result files are stored compressed in units of 1 / compression_precision,
+    /// zero means uncompressed
+    double compression_precision;
+
     /// OnePair defines the way the interactions between the same pair of atoms are stored
     OnePair one_pair;
 
@@ -117,17 +159,21 @@ struct FDASettings
     /// Maximum of residue nr. + 1; residue nr. doesn't have to be continuous, there can be gaps
     int syslen_residues;
 
-    /// Mapping of real atom number to index in the pf array
-    std::map<int, int> sys2pf_atoms;
+    /// Mapping of real atom number to index in the pf array, -1 if the atom is not in the fda groups
+    std::vector<int> sys2pf_atoms;
 
-    /// Mapping of real residue number to index in the pf array
-    std::map<int, int> sys2pf_residues;
+    /// Mapping of real residue number to index in the pf array, -1 if the residue is not in the fda groups
+    std::vector<int> sys2pf_residues;
 
     /// Number of steps to average before writing.
     /// If 1 (default), no averaging is done.
     /// If 0 averaging is done over all steps so only one frame is written at the end.
     int time_averaging_period;
 
+    /// If true, mean, variance, minimum and maximum of the scalar pairwise forces or the punctual stress
+    /// are written at the end of each time averaging period instead of the mean
+    bool time_averages_statistics;
+
     /// Output file name for atoms if AtomBased is non-zero
     std::string atom_based_result_filename;
 
@@ -140,6 +186,9 @@ struct FDASettings
     /// If 0 if atom not in group2, if 1 if atom in group2, length of syslen_atoms
     std::vector<char> sys_in_group2;
 
+    /// Groups defined by selections which are evaluated for each frame, nullptr if the index groups are used
+    std::shared_ptr<DynamicGroups> dynamic_groups;
+
     /// Name of group for output in compatibility mode
     std::string groupname;
 
@@ -152,7 +201,22 @@ struct FDASettings
     /// Stores the number of atoms for each residue; only initialized if ResidueBased is non-zero
     std::vector<int> residue_size;
 
-    /// Version of force matrix implementation (compat mode)
+    /// Residues with atoms in the fda groups; only initialized if ResidueBased is non-zero
+    std::vector<int> com_residues;
+
+    /// The atoms of com_residues[k] are com_atoms[com_offsets[k]] to com_atoms[com_offsets[k + 1] - 1]
+    std::vector<int> com_offsets;
+
+    /// Atoms in the fda groups ordered by residue
+    std::vector<int> com_atoms;
+
+    /// Masses of com_atoms
+    std::vector<real> com_atom_masses;
+
+    /// Sum of the masses of the atoms in the fda groups for each of com_residues
+    std::vector<real> com_residue_masses;
+
+    /// Version of force matrix implementation (compat mode), 2.0 uses 64-bit delta encoded pair keys
     static const std::string compat_fm_version;
 
     /// Mark the end of an entry in binary output files (compat mode)
@@ -182,6 +246,24 @@ struct FDASettings
     /// Normalize punctual stress per residue (default: off)
     bool normalize_psr;
 
+    /// Forces lower than network_threshold do not connect particles in the online force network analysis
+    real network_threshold;
+
+    /// Minimal number of particles of a network written by the online force network analysis
+    int network_min_graph_order;
+
+    /// Source particle of the shortest paths of the online force network analysis
+    int shortest_path_source;
+
+    /// Destination particle of the shortest paths of the online force network analysis
+    int shortest_path_dest;
+
+    /// Number of shortest paths written by the online force network analysis, zero means no shortest paths
+    int number_of_shortest_paths;
+
+    /// If true the online force network analysis writes the punctual stress
+    bool network_punctual_stress;
+
     /// If true unsupported potentials will be ignored.
     /// Be aware that the sum of distributed forces do not agree with the total forces.
     /// If false the rerun will be stopped if a unsupported potential is used.
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "ForceMatrix.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace fda {
+
+ForceMatrix::ForceMatrix(int dim)
+ : dim(dim),
+   row_offsets(dim + 1, 0)
+{}
+
+ForceMatrix::ForceMatrix(int dim, std::vector<ForceMatrixEntry> const& entries)
+ : dim(dim),
+   row_offsets(dim + 1, 0)
+{
+    // Counting sort by rows keeps the order of the entries within a row
+    for (auto&& e : entries) {
+        if (e.i < 0 or e.i >= dim or e.j < 0 or e.j >= dim)
+            gmx_fatal(FARGS, "Index is larger than dimension.");
+        ++row_offsets[e.i + 1];
+    }
+    for (int i = 0; i < dim; ++i) row_offsets[i + 1] += row_offsets[i];
+
+    std::vector<std::pair<int, double>> row_entries(entries.size());
+    std::vector<size_t> next(row_offsets.begin(), row_offsets.end() - 1);
+    for (auto&& e : entries) row_entries[next[e.i]++] = std::make_pair(e.j, e.value);
+
+    // Sort columns, for duplicates the last value wins
+    columns.reserve(entries.size());
+    values.reserve(entries.size());
+    size_t begin = 0;
+    for (int i = 0; i < dim; ++i) {
+        size_t end = row_offsets[i + 1];
+        std::stable_sort(row_entries.begin() + begin, row_entries.begin() + end,
+            [](std::pair<int, double> const& e1, std::pair<int, double> const& e2) { return e1.first < e2.first; });
+        for (size_t k = begin; k != end; ++k) {
+            if (k + 1 != end and row_entries[k + 1].first == row_entries[k].first) continue;
+            if (row_entries[k].second == 0.0) continue;
+            columns.push_back(row_entries[k].first);
+            values.push_back(row_entries[k].second);
+        }
+        begin = end;
+        row_offsets[i + 1] = columns.size();
+    }
+}
+
+ForceMatrix::ForceMatrix(std::vector<double> const& dense)
+ : dim(std::sqrt(dense.size())),
+   row_offsets(dim + 1, 0)
+{
+    if (static_cast<size_t>(dim) * dim != dense.size()) gmx_fatal(FARGS, "Force matrix is not quadratic.");
+    for (int i = 0; i < dim; ++i) {
+        for (int j = 0; j < dim; ++j) {
+            double value = dense[i * dim + j];
+            if (value == 0.0) continue;
+            columns.push_back(j);
+            values.push_back(value);
+        }
+        row_offsets[i + 1] = columns.size();
+    }
+}
+
+double ForceMatrix::operator () (int i, int j) const
+{
+    if (i < 0 or i >= dim) return 0.0;
+    auto first = columns.begin() + row_offsets[i];
+    auto last = columns.begin() + row_offsets[i + 1];
+    auto iter = std::lower_bound(first, last, j);
+    if (iter == last or *iter != j) return 0.0;
+    return values[iter - columns.begin()];
+}
+
+template <class Operation>
+void ForceMatrix::merge(ForceMatrix const& other, Operation op)
+{
+    if (other.dim != dim) gmx_fatal(FARGS, "Dimensions of force matrices do not match.");
+
+    std::vector<size_t> new_row_offsets(dim + 1, 0);
+    std::vector<int> new_columns;
+    std::vector<double> new_values;
+    new_columns.reserve(std::max(columns.size(), other.columns.size()));
+    new_values.reserve(new_columns.capacity());
+
+    auto add = [&](int j, double value) {
+        if (value == 0.0) return;
+        new_columns.push_back(j);
+        new_values.push_back(value);
+    };
+
+    for (int i = 0; i < dim; ++i) {
+        size_t k1 = row_offsets[i], end1 = row_offsets[i + 1];
+        size_t k2 = other.row_offsets[i], end2 = other.row_offsets[i + 1];
+        while (k1 != end1 or k2 != end2) {
+            if (k2 == end2 or (k1 != end1 and columns[k1] < other.columns[k2])) {
+                add(columns[k1], op(values[k1], 0.0));
+                ++k1;
+            } else if (k1 == end1 or other.columns[k2] < columns[k1]) {
+                add(other.columns[k2], op(0.0, other.values[k2]));
+                ++k2;
+            } else {
+                add(columns[k1], op(values[k1], other.values[k2]));
+                ++k1;
+                ++k2;
+            }
+        }
+        new_row_offsets[i + 1] = new_columns.size();
+    }
+
+    row_offsets.swap(new_row_offsets);
+    columns.swap(new_columns);
+    values.swap(new_values);
+}
+
+ForceMatrix& ForceMatrix::operator += (ForceMatrix const& other)
+{
+    merge(other, [](double a, double b) { return a + b; });
+    return *this;
+}
+
+ForceMatrix& ForceMatrix::operator -= (ForceMatrix const& other)
+{
+    merge(other, [](double a, double b) { return a - b; });
+    return *this;
+}
+
+ForceMatrix& ForceMatrix::operator *= (double factor)
+{
+    for (auto& v : values) v *= factor;
+    return *this;
+}
+
+ForceMatrix& ForceMatrix::operator /= (double divisor)
+{
+    for (auto& v : values) v /= divisor;
+    return *this;
+}
+
+void ForceMatrix::abs()
+{
+    for (auto& v : values) v = std::abs(v);
+}
+
+std::vector<double> ForceMatrix::to_dense() const
+{
+    std::vector<double> dense(static_cast<size_t>(dim) * dim, 0.0);
+    for_each([&](int i, int j, double value) { dense[static_cast<size_t>(i) * dim + j] = value; });
+    return dense;
+}
+
+} // namespace fda
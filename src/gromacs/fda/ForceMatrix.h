@@ -0,0 +1,96 @@
+#ifndef SRC_GROMACS_FDA_FORCEMATRIX_H_
+#define SRC_GROMACS_FDA_FORCEMATRIX_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace fda {
+
+/// Element of a force matrix used for the construction
+struct ForceMatrixEntry
+{
+    ForceMatrixEntry(int i, int j, double value)
+     : i(i), j(j), value(value)
+    {}
+
+    int i;
+    int j;
+    double value;
+};
+
+/**
+ * Sparse force matrix in compressed sparse row (CSR) format
+ *
+ * Only the elements of interacting pairs are stored, the columns within a row are sorted.
+ * Memory and time scale with the number of pairwise forces instead of the square of the number of particles.
+ * All other elements are zero.
+ */
+class ForceMatrix
+{
+public:
+
+    /// Empty matrix
+    explicit ForceMatrix(int dim = 0);
+
+    /// Build from a list of elements, later elements overwrite earlier ones with the same position
+    ForceMatrix(int dim, std::vector<ForceMatrixEntry> const& entries);
+
+    /// Build from dense matrix in row-major order, zeros are not stored
+    explicit ForceMatrix(std::vector<double> const& dense);
+
+    /// Number of rows and columns
+    int size() const { return dim; }
+
+    /// Number of stored elements
+    size_t get_number_of_entries() const { return columns.size(); }
+
+    /// Return element (i, j), zero if not stored
+    double operator () (int i, int j) const;
+
+    /// Call f(i, j, value) for all stored elements in row-major order
+    template <class Function>
+    void for_each(Function&& f) const
+    {
+        for (int i = 0; i < dim; ++i) {
+            for (size_t k = row_offsets[i]; k != row_offsets[i + 1]; ++k) f(i, columns[k], values[k]);
+        }
+    }
+
+    /// Add other matrix element-wise
+    ForceMatrix& operator += (ForceMatrix const& other);
+
+    /// Subtract other matrix element-wise
+    ForceMatrix& operator -= (ForceMatrix const& other);
+
+    /// Multiply all elements by factor
+    ForceMatrix& operator *= (double factor);
+
+    /// Divide all elements by divisor
+    ForceMatrix& operator /= (double divisor);
+
+    /// Replace all elements by their absolute value
+    void abs();
+
+    /// Return dense matrix in row-major order
+    std::vector<double> to_dense() const;
+
+private:
+
+    /// Merge two sorted matrices, elements only in other are combined with zero
+    template <class Operation>
+    void merge(ForceMatrix const& other, Operation op);
+
+    int dim;
+
+    /// Beginning of each row in columns and values, dim + 1 entries
+    std::vector<size_t> row_offsets;
+
+    std::vector<int> columns;
+
+    std::vector<double> values;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_FORCEMATRIX_H_ */
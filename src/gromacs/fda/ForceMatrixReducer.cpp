@@ -0,0 +1,63 @@
+#include "ForceMatrixReducer.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace fda {
+
+ForceMatrixReducer::ForceMatrixReducer(FrameReduction reduction, int n)
+ : reduction(reduction),
+   n(n),
+   window_first_frame(0),
+   first_frame(-1)
+{
+    if (n < 1) gmx_fatal(FARGS, "Number of frames for the reduction must be positive.");
+}
+
+bool ForceMatrixReducer::is_needed(int frame) const
+{
+    return reduction != FrameReduction::EVERY_NTH or frame % n == 0;
+}
+
+bool ForceMatrixReducer::add(int frame, ForceMatrix const& force_matrix)
+{
+    switch (reduction) {
+        case FrameReduction::EVERY_NTH:
+            result = force_matrix;
+            first_frame = frame;
+            return true;
+        case FrameReduction::BLOCK_MEAN:
+            if (window.empty()) window_first_frame = frame;
+            window.push_back(force_matrix);
+            if (static_cast<int>(window.size()) < n) return false;
+            average_window();
+            window.clear();
+            return true;
+        case FrameReduction::SLIDING_MEAN:
+            window.push_back(force_matrix);
+            if (static_cast<int>(window.size()) > n) window.pop_front();
+            window_first_frame = frame + 1 - window.size();
+            if (static_cast<int>(window.size()) < n) return false;
+            average_window();
+            return true;
+    }
+    return false;
+}
+
+bool ForceMatrixReducer::finish()
+{
+    if (reduction != FrameReduction::BLOCK_MEAN or window.empty()) return false;
+    average_window();
+    window.clear();
+    return true;
+}
+
+void ForceMatrixReducer::average_window()
+{
+    // The sum is formed again for each window instead of subtracting the leaving frame,
+    // so that vanishing forces are exactly zero and not stored.
+    result = window.front();
+    for (size_t k = 1; k < window.size(); ++k) result += window[k];
+    result /= window.size();
+    first_frame = window_first_frame;
+}
+
+} // namespace fda
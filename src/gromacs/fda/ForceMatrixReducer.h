@@ -0,0 +1,69 @@
+#ifndef SRC_GROMACS_FDA_FORCEMATRIXREDUCER_H_
+#define SRC_GROMACS_FDA_FORCEMATRIXREDUCER_H_
+
+#include <cstdint>
+#include <deque>
+#include "ForceMatrix.h"
+
+namespace fda {
+
+/// FrameReduction defines how the force matrices of consecutive frames are combined
+enum class FrameReduction : std::int8_t
+{
+    EVERY_NTH,    ///< every n-th frame without averaging
+    BLOCK_MEAN,   ///< mean over non-overlapping blocks of n frames, the last block may be shorter
+    SLIDING_MEAN  ///< mean over a window of n frames, which is moved by one frame
+};
+
+/**
+ * Streaming reduction of force matrices
+ *
+ * The force matrices are added frame by frame in increasing order, only the frames
+ * for which is_needed returns true must be added. A frame is never added twice,
+ * so that all reductions need a single sequential pass through the file.
+ */
+class ForceMatrixReducer
+{
+public:
+
+    ForceMatrixReducer(FrameReduction reduction, int n);
+
+    /// Return true if the frame contributes to a result
+    bool is_needed(int frame) const;
+
+    /// Add the force matrix of the next needed frame, return true if a result is ready
+    bool add(int frame, ForceMatrix const& force_matrix);
+
+    /// Complete a last incomplete block at the end of the file, return true if a result is ready
+    bool finish();
+
+    /// Reduced force matrix, valid after add or finish returned true
+    ForceMatrix const& get_result() const { return result; }
+
+    /// First frame contributing to the result
+    int get_first_frame() const { return first_frame; }
+
+private:
+
+    /// Mean of the frames in the window
+    void average_window();
+
+    FrameReduction reduction;
+
+    int n;
+
+    /// Force matrices of the current block or window
+    std::deque<ForceMatrix> window;
+
+    /// Frame number of the first matrix in window
+    int window_first_frame;
+
+    ForceMatrix result;
+
+    int first_frame;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_FORCEMATRIXREDUCER_H_ */
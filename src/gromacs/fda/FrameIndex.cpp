@@ -0,0 +1,48 @@
+#include <cstring>
+#include "FrameIndex.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace fda {
+
+namespace {
+
+/// Marks the end of a file with frame index
+const char magic[8] = {'F', 'D', 'A', 'I', 'N', 'D', 'E', 'X'};
+
+/// Size of the trailer without the offsets
+const int64_t trailer_size = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(magic);
+
+} // namespace
+
+const uint32_t FrameIndex::version;
+
+void FrameIndex::write(std::ostream& os) const
+{
+    uint64_t nb_frames = offsets.size();
+    uint32_t current_version = version;
+    if (nb_frames) os.write(reinterpret_cast<const char*>(&offsets[0]), nb_frames * sizeof(int64_t));
+    os.write(reinterpret_cast<const char*>(&nb_frames), sizeof(uint64_t));
+    os.write(reinterpret_cast<const char*>(&current_version), sizeof(uint32_t));
+    os.write(magic, sizeof(magic));
+}
+
+bool FrameIndex::read(char const* first, char const* last)
+{
+    int64_t length = last - first;
+    if (length < trailer_size or std::memcmp(last - sizeof(magic), magic, sizeof(magic))) return false;
+
+    uint64_t nb_frames;
+    uint32_t file_version;
+    std::memcpy(&nb_frames, last - trailer_size, sizeof(uint64_t));
+    std::memcpy(&file_version, last - trailer_size + sizeof(uint64_t), sizeof(uint32_t));
+    if (file_version > version) gmx_fatal(FARGS, "Unsupported version %u of FDA frame index.", file_version);
+    if (static_cast<int64_t>(nb_frames) > (length - trailer_size) / static_cast<int64_t>(sizeof(int64_t)))
+        gmx_fatal(FARGS, "Corrupt FDA frame index.");
+
+    end_of_frames = length - trailer_size - nb_frames * sizeof(int64_t);
+    offsets.resize(nb_frames);
+    if (nb_frames) std::memcpy(&offsets[0], first + end_of_frames, nb_frames * sizeof(int64_t));
+    return true;
+}
+
+} // namespace fda
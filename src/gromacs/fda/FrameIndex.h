@@ -0,0 +1,71 @@
+#ifndef SRC_GROMACS_FDA_FRAMEINDEX_H_
+#define SRC_GROMACS_FDA_FRAMEINDEX_H_
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace fda {
+
+/**
+ * Byte offsets of all frames within a FDA result file
+ *
+ * Binary result files are written frame by frame as before.
+ * When the file is closed, the frame index is appended as trailer:
+ *
+ *   int64 offsets[nb_frames] | uint64 nb_frames | uint32 version | char magic[8]
+ *
+ * Since the trailer is recognized by the magic at the end of the file,
+ * the header and the frame records are unchanged and files without a trailer,
+ * e.g. written by older versions or by an aborted run, are still readable.
+ * For those files and for text files the readers build the index with a single scan.
+ */
+class FrameIndex
+{
+public:
+
+    /// Version of the binary container, written into the trailer
+    static const uint32_t version = 1;
+
+    /// Default constructor, no frames
+    FrameIndex()
+     : end_of_frames(0)
+    {}
+
+    /// Register a new frame beginning at offset
+    void add(int64_t offset) { offsets.push_back(offset); }
+
+    /// Set the offset behind the last frame
+    void set_end_of_frames(int64_t offset) { end_of_frames = offset; }
+
+    /// Return the number of frames
+    size_t size() const { return offsets.size(); }
+
+    /// Offset of the first byte of a frame
+    int64_t get_begin(size_t frame) const { return offsets[frame]; }
+
+    /// Offset behind the last byte of a frame
+    int64_t get_end(size_t frame) const { return frame + 1 < offsets.size() ? offsets[frame + 1] : end_of_frames; }
+
+    /// Offset behind the last frame, which is the beginning of the trailer
+    int64_t get_end_of_frames() const { return end_of_frames; }
+
+    /// Append the trailer to the stream
+    void write(std::ostream& os) const;
+
+    /// Read the trailer of a binary file in [first, last), return false if the file has no frame index
+    bool read(char const* first, char const* last);
+
+private:
+
+    /// Beginning of all frames
+    std::vector<int64_t> offsets;
+
+    /// Offset behind the last frame
+    int64_t end_of_frames;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_FRAMEINDEX_H_ */
@@ -0,0 +1,345 @@
+#ifndef SRC_GROMACS_FDA_FRAMEVIEW_H_
+#define SRC_GROMACS_FDA_FRAMEVIEW_H_
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "gromacs/fda/Force.h"
+#include "gromacs/fda/Varint.h"
+#include "gromacs/fda/Vector.h"
+#include "gromacs/utility/real.h"
+
+namespace fda {
+
+/// Load a value from memory of a mapped file.
+/// The records of the binary format start at odd offsets, so that they can not be accessed by typed pointers.
+template <typename T>
+inline T load_unaligned(char const* p)
+{
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+/// Number of real components of a force
+template <typename T>
+struct NumberOfComponents;
+
+template <>
+struct NumberOfComponents<real> { static const int value = 1; };
+
+template <>
+struct NumberOfComponents<Vector> { static const int value = 3; };
+
+inline real* get_components(real& force) { return &force; }
+inline real* get_components(Vector& force) { return force.get_pointer(); }
+inline real const* get_components(real const& force) { return &force; }
+inline real const* get_components(Vector const& force) { return force.get_pointer(); }
+
+/**
+ * Pairwise forces of a single atom i within a frame of a binary file
+ *
+ * The row is a view into the mapped file: uint i | uint n | n x (uint j | real force[c] | uint type)
+ */
+template <typename ForceType>
+class PairwiseForceRow
+{
+public:
+
+    typedef decltype(ForceType().force) ValueType;
+
+    /// Size of a single (j, force, type) record in bytes
+    static const size_t record_size = 2 * sizeof(uint) + NumberOfComponents<ValueType>::value * sizeof(real);
+
+    PairwiseForceRow(char const* p)
+     : i(load_unaligned<uint>(p)),
+       n(load_unaligned<uint>(p + sizeof(uint))),
+       records(p + 2 * sizeof(uint))
+    {}
+
+    int get_i() const { return i; }
+
+    size_t size() const { return n; }
+
+    int get_j(size_t k) const { return load_unaligned<uint>(records + k * record_size); }
+
+    ForceType get_force(size_t k) const
+    {
+        char const* p = records + k * record_size;
+        ForceType force;
+        std::memcpy(get_components(force.force), p + sizeof(uint), NumberOfComponents<ValueType>::value * sizeof(real));
+        force.type = load_unaligned<uint>(p + record_size - sizeof(uint));
+        return force;
+    }
+
+    /// Behind the last record, which is the beginning of the next row
+    char const* end() const { return records + n * record_size; }
+
+private:
+
+    int i;
+
+    size_t n;
+
+    char const* records;
+
+};
+
+/**
+ * Pairwise forces of a frame of a binary file as sequence of rows, view into the mapped file
+ */
+template <typename ForceType>
+class PairwiseForcesFrame
+{
+public:
+
+    /// Forward iterator over the rows
+    class iterator
+    {
+    public:
+
+        iterator(char const* p) : p(p) {}
+
+        PairwiseForceRow<ForceType> operator * () const { return PairwiseForceRow<ForceType>(p); }
+
+        iterator& operator ++ () { p = PairwiseForceRow<ForceType>(p).end(); return *this; }
+
+        bool operator != (iterator const& other) const { return p != other.p; }
+
+    private:
+
+        char const* p;
+    };
+
+    /// Frame in [first, last), first points to the number of interactions
+    PairwiseForcesFrame(char const* first, char const* last)
+     : first(first), last(last)
+    {}
+
+    /// Total number of pairwise forces in this frame
+    size_t get_number_of_interactions() const { return load_unaligned<uint>(first); }
+
+    iterator begin() const { return iterator(first + sizeof(uint)); }
+
+    iterator end() const { return iterator(last); }
+
+private:
+
+    char const* first;
+
+    char const* last;
+
+};
+
+/**
+ * Pairwise forces of a frame of a compressed binary file, view into the mapped file
+ *
+ * The frame consists of three sections, which are decoded side by side without allocation:
+ *
+ *   varint nb_interactions | varint nb_rows
+ *   rows:   nb_rows x (varint i - previous i | varint n | varint zigzag(j_0 - i) | (n - 1) x varint j_k - j_k-1)
+ *   forces: nb_interactions x components x varint zigzag(round(force * precision))
+ *   types:  run-length coded as pairs of varint type | varint length
+ *
+ * The j indices within a row are sorted ascending, so that the differences are small.
+ */
+template <typename ForceType>
+class CompressedPairwiseForcesFrame
+{
+public:
+
+    typedef decltype(ForceType().force) ValueType;
+
+    static const int nb_components = NumberOfComponents<ValueType>::value;
+
+    /// Frame in [first, last), forces are stored in units of 1 / precision
+    CompressedPairwiseForcesFrame(char const* first, char const* last, double precision)
+     : first(first), last(last), precision(precision)
+    {}
+
+    /// Call f(i, j, force) for all pairwise forces of the frame.
+    /// Returns the position behind the frame or nullptr if the frame is incomplete.
+    template <class Function>
+    char const* for_each(Function&& f) const
+    {
+        uint64_t nb_interactions, nb_rows, value, n = 0;
+        char const* rows = read_varint(first, last, nb_interactions);
+        if (rows) rows = read_varint(rows, last, nb_rows);
+        if (!rows) return nullptr;
+
+        // Find the beginning of the force and type sections and check that the frame is complete
+        char const* forces = rows;
+        for (uint64_t r = 0; r != nb_rows and forces; ++r) {
+            forces = read_varint(forces, last, value);
+            if (forces) forces = read_varint(forces, last, n);
+            for (uint64_t k = 0; forces and k != n; ++k) forces = read_varint(forces, last, value);
+        }
+        char const* types = forces;
+        for (uint64_t k = 0; types and k != nb_interactions * nb_components; ++k) types = read_varint(types, last, value);
+        char const* end = types;
+        for (uint64_t count = 0; count != nb_interactions;) {
+            if (end) end = read_varint(end, last, value);
+            if (end) end = read_varint(end, last, n);
+            if (!end or n == 0 or count + n > nb_interactions) return nullptr;
+            count += n;
+        }
+
+        const double inv_precision = 1.0 / precision;
+        uint64_t type = 0, run = 0;
+        int i = 0;
+        for (uint64_t r = 0; r != nb_rows; ++r) {
+            rows = read_varint(rows, last, value);
+            i += value;
+            rows = read_varint(rows, last, n);
+            int j = i;
+            for (uint64_t k = 0; k != n; ++k) {
+                rows = read_varint(rows, last, value);
+                j += k == 0 ? static_cast<int>(zigzag_decode(value)) : static_cast<int>(value);
+                ForceType force;
+                real* components = get_components(force.force);
+                for (int c = 0; c != nb_components; ++c) {
+                    forces = read_varint(forces, last, value);
+                    components[c] = zigzag_decode(value) * inv_precision;
+                }
+                if (run == 0) {
+                    types = read_varint(types, last, type);
+                    types = read_varint(types, last, run);
+                }
+                force.type = type;
+                --run;
+                f(i, j, force);
+            }
+        }
+        return end;
+    }
+
+private:
+
+    char const* first;
+
+    char const* last;
+
+    double precision;
+
+};
+
+/**
+ * Stress values of a frame of a binary file, view into the mapped file
+ *
+ * Trailing zeros may be omitted in the file, they are returned by operator[].
+ */
+class StressFrame
+{
+public:
+
+    StressFrame(char const* first, size_t nb_values, size_t syslen)
+     : first(first), nb_values(nb_values), syslen(syslen)
+    {}
+
+    size_t size() const { return syslen; }
+
+    real operator [] (size_t i) const { return i < nb_values ? load_unaligned<real>(first + i * sizeof(real)) : 0.0; }
+
+private:
+
+    char const* first;
+
+    size_t nb_values;
+
+    size_t syslen;
+
+};
+
+/**
+ * Tokenizer for the text formats working directly on the mapped file
+ *
+ * Tokens are separated by whitespace, newlines are reported,
+ * so that line-based formats can be parsed without copying lines into strings.
+ */
+class TextParser
+{
+public:
+
+    TextParser(char const* p, char const* last)
+     : p(p), last(last)
+    {}
+
+    /// Skip blanks, return true if the end of line or the end of the text is reached
+    bool end_of_line()
+    {
+        while (p != last and (*p == ' ' or *p == '\t' or *p == '\r')) ++p;
+        return p == last or *p == '\n';
+    }
+
+    /// Move behind the next newline
+    void next_line()
+    {
+        while (p != last and *p != '\n') ++p;
+        if (p != last) ++p;
+    }
+
+    /// Return true if the end of the text is reached
+    bool empty() const { return p == last; }
+
+    /// Read the next integer of the current line
+    bool next(int& value)
+    {
+        int64_t v;
+        if (!next(v)) return false;
+        value = v;
+        return true;
+    }
+
+    /// Read the next 64-bit integer of the current line
+    bool next(int64_t& value)
+    {
+        if (end_of_line()) return false;
+        bool negative = *p == '-';
+        if (negative or *p == '+') ++p;
+        if (p == last or *p < '0' or *p > '9') return false;
+        int64_t v = 0;
+        for (; p != last and *p >= '0' and *p <= '9'; ++p) v = 10 * v + (*p - '0');
+        value = negative ? -v : v;
+        return true;
+    }
+
+    /// Read the next floating point number of the current line
+    bool next(real& value)
+    {
+        if (end_of_line()) return false;
+        // Copy the token to get a terminated string, the end of a mapped file is not terminated
+        char token[64];
+        size_t n = 0;
+        for (; p != last and n < sizeof(token) - 1 and !std::isspace(static_cast<unsigned char>(*p)); ++p, ++n) token[n] = *p;
+        token[n] = '\0';
+        char *token_end;
+        value = std::strtod(token, &token_end);
+        return n and token_end == token + n;
+    }
+
+    /// Read the next vector of the current line
+    bool next(Vector& value)
+    {
+        real* v = value.get_pointer();
+        return next(v[0]) and next(v[1]) and next(v[2]);
+    }
+
+    /// Read the next force and interaction type of the current line
+    template <typename T>
+    bool next(Force<T>& force)
+    {
+        return next(force.force) and next(force.type);
+    }
+
+private:
+
+    char const* p;
+
+    char const* last;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_FRAMEVIEW_H_ */
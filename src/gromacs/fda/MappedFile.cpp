@@ -0,0 +1,56 @@
+#include <fstream>
+#include <iterator>
+#include "gromacs/utility/fatalerror.h"
+#include "MappedFile.h"
+#include "config.h"
+
+#ifdef HAVE_UNISTD_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fda {
+
+MappedFile::MappedFile(std::string const& filename)
+ : data(nullptr),
+   length(0)
+{
+#ifdef HAVE_UNISTD_H
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
+    struct stat file_status;
+    if (fstat(fd, &file_status) == -1) {
+        close(fd);
+        gmx_fatal(FARGS, "Error reading file %s", filename.c_str());
+    }
+    length = file_status.st_size;
+    if (length) {
+        void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            gmx_fatal(FARGS, "Error mapping file %s", filename.c_str());
+        }
+        // Frames are mostly read in order
+        madvise(ptr, length, MADV_SEQUENTIAL);
+        data = static_cast<char const*>(ptr);
+    }
+    close(fd);
+#else
+    std::ifstream is(filename, std::ifstream::binary);
+    if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
+    buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    length = buffer.size();
+    data = buffer.data();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef HAVE_UNISTD_H
+    if (length) munmap(const_cast<char*>(data), length);
+#endif
+}
+
+} // namespace fda
@@ -0,0 +1,53 @@
+#ifndef SRC_GROMACS_FDA_MAPPEDFILE_H_
+#define SRC_GROMACS_FDA_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace fda {
+
+/**
+ * Read-only memory mapping of a whole file
+ *
+ * The result files are accessed directly in the mapped memory,
+ * so that no copy of a frame is needed and the memory is bounded by the page cache.
+ * On platforms without mmap the file is read into a buffer.
+ */
+class MappedFile
+{
+public:
+
+    /// Map the file, fatal error if the file can not be opened
+    MappedFile(std::string const& filename);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator = (MappedFile const&) = delete;
+
+    /// First byte of the file
+    char const* begin() const { return data; }
+
+    /// Behind the last byte of the file
+    char const* end() const { return data + length; }
+
+    /// Size of the file in bytes
+    size_t size() const { return length; }
+
+private:
+
+    /// Mapped memory
+    char const* data;
+
+    /// Size of the file
+    size_t length;
+
+    /// File content if mmap is not available
+    std::vector<char> buffer;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_MAPPEDFILE_H_ */
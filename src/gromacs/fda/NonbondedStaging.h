@@ -0,0 +1,92 @@
+#ifndef SRC_GROMACS_FDA_NONBONDEDSTAGING_H_
+#define SRC_GROMACS_FDA_NONBONDEDSTAGING_H_
+
+#include <algorithm>
+#include <vector>
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/real.h"
+
+namespace fda {
+
+/**
+ * Per-thread staging buffer for the pairwise forces of the SIMD nonbonded kernels
+ *
+ * The kernels compute the threshold and group masks with SIMD instructions and
+ * store the complete registers of a cluster pair with aligned stores into one block,
+ * forces which are not interesting are already set to zero.
+ * A block is a structure of arrays with the quantities fcoul, fvdw, dx, dy, dz,
+ * each of them stored as 4 i-rows times unrollj j-lanes.
+ * The blocks are consumed by FDA::flush_nonbonded_staging after the kernel,
+ * so that the hash lookups of the pair storage are not interleaved with the SIMD loop.
+ */
+class NonbondedStaging
+{
+public:
+
+    /// Number of i-atoms of a cluster
+    static const int nb_rows = 4;
+
+    /// Quantities of a block: fcoul, fvdw, dx, dy, dz
+    static const int nb_quantities = 5;
+
+    /// Default constructor
+    NonbondedStaging()
+     : unrollj(0), size(0)
+    {}
+
+    /// Append a block for the cluster pair with first i-atom ai and first j-atom aj and return its aligned memory
+    real* append(int ai, int aj, int unrollj)
+    {
+        this->unrollj = unrollj;
+        size_t block_size = nb_rows * nb_quantities * unrollj;
+        if (size + block_size > data.size()) data.resize(std::max(2 * data.size(), size + block_size));
+        i_atoms.push_back(ai);
+        j_atoms.push_back(aj);
+        real* block = data.data() + size;
+        size += block_size;
+        return block;
+    }
+
+    /// Remove all blocks, but keep the capacity
+    void clear()
+    {
+        i_atoms.clear();
+        j_atoms.clear();
+        size = 0;
+    }
+
+    int get_number_of_blocks() const { return i_atoms.size(); }
+
+    int get_unrollj() const { return unrollj; }
+
+    /// First i-atom of block b in nbnxn order
+    int get_i(int b) const { return i_atoms[b]; }
+
+    /// First j-atom of block b in nbnxn order
+    int get_j(int b) const { return j_atoms[b]; }
+
+    /// Memory of block b
+    real const* get_block(int b) const { return data.data() + b * nb_rows * nb_quantities * unrollj; }
+
+private:
+
+    /// Number of j-atoms per i-row of a cluster pair, the same for all blocks
+    int unrollj;
+
+    /// Used length of data
+    size_t size;
+
+    /// Block memory, aligned for SIMD stores
+    std::vector<real, gmx::AlignedAllocator<real>> data;
+
+    /// First i-atom of each block
+    std::vector<int> i_atoms;
+
+    /// First j-atom of each block
+    std::vector<int> j_atoms;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_NONBONDEDSTAGING_H_ */
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <stdexcept>
+#include "gromacs/gmxana/fda/BoostGraph.h"
+#include "gromacs/gmxana/fda/Graph.h"
+#include "OnlineAnalysis.h"
+
+namespace fda {
+
+NetworkAnalysis::NetworkAnalysis(double threshold, int min_graph_order)
+ : threshold(threshold),
+   min_graph_order(min_graph_order)
+{}
+
+void NetworkAnalysis::analyse(ForceMatrix const& forces, std::ostream& os) const
+{
+    fda_analysis::Graph graph(forces);
+    for (auto const& network : graph.getNetworks(threshold, min_graph_order)) {
+        os << "network " << network.size();
+        for (auto i : network) os << " " << i;
+        os << "\n";
+    }
+}
+
+ShortestPathAnalysis::ShortestPathAnalysis(int source, int dest, int number_of_paths)
+ : source(source),
+   dest(dest),
+   number_of_paths(number_of_paths)
+{}
+
+void ShortestPathAnalysis::analyse(ForceMatrix const& forces, std::ostream& os) const
+{
+    // The vertices of the graph are only allocated up to the largest connected particle
+    int max_index = -1;
+    forces.for_each([&max_index](int i, int j, double force) {
+        if (force != 0.0) max_index = std::max(max_index, std::max(i, j));
+    });
+    if (source > max_index or dest > max_index) return;
+
+    fda_analysis::BoostGraph graph(forces);
+    fda_analysis::BoostGraph::PathList paths;
+    try {
+        paths = graph.findKShortestPaths(source, dest, number_of_paths);
+    } catch (std::runtime_error const&) {
+        // No connection between source and dest in this frame
+        return;
+    }
+
+    for (auto const& path : paths) {
+        os << "path " << graph.distance(path);
+        for (auto i : path) os << " " << i;
+        os << "\n";
+    }
+}
+
+PunctualStressAnalysis::PunctualStressAnalysis(std::vector<int> const& residue_size)
+ : residue_size(residue_size)
+{}
+
+void PunctualStressAnalysis::analyse(ForceMatrix const& forces, std::ostream& os) const
+{
+    std::vector<double> stress(forces.size(), 0.0);
+    forces.for_each([&stress](int i, int, double force) { stress[i] += force; });
+
+    if (!residue_size.empty()) {
+        for (size_t i = 0; i != stress.size(); ++i) {
+            if (stress[i] != 0.0) stress[i] /= residue_size[i];
+        }
+    }
+
+    os << "stress";
+    for (auto s : stress) os << " " << s;
+    os << "\n";
+}
+
+std::vector<std::unique_ptr<OnlineAnalysis>> make_online_analyses(FDASettings const& fda_settings, bool residue_based)
+{
+    std::vector<std::unique_ptr<OnlineAnalysis>> analyses;
+    analyses.emplace_back(new NetworkAnalysis(fda_settings.network_threshold, fda_settings.network_min_graph_order));
+    if (fda_settings.number_of_shortest_paths > 0) {
+        analyses.emplace_back(new ShortestPathAnalysis(fda_settings.shortest_path_source,
+            fda_settings.shortest_path_dest, fda_settings.number_of_shortest_paths));
+    }
+    if (fda_settings.network_punctual_stress) {
+        analyses.emplace_back(new PunctualStressAnalysis(residue_based and fda_settings.normalize_psr ?
+            fda_settings.residue_size : std::vector<int>()));
+    }
+    return analyses;
+}
+
+} // namespace fda
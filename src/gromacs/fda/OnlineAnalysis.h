@@ -0,0 +1,98 @@
+#ifndef SRC_GROMACS_FDA_ONLINEANALYSIS_H_
+#define SRC_GROMACS_FDA_ONLINEANALYSIS_H_
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "FDASettings.h"
+#include "ForceMatrix.h"
+
+namespace fda {
+
+/**
+ * In-process analysis of the pairwise forces of a frame
+ *
+ * Used by the result type force_network, the pairwise forces are analysed in memory
+ * and only the reduced results are written, so that no pairwise force file is needed.
+ */
+class OnlineAnalysis
+{
+public:
+
+    virtual ~OnlineAnalysis() {}
+
+    /// Analyse the symmetric matrix of absolute scalar forces and write the results of the frame
+    virtual void analyse(ForceMatrix const& forces, std::ostream& os) const = 0;
+
+};
+
+/**
+ * Networks of particles connected by forces above the threshold, as gmx_fda_graph
+ *
+ * Line format: network <number of particles> <particles>
+ */
+class NetworkAnalysis : public OnlineAnalysis
+{
+public:
+
+    NetworkAnalysis(double threshold, int min_graph_order);
+
+    void analyse(ForceMatrix const& forces, std::ostream& os) const override;
+
+private:
+
+    double threshold;
+
+    int min_graph_order;
+
+};
+
+/**
+ * Yen's k shortest paths between two particles, as gmx_fda_shortest_path
+ *
+ * Line format: path <distance> <particles>
+ */
+class ShortestPathAnalysis : public OnlineAnalysis
+{
+public:
+
+    ShortestPathAnalysis(int source, int dest, int number_of_paths);
+
+    void analyse(ForceMatrix const& forces, std::ostream& os) const override;
+
+private:
+
+    int source;
+
+    int dest;
+
+    int number_of_paths;
+
+};
+
+/**
+ * Punctual stress, the sum of the absolute forces of each particle
+ *
+ * Line format: stress <punctual stress of all particles>
+ */
+class PunctualStressAnalysis : public OnlineAnalysis
+{
+public:
+
+    /// The stress is divided by the number of atoms of each residue if residue_size is not empty
+    PunctualStressAnalysis(std::vector<int> const& residue_size = std::vector<int>());
+
+    void analyse(ForceMatrix const& forces, std::ostream& os) const override;
+
+private:
+
+    std::vector<int> residue_size;
+
+};
+
+/// Return the analyses selected in the settings, residue_based selects the normalization of the punctual stress
+std::vector<std::unique_ptr<OnlineAnalysis>> make_online_analyses(FDASettings const& fda_settings, bool residue_based);
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_ONLINEANALYSIS_H_ */
@@ -0,0 +1,109 @@
+#ifndef SRC_GROMACS_FDA_PAIRINDEX_H_
+#define SRC_GROMACS_FDA_PAIRINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace fda {
+
+/**
+ * Open-addressing hash map from the second atom index j to the position
+ * of the pair within a row of DistributedForces.
+ *
+ * The row itself keeps the insertion order of the pairs, this map is only used for the
+ * lookup, which is O(1) amortized instead of the linear search over all neighbours.
+ * Linear probing is used and the capacity is always a power of two with a load factor below 0.5.
+ */
+class PairIndex
+{
+public:
+
+    /// Returned by find if j is not stored
+    static const int npos = -1;
+
+    /// Default constructor
+    PairIndex()
+     : shift(32),
+       size(0)
+    {}
+
+    /// Return the position of j or npos
+    int find(int j) const
+    {
+        if (slots.empty()) return npos;
+        for (size_t h = hash(j);; h = (h + 1) & mask()) {
+            if (slots[h].j == j) return slots[h].position;
+            if (slots[h].j == npos) return npos;
+        }
+    }
+
+    /// Store position of j, j must not be stored before
+    void insert(int j, int position)
+    {
+        if (2 * (size + 1) > slots.size()) rehash(slots.empty() ? 64 : 2 * slots.size());
+        insert_nocheck(j, position);
+        ++size;
+    }
+
+    /// Remove all entries, but keep the capacity for the next frame
+    void clear()
+    {
+        if (size == 0) return;
+        std::fill(slots.begin(), slots.end(), Slot());
+        size = 0;
+    }
+
+private:
+
+    /// Key and value are stored together, so that a lookup touches a single cache line
+    struct Slot
+    {
+        Slot(int j = npos, int position = 0)
+         : j(j), position(position)
+        {}
+
+        /// Second atom index, npos marks an empty slot
+        int j;
+
+        /// Position of the pair in the row
+        int position;
+    };
+
+    size_t mask() const { return slots.size() - 1; }
+
+    /// Fibonacci hashing, the high bits of the product depend on all bits of j
+    size_t hash(int j) const { return (static_cast<uint32_t>(j) * 2654435769u) >> shift; }
+
+    void insert_nocheck(int j, int position)
+    {
+        size_t h = hash(j);
+        while (slots[h].j != npos) h = (h + 1) & mask();
+        slots[h] = Slot(j, position);
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old_slots(capacity);
+        old_slots.swap(slots);
+        shift = 32;
+        for (size_t c = capacity; c > 1; c >>= 1) --shift;
+        for (auto const& slot : old_slots) {
+            if (slot.j != npos) insert_nocheck(slot.j, slot.position);
+        }
+    }
+
+    /// Hash table, the capacity is a power of two
+    std::vector<Slot> slots;
+
+    /// 32 - log2(capacity), selects the high bits of the hash product
+    int shift;
+
+    /// Number of stored pairs
+    size_t size;
+
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_PAIRINDEX_H_ */
@@ -6,9 +6,9 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
 #include "gromacs/utility/fatalerror.h"
 #include "PairwiseForces.h"
@@ -18,96 +18,143 @@ namespace fda {
 template <typename ForceType>
 PairwiseForces<ForceType>::PairwiseForces(std::string const& filename)
  : filename(filename),
-   is_binary(false)
+   file(std::make_shared<MappedFile>(filename)),
+   is_binary(false),
+   is_compressed(false),
+   precision(0.0),
+   has_frame_index(false)
 {
-    std::ifstream file(filename);
-    if (!file) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-    char first_character;
-    file.read(&first_character, 1);
-    if (first_character == 'b') is_binary = true;
+    if (file->size() and *file->begin() == 'b') is_binary = true;
+    if (file->size() and *file->begin() == 'c') {
+        if (file->size() < 1 + sizeof(double)) gmx_fatal(FARGS, "Incomplete header of file %s", filename.c_str());
+        is_binary = true;
+        is_compressed = true;
+        precision = load_unaligned<double>(file->begin() + 1);
+    }
 }
 
 template <typename ForceType>
-size_t PairwiseForces<ForceType>::get_number_of_frames() const
+FrameIndex const& PairwiseForces<ForceType>::get_frame_index() const
 {
-    size_t number_of_frames = 0;
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
-
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::write");
+    if (!has_frame_index) {
+        build_frame_index();
+        has_frame_index = true;
+    }
+    return frame_index;
+}
 
-        for (;;)
-        {
-            get_pairwise_forces_binary(is);
-            ++number_of_frames;
-            if (is.tellg() == length) break;
+template <typename ForceType>
+void PairwiseForces<ForceType>::build_frame_index() const
+{
+    char const* first = file->begin();
+    char const* last = file->end();
+
+    frame_index = FrameIndex();
+    if (this->is_compressed) {
+        if (frame_index.read(first, last)) return;
+
+        // Files of aborted runs have no index
+        char const* p = first + 1 + sizeof(double);
+        while (p != last) {
+            char const* q = CompressedPairwiseForcesFrame<ForceType>(p, last, precision).for_each([](int, int, ForceType const&){});
+            // Drop an incomplete last frame
+            if (!q) break;
+            frame_index.add(p - first);
+            p = q;
         }
-    } else {
-        std::ifstream file(filename);
-        if (!file) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        std::string line;
-        getline(file, line);
-        if (line != "pairwise_forces_scalar") gmx_fatal(FARGS, "Wrong file type.");
-
-        while (getline(file, line))
-        {
-            if (line.find("frame") != std::string::npos) {
-                ++number_of_frames;
+        frame_index.set_end_of_frames(p - first);
+    } else if (this->is_binary) {
+        if (frame_index.read(first, last)) return;
+
+        // Older files and files of aborted runs have no index
+        const std::ptrdiff_t row_header_size = 2 * sizeof(uint);
+        char const* p = first + 1;
+        while (last - p >= static_cast<std::ptrdiff_t>(sizeof(uint))) {
+            size_t nb_interactions = load_unaligned<uint>(p);
+            size_t n = 0;
+            char const* q = p + sizeof(uint);
+            while (n < nb_interactions and last - q >= row_header_size) {
+                PairwiseForceRow<ForceType> row(q);
+                if (row.size() == 0 or row.size() > (last - q - row_header_size) / PairwiseForceRow<ForceType>::record_size) break;
+                n += row.size();
+                q = row.end();
             }
+            // Drop an incomplete last frame
+            if (n != nb_interactions) break;
+            frame_index.add(p - first);
+            p = q;
         }
+        frame_index.set_end_of_frames(p - first);
+    } else {
+        char const* p = static_cast<char const*>(std::memchr(first, '\n', last - first));
+        std::string header(first, p ? p : last);
+        if (!header.empty() and header.back() == '\r') header.pop_back();
+        if (header != "pairwise_forces_scalar" and header != "pairwise_forces_vector")
+            gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::build_frame_index");
+
+        while (p and ++p != last) {
+            if (last - p >= 5 and std::strncmp(p, "frame", 5) == 0) frame_index.add(p - first);
+            p = static_cast<char const*>(std::memchr(p, '\n', last - p));
+        }
+        frame_index.set_end_of_frames(last - first);
     }
-    return number_of_frames;
 }
 
 template <typename ForceType>
-std::vector<std::vector<PairwiseForce<ForceType>>> PairwiseForces<ForceType>::get_all_pairwise_forces(bool sort) const
+PairwiseForcesFrame<ForceType> PairwiseForces<ForceType>::get_frame(size_t frame) const
 {
-    std::vector<std::vector<PairwiseForce<ForceType>>> all_pairwise_forces;
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
+    if (!this->is_binary or this->is_compressed) gmx_fatal(FARGS, "Frame views are only available for uncompressed binary files.");
+    FrameIndex const& index = get_frame_index();
+    if (frame >= index.size()) gmx_fatal(FARGS, "Frame not found.");
+    return PairwiseForcesFrame<ForceType>(file->begin() + index.get_begin(frame), file->begin() + index.get_end(frame));
+}
 
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
+template <typename ForceType>
+CompressedPairwiseForcesFrame<ForceType> PairwiseForces<ForceType>::get_compressed_frame(size_t frame) const
+{
+    FrameIndex const& index = get_frame_index();
+    if (frame >= index.size()) gmx_fatal(FARGS, "Frame not found.");
+    return CompressedPairwiseForcesFrame<ForceType>(file->begin() + index.get_begin(frame), file->begin() + index.get_end(frame), precision);
+}
 
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
+template <typename ForceType>
+TextParser PairwiseForces<ForceType>::get_text_frame(size_t frame) const
+{
+    FrameIndex const& index = get_frame_index();
+    if (frame >= index.size()) gmx_fatal(FARGS, "Frame not found.");
+    TextParser parser(file->begin() + index.get_begin(frame), file->begin() + index.get_end(frame));
+    parser.next_line();
+    return parser;
+}
 
-        for (;;)
-        {
-            auto&& pairwise_forces = get_pairwise_forces_binary(is);
-            if (sort) this->sort(pairwise_forces);
-            all_pairwise_forces.push_back(pairwise_forces);
-            if (is.tellg() == length) break;
-        }
-    } else {
-        std::ifstream is(filename);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
+template <typename ForceType>
+size_t PairwiseForces<ForceType>::get_number_of_frames() const
+{
+    return get_frame_index().size();
+}
 
-        std::string token;
-        is >> token;
-        if (token != "pairwise_forces_scalar" and token != "pairwise_forces_vector") gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-        is >> token >> token;
+template <typename ForceType>
+std::vector<PairwiseForce<ForceType>> PairwiseForces<ForceType>::get_pairwise_forces(size_t frame) const
+{
+    std::vector<PairwiseForce<ForceType>> pairwise_forces;
+    if (this->is_binary and !this->is_compressed) pairwise_forces.reserve(get_frame(frame).get_number_of_interactions());
+    for_each_pairwise_force(frame, [&](int i, int j, ForceType const& force) {
+        pairwise_forces.push_back(PairwiseForce<ForceType>(i, j, force));
+    });
+    return pairwise_forces;
+}
 
-        for (;;)
-        {
-            auto&& pairwise_forces = get_pairwise_forces(is);
-            if (pairwise_forces.empty()) break;
-            if (sort) this->sort(pairwise_forces);
-            all_pairwise_forces.push_back(pairwise_forces);
-        }
+template <typename ForceType>
+std::vector<std::vector<PairwiseForce<ForceType>>> PairwiseForces<ForceType>::get_all_pairwise_forces(bool sort) const
+{
+    std::vector<std::vector<PairwiseForce<ForceType>>> all_pairwise_forces;
+    size_t nb_frames = get_number_of_frames();
+    all_pairwise_forces.reserve(nb_frames);
+    for (size_t frame = 0; frame != nb_frames; ++frame)
+    {
+        auto&& pairwise_forces = get_pairwise_forces(frame);
+        if (sort) this->sort(pairwise_forces);
+        all_pairwise_forces.push_back(pairwise_forces);
     }
     return all_pairwise_forces;
 }
@@ -127,47 +174,16 @@ template <typename ForceType>
 size_t PairwiseForces<ForceType>::get_max_index_second_column_first_frame() const
 {
     int max_index = 0;
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
-
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-
-        for (;;)
-        {
-            auto&& pairwise_forces = get_pairwise_forces_binary(is);
-            for (auto&& pf : pairwise_forces)
-            	if (pf.j > max_index) max_index = pf.j;
-            if (is.tellg() == length) break;
-        }
-    } else {
-        std::ifstream file(filename);
-        if (!file) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        std::string line;
-        int i, j;
-
-        getline(file, line);
-        if (line != "pairwise_forces_scalar") gmx_fatal(FARGS, "Wrong file type.");
-
-        getline(file, line); // skip frame line
-
-        while (getline(file, line))
-        {
-            if (line.find("frame") != std::string::npos) break;
+    auto max_j = [&max_index](int, int j, ForceType const&) {
+        if (j > max_index) max_index = j;
+    };
 
-            std::stringstream ss(line);
-            ss >> i >> j;
-
-            if (j > max_index) max_index = j;
-        }
+    // All frames are considered for binary files
+    size_t nb_frames = get_number_of_frames();
+    if (this->is_binary) {
+        for (size_t frame = 0; frame != nb_frames; ++frame) for_each_pairwise_force(frame, max_j);
+    } else if (nb_frames) {
+        for_each_pairwise_force(0, max_j);
     }
     return max_index;
 }
@@ -176,233 +192,83 @@ template <>
 std::vector<double> PairwiseForces<Force<real>>::get_forcematrix_of_frame(int nbParticles, int frame) const
 {
     std::vector<double> forcematrix(nbParticles * nbParticles, 0.0);
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
-
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-
-        int cur_frame = 0;
-        bool foundFrame = false;
-
-        for (;;)
-        {
-            auto&& pairwise_forces = get_pairwise_forces_binary(is);
-            if (cur_frame == frame) {
-				for (auto&& pf : pairwise_forces) {
-					forcematrix[pf.i*nbParticles + pf.j] = pf.force.force;
-					forcematrix[pf.j*nbParticles + pf.i] = pf.force.force;
-				}
-                foundFrame = true;
-            }
-            ++cur_frame;
-            if (is.tellg() == length) break;
-        }
-        if (!foundFrame) gmx_fatal(FARGS, "Frame not found.");
-    } else {
-        std::ifstream is(filename);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        std::string token;
-        is >> token;
-        if (token != "pairwise_forces_scalar" and token != "pairwise_forces_vector")
-        	gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-
-        std::string line;
-        bool foundFrame = false;
-        int frameNumber;
-        int i, j;
-        real value;
-
-        while (getline(is, line))
-        {
-            if (line.find("frame") != std::string::npos)
-            {
-                if (foundFrame) break;
-                std::istringstream iss(line);
-                iss >> token >> frameNumber;
-                if (frameNumber != frame) continue;
-                foundFrame = true;
-                continue;
-            }
-            if (foundFrame) {
-                std::istringstream iss(line);
-                iss >> i >> j >> value;
-                if (i >= nbParticles or j >= nbParticles)
-                    gmx_fatal(FARGS, "Index is larger than dimension.");
-                forcematrix[i*nbParticles+j] = value;
-                forcematrix[j*nbParticles+i] = value;
-            }
-        }
-        if (!foundFrame) gmx_fatal(FARGS, "Frame not found.");
-    }
+    if (frame < 0) gmx_fatal(FARGS, "Frame not found.");
+
+    for_each_pairwise_force(frame, [&](int i, int j, Force<real> const& force) {
+        if (i >= nbParticles or j >= nbParticles)
+            gmx_fatal(FARGS, "Index is larger than dimension.");
+        forcematrix[i*nbParticles + j] = force.force;
+        forcematrix[j*nbParticles + i] = force.force;
+    });
     return forcematrix;
 }
 
-template <typename ForceType>
-std::vector<double> PairwiseForces<ForceType>::get_averaged_forcematrix(int nbParticles) const
+template <>
+ForceMatrix PairwiseForces<Force<real>>::get_sparse_forcematrix_of_frame(int nbParticles, int frame) const
 {
-    std::vector<double> forcematrix(nbParticles * nbParticles, 0.0);
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        // get length of file:
-        is.seekg (0, is.end);
-        //int length = is.tellg();
-        is.seekg (0, is.beg);
-
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-
-        gmx_fatal(FARGS, "Not implemented yet");
+    if (frame < 0) gmx_fatal(FARGS, "Frame not found.");
+
+    std::vector<ForceMatrixEntry> entries;
+    if (this->is_binary and !this->is_compressed) entries.reserve(2 * get_frame(frame).get_number_of_interactions());
+    for_each_pairwise_force(frame, [&](int i, int j, Force<real> const& force) {
+        if (i >= nbParticles or j >= nbParticles)
+            gmx_fatal(FARGS, "Index is larger than dimension.");
+        entries.push_back(ForceMatrixEntry(i, j, force.force));
+        entries.push_back(ForceMatrixEntry(j, i, force.force));
+    });
+    return ForceMatrix(nbParticles, entries);
+}
 
-    } else {
-        std::ifstream is(filename);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        std::string token;
-        is >> token;
-        if (token != "pairwise_forces_scalar" and token != "pairwise_forces_vector")
-        	gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::get_all_pairwise_forces");
-
-        std::string line;
-        int numberOfFrames = 0;
-        int i, j;
-        real value;
-
-		while (getline(is, line))
-		{
-			if (line.find("frame") != std::string::npos) {
-				++numberOfFrames;
-				continue;
-			}
-			std::istringstream iss(line);
-			iss >> i >> j >> value;
-			if (i < 0 or i >= nbParticles or j < 0 or j >= nbParticles)
-				gmx_fatal(FARGS, "Index error in getAveragedForcematrix.");
-			forcematrix[i*nbParticles+j] = value;
-		}
-
-		if (!numberOfFrames) gmx_fatal(FARGS, "No frame found.");
-		for (auto & elem : forcematrix) elem /= numberOfFrames;
-    }
+template <>
+std::vector<double> PairwiseForces<Force<real>>::get_averaged_forcematrix(int nbParticles) const
+{
+    int nb_frames = get_number_of_frames();
+    if (!nb_frames) gmx_fatal(FARGS, "No frame found.");
 
+    std::vector<double> forcematrix;
+    ForceMatrixReducer reducer(FrameReduction::BLOCK_MEAN, nb_frames);
+    reduce_forcematrices(nbParticles, reducer, [](int, ForceMatrix&){},
+        [&forcematrix](int, ForceMatrix const& mean) { forcematrix = mean.to_dense(); });
     return forcematrix;
 }
 
 template <typename ForceType>
 void PairwiseForces<ForceType>::write(std::string const& out_filename, bool out_binary) const
 {
+    size_t nb_frames = get_number_of_frames();
     if (this->is_binary == true and out_binary == false) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
-
         std::ofstream os(out_filename);
         if (!os) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
 
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::write");
-
-        os << "pairwise_forces_scalar\n";
+        if (NumberOfComponents<decltype(ForceType().force)>::value == 1) os << "pairwise_forces_scalar\n";
+        else os << "pairwise_forces_vector\n";
 
-        int frame = 0;
-        for (;;)
+        for (size_t frame = 0; frame != nb_frames; ++frame)
         {
-            auto&& pairwise_forces = get_pairwise_forces_binary(is);
-            write_pairwise_forces(os, pairwise_forces, frame);
-            if (is.tellg() == length) break;
-            ++frame;
+            write_pairwise_forces(os, get_pairwise_forces(frame), frame);
         }
     } else if (this->is_binary == false and out_binary == true) {
-        std::ifstream is(filename);
-        if (!is) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
-
         std::ofstream os(out_filename, std::ifstream::binary);
         if (!os) gmx_fatal(FARGS, "Error opening file %s", filename.c_str());
 
-        std::string token;
-        is >> token;
-        if (token != "pairwise_forces_scalar") gmx_fatal(FARGS, "Wrong file type in PairwiseForces<ForceType>::write");
-        is >> token >> token;
-
         char b = 'b';
         os.write(&b, 1);
 
-        for (;;)
+        FrameIndex out_frame_index;
+        for (size_t frame = 0; frame != nb_frames; ++frame)
         {
-            auto&& pairwise_forces = get_pairwise_forces(is);
-            if (pairwise_forces.empty()) break;
-            write_pairwise_forces_binary(os, pairwise_forces);
+            out_frame_index.add(os.tellp());
+            write_pairwise_forces_binary(os, get_pairwise_forces(frame));
         }
+        out_frame_index.set_end_of_frames(os.tellp());
+        out_frame_index.write(os);
     } else {
         gmx_fatal(FARGS, "Wrong binary mode in PairwiseForces<ForceType>::write");
     }
 }
 
 template <typename ForceType>
-std::vector<PairwiseForce<ForceType>> PairwiseForces<ForceType>::get_pairwise_forces(std::ifstream& is) const
-{
-    int i, j;
-    ForceType force;
-    std::vector<PairwiseForce<ForceType>> pairwise_forces;
-    std::string token;
-    while (is >> token)
-    {
-        if (token == "frame") {
-            is >> token;
-            return pairwise_forces;
-        }
-
-        try {
-           i = std::stoi(token);
-        } catch ( ... ) {
-            std::cerr << token << std::endl;
-            throw;
-        }
-
-        is >> j >> force;
-        pairwise_forces.push_back(PairwiseForce<ForceType>(i,j,force));
-    }
-    return pairwise_forces;
-}
-
-template <typename ForceType>
-std::vector<PairwiseForce<ForceType>> PairwiseForces<ForceType>::get_pairwise_forces_binary(std::ifstream& is) const
-{
-    int i, j, nb_interaction, nb_interactions_of_i, type;
-    real force;
-    std::vector<PairwiseForce<ForceType>> pairwise_forces;
-    is.read(reinterpret_cast<char*>(&nb_interaction), sizeof(uint));
-    for (int n = 0; n != nb_interaction;) {
-        is.read(reinterpret_cast<char*>(&i), sizeof(uint));
-        is.read(reinterpret_cast<char*>(&nb_interactions_of_i), sizeof(uint));
-        for (int m = 0; m != nb_interactions_of_i; ++m, ++n) {
-            is.read(reinterpret_cast<char*>(&j), sizeof(uint));
-            is.read(reinterpret_cast<char*>(&force), sizeof(real));
-            is.read(reinterpret_cast<char*>(&type), sizeof(uint));
-            pairwise_forces.push_back(PairwiseForce<ForceType>(i, j, ForceType(force, type)));
-        }
-    }
-    return pairwise_forces;
-}
-
-template <typename ForceType>
-void PairwiseForces<ForceType>::write_pairwise_forces(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces, int frame) const
+void PairwiseForces<ForceType>::write_pairwise_forces(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces, int frame)
 {
     os << "frame " << frame << "\n";
     for (auto&& pf : pairwise_forces) {
@@ -412,8 +278,9 @@ void PairwiseForces<ForceType>::write_pairwise_forces(std::ofstream& os, std::ve
 }
 
 template <typename ForceType>
-void PairwiseForces<ForceType>::write_pairwise_forces_binary(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces) const
+void PairwiseForces<ForceType>::write_pairwise_forces_binary(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces)
 {
+    const int nb_components = NumberOfComponents<decltype(ForceType().force)>::value;
     uint nb_interaction = pairwise_forces.size();
     os.write(reinterpret_cast<char*>(&nb_interaction), sizeof(uint));
     auto&& iter_end = pairwise_forces.end();
@@ -428,7 +295,7 @@ void PairwiseForces<ForceType>::write_pairwise_forces_binary(std::ofstream& os,
         os.write(reinterpret_cast<char*>(&nb_interactions_of_i), sizeof(uint));
         for (; iter != iter2; ++iter) {
             os.write(reinterpret_cast<const char*>(&iter->j), sizeof(uint));
-            os.write(reinterpret_cast<const char*>(&iter->force.force), sizeof(real));
+            os.write(reinterpret_cast<const char*>(get_components(iter->force.force)), nb_components * sizeof(real));
             os.write(reinterpret_cast<const char*>(&iter->force.type), sizeof(uint));
         }
         --iter;
@@ -8,10 +8,17 @@
 #ifndef SRC_GROMACS_FDA_PAIRWISEFORCES_H_
 #define SRC_GROMACS_FDA_PAIRWISEFORCES_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "gromacs/fda/Force.h"
+#include "gromacs/fda/ForceMatrix.h"
+#include "gromacs/fda/ForceMatrixReducer.h"
+#include "gromacs/fda/FrameIndex.h"
+#include "gromacs/fda/FrameView.h"
+#include "gromacs/fda/MappedFile.h"
 #include "gromacs/fda/Vector.h"
+#include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/real.h"
 
 namespace fda {
@@ -55,17 +62,21 @@ std::ostream& operator << (std::ostream& os, std::vector<PairwiseForce<ForceType
 
 /**
  * Read pairwise forces from file into arrays and compare.
+ *
+ * The file is memory mapped. Single frames are accessed with for_each_pairwise_force
+ * or as view into the binary file with get_frame, without copying the frame.
  */
 template <typename ForceType>
 struct PairwiseForces
 {
     PairwiseForces(std::string const& filename);
 
+    /// If sort is true, the order of the pairwise forces within a frame is not compared
     template <class Comparer>
-    bool equal(PairwiseForces const& other, Comparer const& comparer) const
+    bool equal(PairwiseForces const& other, Comparer const& comparer, bool sort = false) const
     {
-        std::vector<std::vector<PairwiseForce<ForceType>>> pfl1 = this->get_all_pairwise_forces();
-        std::vector<std::vector<PairwiseForce<ForceType>>> pfl2 = other.get_all_pairwise_forces();
+        std::vector<std::vector<PairwiseForce<ForceType>>> pfl1 = this->get_all_pairwise_forces(sort);
+        std::vector<std::vector<PairwiseForce<ForceType>>> pfl2 = other.get_all_pairwise_forces(sort);
 
         if (pfl1.size() != pfl2.size()) return false;
 
@@ -101,26 +112,98 @@ struct PairwiseForces
     /// atom/residues. Can read a single frame given by the argument frame.
     std::vector<double> get_forcematrix_of_frame(int nbParticles, int frame) const;
 
+    /// Return the force matrix of a frame in sparse format.
+    /// Same values as get_forcematrix_of_frame, but only interacting pairs are stored.
+    ForceMatrix get_sparse_forcematrix_of_frame(int nbParticles, int frame) const;
+
     /// Parse a file in the scalar format which contains a given number of
     /// atom/residues. Returns average over all frames.
     std::vector<double> get_averaged_forcematrix(int nbParticles) const;
 
+    /// Stream the force matrices through reducer with a single pass over the frames.
+    /// prepare(frame, force_matrix) is applied to each frame before the reduction,
+    /// f(first_frame, force_matrix) is called for each reduced force matrix.
+    template <class Prepare, class Function>
+    void reduce_forcematrices(int nbParticles, ForceMatrixReducer& reducer, Prepare&& prepare, Function&& f) const
+    {
+        int nb_frames = get_number_of_frames();
+        for (int frame = 0; frame < nb_frames; ++frame) {
+            if (!reducer.is_needed(frame)) continue;
+            ForceMatrix force_matrix = get_sparse_forcematrix_of_frame(nbParticles, frame);
+            prepare(frame, force_matrix);
+            if (reducer.add(frame, force_matrix)) f(reducer.get_first_frame(), reducer.get_result());
+        }
+        if (reducer.finish()) f(reducer.get_first_frame(), reducer.get_result());
+    }
+
     /// Write all pairwise forces to file
     void write(std::string const& filename, bool binary = false) const;
 
     /// Returns true if the format is binary
     bool get_is_binary() const { return is_binary; }
 
+    /// Returns true if the binary frames are compressed
+    bool get_is_compressed() const { return is_compressed; }
+
+    /// Return the offsets of all frames.
+    /// The trailing index of a binary file is read at the first call,
+    /// for text files and binary files without index the file is scanned once.
+    FrameIndex const& get_frame_index() const;
+
+    /// Return a frame of an uncompressed binary file as view into the mapped file
+    PairwiseForcesFrame<ForceType> get_frame(size_t frame) const;
+
+    /// Call f(i, j, force) for all pairwise forces of a frame in the order of the file.
+    /// Binary frames are read directly from the mapped file and text frames are parsed in place,
+    /// so that no memory is allocated for the frame.
+    template <class Function>
+    void for_each_pairwise_force(size_t frame, Function&& f) const
+    {
+        if (this->is_compressed) {
+            get_compressed_frame(frame).for_each(f);
+        } else if (this->is_binary) {
+            for (auto&& row : get_frame(frame)) {
+                int i = row.get_i();
+                for (size_t k = 0; k != row.size(); ++k) f(i, row.get_j(k), row.get_force(k));
+            }
+        } else {
+            TextParser parser = get_text_frame(frame);
+            int i, j;
+            ForceType force;
+            while (!parser.empty()) {
+                if (!parser.end_of_line()) {
+                    if (!(parser.next(i) and parser.next(j) and parser.next(force)))
+                        gmx_fatal(FARGS, "Wrong format of frame %zu in file %s", frame, filename.c_str());
+                    f(i, j, force);
+                }
+                parser.next_line();
+            }
+        }
+    }
+
+    /// Write a frame in text format
+    static void write_pairwise_forces(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces, int frame);
+
+    /// Write a frame in binary format, pairwise forces with the same i must be consecutive
+    static void write_pairwise_forces_binary(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces);
+
 private:
 
+    /// Scan the file for the beginning of all frames
+    void build_frame_index() const;
+
+    /// Return the parser for the pairwise forces of a text frame behind the frame line
+    TextParser get_text_frame(size_t frame) const;
+
+    /// Return a frame of a compressed binary file
+    CompressedPairwiseForcesFrame<ForceType> get_compressed_frame(size_t frame) const;
+
+    /// Return all pairwise forces of a frame
+    std::vector<PairwiseForce<ForceType>> get_pairwise_forces(size_t frame) const;
+
     /// Sorting the pairwise forces by i, j, and type
     void sort(std::vector<PairwiseForce<ForceType>>& pairwise_forces) const;
 
-    std::vector<PairwiseForce<ForceType>> get_pairwise_forces(std::ifstream& is) const;
-    std::vector<PairwiseForce<ForceType>> get_pairwise_forces_binary(std::ifstream& is) const;
-
-    void write_pairwise_forces(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces, int frame) const;
-    void write_pairwise_forces_binary(std::ofstream& os, std::vector<PairwiseForce<ForceType>> const& pairwise_forces) const;
 
     /// Output stream
     friend std::ostream& operator << (std::ostream& os, PairwiseForces const& pf)
@@ -139,8 +222,23 @@ private:
 
     std::string filename;
 
+    /// Memory mapped file, shared by copies
+    std::shared_ptr<MappedFile> file;
+
     bool is_binary;
 
+    /// Compressed binary frames, see CompressedPairwiseForcesFrame
+    bool is_compressed;
+
+    /// Forces of compressed frames are stored in units of 1 / precision
+    double precision;
+
+    /// Offsets of all frames, built on first use
+    mutable FrameIndex frame_index;
+
+    /// True if frame_index is valid
+    mutable bool has_frame_index;
+
 };
 
 } // namespace fda
@@ -23,7 +23,8 @@ enum class ResultType : std::int8_t
     VIRIAL_STRESS,
     VIRIAL_STRESS_VON_MISES,
     COMPAT_BIN,               // DEPRICATED! compatibility mode (signed scalars) in binary
-    COMPAT_ASCII              // DEPRICATED! compatibility mode (signed scalars) in ascii
+    COMPAT_ASCII,             // DEPRICATED! compatibility mode (signed scalars) in ascii
+    FORCE_NETWORK             // pairwise forces are only kept in memory for the online analysis
 };
 
 /// Output stream for ResultType
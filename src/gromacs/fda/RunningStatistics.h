@@ -0,0 +1,80 @@
+#ifndef SRC_GROMACS_FDA_RUNNINGSTATISTICS_H_
+#define SRC_GROMACS_FDA_RUNNINGSTATISTICS_H_
+
+#include <algorithm>
+
+namespace fda {
+
+/**
+ * Mean, variance and extrema of a value over the frames of a time averaging period in a single pass
+ *
+ * The mean and the sum of squared differences are updated with Welford's algorithm.
+ * Pairs do not interact in all frames, only the frames with interaction are added.
+ * The missing frames are taken as zero when the statistics are evaluated for the total number of frames,
+ * using the combination of two samples by Chan et al.
+ */
+struct RunningStatistics
+{
+    RunningStatistics()
+     : n(0), m(0.0), m2(0.0), minimum(0.0), maximum(0.0)
+    {}
+
+    /// Add the value of a frame
+    void add(double value)
+    {
+        if (n == 0) {
+            minimum = value;
+            maximum = value;
+        } else {
+            minimum = std::min(minimum, value);
+            maximum = std::max(maximum, value);
+        }
+        ++n;
+        double delta = value - m;
+        m += delta / n;
+        m2 += delta * (value - m);
+    }
+
+    /// Mean over nframes frames
+    double mean(int nframes) const
+    {
+        return nframes ? m * n / nframes : 0.0;
+    }
+
+    /// Population variance over nframes frames
+    double variance(int nframes) const
+    {
+        return nframes ? (m2 + m * m * n * (nframes - n) / nframes) / nframes : 0.0;
+    }
+
+    /// Minimum over nframes frames
+    double min(int nframes) const
+    {
+        return n < nframes ? std::min(minimum, 0.0) : minimum;
+    }
+
+    /// Maximum over nframes frames
+    double max(int nframes) const
+    {
+        return n < nframes ? std::max(maximum, 0.0) : maximum;
+    }
+
+    /// Number of added frames
+    int n;
+
+    /// Mean of the added frames
+    double m;
+
+    /// Sum of squared differences from the mean of the added frames
+    double m2;
+
+    /// Minimum of the added frames
+    double minimum;
+
+    /// Maximum of the added frames
+    double maximum;
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_RUNNINGSTATISTICS_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -20,13 +21,93 @@ namespace fda {
 
 Stress::Stress(std::string const& filename)
  : filename(filename),
-   is_binary(false)
+   file(std::make_shared<MappedFile>(filename)),
+   is_binary(false),
+   syslen(0),
+   has_frame_index(false)
 {
-    std::ifstream file(filename);
-    if (!file) gmx_fatal(FARGS, "Error opening file.");
-    char first_character;
-    file.read(&first_character, 1);
-    if (first_character == 'b') is_binary = true;
+    if (file->size() and *file->begin() == 'b') {
+        is_binary = true;
+        if (file->size() < 1 + sizeof(uint)) gmx_fatal(FARGS, "Error reading file %s", filename.c_str());
+        syslen = load_unaligned<uint>(file->begin() + 1);
+    }
+}
+
+FrameIndex const& Stress::get_frame_index() const
+{
+    if (!has_frame_index) {
+        build_frame_index();
+        has_frame_index = true;
+    }
+    return frame_index;
+}
+
+void Stress::build_frame_index() const
+{
+    char const* first = file->begin();
+    char const* last = file->end();
+
+    frame_index = FrameIndex();
+    if (this->is_binary) {
+        if (frame_index.read(first, last)) return;
+
+        // Older files have no index, all frames have the full length
+        int64_t length = last - first;
+        int64_t offset = 1 + sizeof(uint);
+        int64_t frame_size = syslen * sizeof(real);
+        if (frame_size) {
+            for (; offset + frame_size <= length; offset += frame_size) frame_index.add(offset);
+        }
+        frame_index.set_end_of_frames(offset);
+    } else {
+        char const* p = static_cast<char const*>(std::memchr(first, '\n', last - first));
+        std::string header(first, p ? p : last);
+        if (!header.empty() and header.back() == '\r') header.pop_back();
+        if (header != "punctual_stress" and header != "virial_stress" and header != "virial_stress_von_mises")
+            gmx_fatal(FARGS, "Wrong file type in Stress::build_frame_index");
+
+        // Each line is a frame
+        while (p and ++p != last) {
+            frame_index.add(p - first);
+            p = static_cast<char const*>(std::memchr(p, '\n', last - p));
+        }
+        frame_index.set_end_of_frames(last - first);
+    }
+}
+
+size_t Stress::get_number_of_frames() const
+{
+    return get_frame_index().size();
+}
+
+StressFrame Stress::get_frame(size_t frame) const
+{
+    if (!this->is_binary) gmx_fatal(FARGS, "Frame views are only available for binary files.");
+    FrameIndex const& index = get_frame_index();
+    if (frame >= index.size()) gmx_fatal(FARGS, "Frame not found.");
+
+    // Trailing zeros may be omitted in indexed files
+    size_t nb_values = (index.get_end(frame) - index.get_begin(frame)) / sizeof(real);
+    if (nb_values > syslen) gmx_fatal(FARGS, "Corrupt frame %zu in file %s", frame, filename.c_str());
+    return StressFrame(file->begin() + index.get_begin(frame), nb_values, syslen);
+}
+
+Stress::StressType Stress::get_stress_of_frame(size_t frame) const
+{
+    StressType stress;
+    if (this->is_binary) {
+        StressFrame stress_frame = get_frame(frame);
+        stress.resize(stress_frame.size());
+        for (size_t i = 0; i != stress_frame.size(); ++i) stress[i] = stress_frame[i];
+    } else {
+        FrameIndex const& index = get_frame_index();
+        if (frame >= index.size()) gmx_fatal(FARGS, "Frame not found.");
+        TextParser parser(file->begin() + index.get_begin(frame), file->begin() + index.get_end(frame));
+        real value;
+        while (parser.next(value)) stress.push_back(value);
+        if (!parser.end_of_line()) gmx_fatal(FARGS, "Wrong format of frame %zu in file %s", frame, filename.c_str());
+    }
+    return stress;
 }
 
 void Stress::write(std::string const& out_filename, bool out_binary) const
@@ -39,11 +120,15 @@ void Stress::write(std::string const& out_filename, bool out_binary) const
         char b = 'b';
         os.write(&b, 1);
 
-        uint nb_atoms = stress_all_frames[0].size();
+        uint nb_atoms = stress_all_frames.empty() ? 0 : stress_all_frames[0].size();
         os.write(reinterpret_cast<char*>(&nb_atoms), sizeof(uint));
+        FrameIndex out_frame_index;
         for (auto&& stress : stress_all_frames) {
+            out_frame_index.add(os.tellp());
             os.write(reinterpret_cast<char*>(&stress[0]), nb_atoms * sizeof(real));
         }
+        out_frame_index.set_end_of_frames(os.tellp());
+        out_frame_index.write(os);
     } else {
         std::ofstream os(out_filename);
         if (!os) gmx_fatal(FARGS, "Error opening file.");
@@ -68,58 +153,11 @@ void Stress::write(std::string const& out_filename, bool out_binary) const
 
 Stress::StressFrameArrayType Stress::get_stress() const
 {
+    size_t nb_frames = get_number_of_frames();
     StressFrameArrayType stress_all_frames;
-    if (this->is_binary) {
-        std::ifstream is(filename, std::ifstream::binary);
-        if (!is) gmx_fatal(FARGS, "Error opening file.");
-
-        // get length of file:
-        is.seekg (0, is.end);
-        int length = is.tellg();
-        is.seekg (0, is.beg);
-
-        char first_character;
-        is.read(&first_character, 1);
-        if (first_character != 'b') gmx_fatal(FARGS, "Wrong file type in Stress::write");
-
-        uint syslen;
-        is.read(reinterpret_cast<char*>(&syslen), sizeof(uint));
-        StressType stress(syslen);
-        for (;;) {
-            is.read(reinterpret_cast<char*>(&stress[0]), syslen * sizeof(real));
-            stress_all_frames.push_back(stress);
-            if (is.tellg() == length) break;
-        }
-    } else {
-        std::ifstream is(filename);
-        if (!is) gmx_fatal(FARGS, "Error opening file.");
-
-        std::string line;
-        getline(is, line);
-        if (line != "punctual_stress" and line != "virial_stress" and line != "virial_stress_von_mises")
-        	gmx_fatal(FARGS, "Wrong file type in Stress::get_stress");
-
-        if (getline(is, line))
-        {
-            StressType stress;
-            std::stringstream ss(line);
-            real value;
-            while(ss >> value) {
-               stress.push_back(value);
-            }
-            stress_all_frames.push_back(stress);
-        }
-
-        while (getline(is, line))
-        {
-            StressType stress;
-            std::stringstream ss(line);
-            real value;
-            while(ss >> value) {
-               stress.push_back(value);
-            }
-            stress_all_frames.push_back(stress);
-        }
+    stress_all_frames.reserve(nb_frames);
+    for (size_t frame = 0; frame != nb_frames; ++frame) {
+        stress_all_frames.push_back(get_stress_of_frame(frame));
     }
     return stress_all_frames;
 }
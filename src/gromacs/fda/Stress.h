@@ -8,13 +8,18 @@
 #ifndef SRC_GROMACS_FDA_STRESS_H_
 #define SRC_GROMACS_FDA_STRESS_H_
 
+#include <memory>
 #include <string>
 #include <vector>
+#include "gromacs/fda/FrameIndex.h"
+#include "gromacs/fda/FrameView.h"
+#include "gromacs/fda/MappedFile.h"
 #include "gromacs/utility/real.h"
 
 namespace fda {
 
-/// Read and write punctual and virial stress files
+/// Read and write punctual and virial stress files,
+/// the file is memory mapped and frames are read on demand
 struct Stress
 {
 	typedef std::vector<real> StressType;
@@ -45,6 +50,20 @@ struct Stress
     /// Read stress from file
     StressFrameArrayType get_stress() const;
 
+    /// Return the number of frames
+    size_t get_number_of_frames() const;
+
+    /// Read the stress of a single frame, the file position is taken from the frame index
+    StressType get_stress_of_frame(size_t frame) const;
+
+    /// Return a frame of a binary file as view into the mapped file
+    StressFrame get_frame(size_t frame) const;
+
+    /// Return the offsets of all frames.
+    /// The trailing index of a binary file is read at the first call,
+    /// for text files and binary files without index the file is scanned once.
+    FrameIndex const& get_frame_index() const;
+
     /// Write stress to file
     void write(std::string const& out_filename, bool out_binary = false) const;
 
@@ -53,10 +72,25 @@ struct Stress
 
 private:
 
+    /// Scan the file for the beginning of all frames
+    void build_frame_index() const;
+
     std::string filename;
 
+    /// Memory mapped file, shared by copies
+    std::shared_ptr<MappedFile> file;
+
     bool is_binary;
 
+    /// Number of atoms or residues of a binary file
+    size_t syslen;
+
+    /// Offsets of all frames, built on first use
+    mutable FrameIndex frame_index;
+
+    /// True if frame_index is valid
+    mutable bool has_frame_index;
+
 };
 
 } // namespace fda
@@ -0,0 +1,61 @@
+#ifndef SRC_GROMACS_FDA_VARINT_H_
+#define SRC_GROMACS_FDA_VARINT_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace fda {
+
+/// Append unsigned integer with variable length, 7 bits per byte (LEB128).
+/// Small numbers need a single byte.
+inline void append_varint(std::string& buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+/// Write unsigned integer with variable length
+inline void write_varint(std::ostream& os, uint64_t value)
+{
+    char buffer[10];
+    int n = 0;
+    while (value >= 0x80) {
+        buffer[n++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer[n++] = static_cast<char>(value);
+    os.write(buffer, n);
+}
+
+/// Read unsigned integer with variable length starting at p.
+/// Returns the position behind the integer or nullptr if the input ends within the integer.
+inline char const* read_varint(char const* p, char const* last, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; p != last and shift < 64; shift += 7) {
+        unsigned char c = *p++;
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+/// Map signed to unsigned integers, so that numbers with small magnitude get small codes: 0, -1, 1, -2, ...
+inline uint64_t zigzag_encode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/// Inverse of zigzag_encode
+inline int64_t zigzag_decode(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_VARINT_H_ */
@@ -0,0 +1,93 @@
+#include <cmath>
+#include "config.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "VirialStress.h"
+
+namespace fda {
+
+namespace {
+
+/// Number of elements including the padding to the SIMD width
+int padded_size(int size)
+{
+#if GMX_SIMD_HAVE_REAL
+    return (size + GMX_SIMD_REAL_WIDTH - 1) / GMX_SIMD_REAL_WIDTH * GMX_SIMD_REAL_WIDTH;
+#else
+    return size;
+#endif
+}
+
+/// Add b to a and clear b
+void reduce_array(VirialStress::Array& a, VirialStress::Array& b)
+{
+    int const n = a.size();
+#if GMX_SIMD_HAVE_REAL
+    gmx::SimdReal const zero = gmx::setZero();
+    for (int i = 0; i < n; i += GMX_SIMD_REAL_WIDTH) {
+        gmx::store(a.data() + i, gmx::load<gmx::SimdReal>(a.data() + i) + gmx::load<gmx::SimdReal>(b.data() + i));
+        gmx::store(b.data() + i, zero);
+    }
+#else
+    for (int i = 0; i < n; ++i) {
+        a[i] += b[i];
+        b[i] = 0.0;
+    }
+#endif
+}
+
+} // namespace
+
+VirialStress::VirialStress(int size)
+ : nr(size),
+   xx(padded_size(size), 0.0),
+   yy(padded_size(size), 0.0),
+   zz(padded_size(size), 0.0),
+   xy(padded_size(size), 0.0),
+   xz(padded_size(size), 0.0),
+   yz(padded_size(size), 0.0)
+{}
+
+void VirialStress::reduce(VirialStress& other)
+{
+    reduce_array(xx, other.xx);
+    reduce_array(yy, other.yy);
+    reduce_array(zz, other.zz);
+    reduce_array(xy, other.xy);
+    reduce_array(xz, other.xz);
+    reduce_array(yz, other.yz);
+}
+
+std::vector<real> VirialStress::von_mises() const
+{
+    std::vector<real, gmx::AlignedAllocator<real>> result(xx.size());
+#if GMX_SIMD_HAVE_REAL
+    gmx::SimdReal const half(0.5);
+    gmx::SimdReal const six(6.0);
+    for (size_t i = 0; i < xx.size(); i += GMX_SIMD_REAL_WIDTH) {
+        gmx::SimdReal txx = gmx::load<gmx::SimdReal>(xx.data() + i);
+        gmx::SimdReal tyy = gmx::load<gmx::SimdReal>(yy.data() + i);
+        gmx::SimdReal tzz = gmx::load<gmx::SimdReal>(zz.data() + i);
+        gmx::SimdReal txy = gmx::load<gmx::SimdReal>(xy.data() + i);
+        gmx::SimdReal txz = gmx::load<gmx::SimdReal>(xz.data() + i);
+        gmx::SimdReal tyz = gmx::load<gmx::SimdReal>(yz.data() + i);
+        gmx::SimdReal dxy = txx - tyy;
+        gmx::SimdReal dyz = tyy - tzz;
+        gmx::SimdReal dzx = tzz - txx;
+        gmx::SimdReal shear = txy * txy + txz * txz + tyz * tyz;
+        gmx::SimdReal sum = gmx::fma(six, shear, dxy * dxy + dyz * dyz + dzx * dzx);
+        gmx::store(result.data() + i, gmx::sqrt(half * sum));
+    }
+#else
+    for (size_t i = 0; i < xx.size(); ++i) {
+        real dxy = xx[i] - yy[i];
+        real dyz = yy[i] - zz[i];
+        real dzx = zz[i] - xx[i];
+        result[i] = std::sqrt(0.5 * (dxy * dxy + dyz * dyz + dzx * dzx
+                              + 6 * (xy[i] * xy[i] + xz[i] * xz[i] + yz[i] * yz[i])));
+    }
+#endif
+    return std::vector<real>(result.begin(), result.begin() + nr);
+}
+
+} // namespace fda
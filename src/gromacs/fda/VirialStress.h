@@ -0,0 +1,54 @@
+#ifndef SRC_GROMACS_FDA_VIRIALSTRESS_H_
+#define SRC_GROMACS_FDA_VIRIALSTRESS_H_
+
+#include <vector>
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/real.h"
+
+namespace fda {
+
+/**
+ * Per-atom virial stress as symmetric tensors
+ *
+ * Only the six independent components are stored, each in a separate array (structure of arrays),
+ * which are padded to the SIMD width for the reduction and the von Mises conversion.
+ */
+class VirialStress
+{
+public:
+
+    typedef std::vector<real, gmx::AlignedAllocator<real>> Array;
+
+    VirialStress(int size = 0);
+
+    /// Add s * v to the virial stress of atom i, only the upper triangle of v is used
+    void add(int i, tensor v, real s)
+    {
+        xx[i] += s * v[XX][XX];
+        yy[i] += s * v[YY][YY];
+        zz[i] += s * v[ZZ][ZZ];
+        xy[i] += s * v[XX][YY];
+        xz[i] += s * v[XX][ZZ];
+        yz[i] += s * v[YY][ZZ];
+    }
+
+    /// Add the virial stress of other and clear it
+    void reduce(VirialStress& other);
+
+    /// Return the von Mises stress of all atoms
+    std::vector<real> von_mises() const;
+
+    /// Number of atoms
+    int size() const { return nr; }
+
+    /// Number of atoms
+    int nr;
+
+    /// Components of the tensors
+    Array xx, yy, zz, xy, xz, yz;
+};
+
+} // namespace fda
+
+#endif /* SRC_GROMACS_FDA_VIRIALSTRESS_H_ */
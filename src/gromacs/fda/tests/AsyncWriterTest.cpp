@@ -0,0 +1,55 @@
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <gtest/gtest.h>
+#include "gromacs/fda/AsyncWriter.h"
+
+namespace fda {
+
+TEST(AsyncWriterTest, Order)
+{
+    std::ostringstream os;
+    {
+        AsyncWriter writer;
+        for (int i = 0; i < 100; ++i) writer.push([&os, i]() { os << i << "\n"; });
+    }
+
+    std::ostringstream ref;
+    for (int i = 0; i < 100; ++i) ref << i << "\n";
+    EXPECT_EQ(ref.str(), os.str());
+}
+
+TEST(AsyncWriterTest, Wait)
+{
+    std::atomic<int> counter(0);
+    AsyncWriter writer;
+    for (int i = 0; i < 10; ++i) writer.push([&counter]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++counter;
+    });
+    writer.wait();
+    EXPECT_EQ(10, counter);
+}
+
+TEST(AsyncWriterTest, BackPressure)
+{
+    std::atomic<int> pending(0);
+    std::atomic<int> max_pending(0);
+    AsyncWriter writer(1);
+    for (int i = 0; i < 10; ++i) {
+        int p = ++pending;
+        if (p > max_pending) max_pending = p;
+        writer.push([&pending]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            --pending;
+        });
+    }
+    writer.wait();
+
+    // One task is executed and one is queued, the next push is blocked
+    EXPECT_LE(max_pending, 3);
+    EXPECT_EQ(0, pending);
+}
+
+} // namespace fda
@@ -0,0 +1,93 @@
+#include <sstream>
+#include <gtest/gtest.h>
+#include "gromacs/fda/BondedSlots.h"
+#include "gromacs/fda/DistributedForces.h"
+#include "gromacs/topology/ifunc.h"
+
+namespace fda {
+
+namespace {
+
+/// Local topology with one bond (0,1) and one angle (1,2,3)
+class BondedSlotsTest : public ::testing::Test
+{
+protected:
+
+    BondedSlotsTest()
+     : idef()
+    {
+        fda_settings.one_pair = OnePair::SUMMED;
+        fda_settings.syslen_atoms = 5;
+        fda_settings.sys_in_group1.assign(5, 1);
+        fda_settings.sys_in_group2.assign(5, 1);
+        fda_settings.atom_2_residue = {0, 0, 1, 1, 2};
+
+        idef.il[F_BONDS].nr = 3;
+        idef.il[F_BONDS].iatoms = bonds;
+        idef.il[F_ANGLES].nr = 4;
+        idef.il[F_ANGLES].iatoms = angles;
+    }
+
+    FDASettings fda_settings;
+    t_idef idef;
+    t_iatom bonds[3] = {0, 0, 1};
+    t_iatom angles[4] = {0, 3, 2, 1};
+};
+
+Vector make_vector(real x, real y, real z)
+{
+    rvec v = {x, y, z};
+    return Vector(v);
+}
+
+} // namespace
+
+TEST_F(BondedSlotsTest, find)
+{
+    BondedSlots slots(idef, fda_settings, true);
+
+    EXPECT_EQ(4U, slots.get_atom_pairs().size());
+    EXPECT_NE(BondedSlots::npos, slots.find(0, 1));
+    EXPECT_EQ(slots.find(0, 1), slots.find(1, 0));
+    EXPECT_NE(BondedSlots::npos, slots.find(1, 3));
+    EXPECT_NE(BondedSlots::npos, slots.find(2, 3));
+    EXPECT_EQ(BondedSlots::npos, slots.find(0, 2));
+    EXPECT_EQ(BondedSlots::npos, slots.find(3, 4));
+
+    // Pair (0,1) is within residue 0 and (2,3) within residue 1
+    EXPECT_EQ(BondedSlots::npos, slots.get_residue_slot(slots.find(0, 1)));
+    EXPECT_EQ(BondedSlots::npos, slots.get_residue_slot(slots.find(2, 3)));
+    EXPECT_EQ(slots.get_residue_slot(slots.find(1, 2)), slots.get_residue_slot(slots.find(1, 3)));
+    EXPECT_EQ(1U, slots.get_residue_pairs().size());
+}
+
+TEST_F(BondedSlotsTest, output_order)
+{
+    BondedSlots slots(idef, fda_settings, false);
+
+    DistributedForces forces(5, fda_settings);
+    forces.set_bonded_pairs(slots.get_atom_pairs());
+    DistributedForces reference_forces(5, fda_settings);
+
+    // Nonbonded pairs are added before the bonded ones
+    forces.add_summed(1, 4, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+    reference_forces.add_summed(1, 4, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+
+    forces.add_bonded(slots.find(2, 3), make_vector(0.0, 1.0, 0.0), InteractionType_ANGLE);
+    reference_forces.add_summed(2, 3, make_vector(0.0, 1.0, 0.0), InteractionType_ANGLE);
+    forces.add_bonded(slots.find(1, 3), make_vector(0.0, 0.0, 1.0), InteractionType_ANGLE);
+    reference_forces.add_summed(1, 3, make_vector(0.0, 0.0, 1.0), InteractionType_ANGLE);
+    forces.add_bonded(slots.find(0, 1), make_vector(1.0, 1.0, 0.0), InteractionType_BOND);
+    reference_forces.add_summed(0, 1, make_vector(1.0, 1.0, 0.0), InteractionType_BOND);
+    forces.add_bonded(slots.find(2, 3), make_vector(1.0, 0.0, 1.0), InteractionType_ANGLE);
+    reference_forces.add_summed(2, 3, make_vector(1.0, 0.0, 1.0), InteractionType_ANGLE);
+
+    forces.merge_bonded();
+
+    std::ostringstream result, reference;
+    forces.write_summed_vector(result);
+    reference_forces.write_summed_vector(reference);
+    EXPECT_EQ(reference.str(), result.str());
+}
+
+} // namespace fda
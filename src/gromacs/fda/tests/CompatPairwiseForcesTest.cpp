@@ -0,0 +1,129 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include "gromacs/fda/CompatPairwiseForces.h"
+#include "gromacs/fda/DistributedForces.h"
+#include "testutils/cmdlinetest.h"
+#include "testutils/testfilemanager.h"
+
+namespace fda
+{
+
+//! Test fixture for CompatPairwiseForces
+class CompatPairwiseForcesTest : public gmx::test::CommandLineTestBase
+{
+protected:
+
+    /// Write two frames in compat format version 2.0
+    void write_file(std::string const& filename, bool binary)
+    {
+        FDASettings fda_settings;
+        fda_settings.one_pair = OnePair::SUMMED;
+
+        // Pair keys are larger than the range of a 32-bit integer
+        DistributedForces forces(syslen, fda_settings);
+        gmx::HostVector<gmx::RVec> x(syslen);
+        for (int i = 0; i != syslen; ++i) x[i] = gmx::RVec(i, 0.0, 0.0);
+        matrix box = {{0.0}};
+        rvec f = {-3.0, -4.0, 0.0};
+
+        std::ofstream os(filename, std::ofstream::binary);
+        os << "<begin_block>\n"
+           << "version=2.0\n"
+           << "fmdim=" << syslen << "\n"
+           << "realsize=" << sizeof(real) << "\n"
+           << "keysize=8\n"
+           << "keyencoding=delta\n"
+           << "<end_block>\n";
+
+        for (int step = 0; step != 2; ++step) {
+            forces.clear();
+            forces.add_summed(70000, 99999, Vector(f), InteractionType_COULOMB);
+            forces.add_summed(5, 80000 + step, Vector(f), InteractionType_LJ);
+            forces.add_summed(5, 10, Vector(f), InteractionType_BOND);
+            if (binary) {
+                os.write(reinterpret_cast<const char *>(&step), sizeof(step));
+                forces.write_summed_compat(os, x, box, true);
+            } else {
+                os << "<begin_block>\n" << step << "\n";
+                forces.write_summed_compat(os, x, box, false);
+                os << "<end_block>\n";
+            }
+        }
+    }
+
+    void check(CompatPairwiseForces const& pf)
+    {
+        EXPECT_EQ("2.0", pf.get_version());
+        EXPECT_EQ(syslen, pf.get_dimension());
+        ASSERT_EQ(2, pf.get_number_of_frames());
+        EXPECT_EQ(1, pf.get_step(1));
+
+        auto pf_frame = pf.get_pairwise_forces(1);
+        ASSERT_EQ(3, pf_frame.size());
+        EXPECT_EQ(PairwiseForce<Force<real>>(5, 10, Force<real>(5.0, InteractionType_BOND)), pf_frame[0]);
+        EXPECT_EQ(PairwiseForce<Force<real>>(5, 80001, Force<real>(5.0, InteractionType_LJ)), pf_frame[1]);
+        EXPECT_EQ(PairwiseForce<Force<real>>(70000, 99999, Force<real>(5.0, InteractionType_COULOMB)), pf_frame[2]);
+    }
+
+    const int syslen = 100000;
+};
+
+TEST_F(CompatPairwiseForcesTest, Text)
+{
+    std::string filename = fileManager().getTemporaryFilePath("compat.pfa");
+    write_file(filename, false);
+
+    ASSERT_TRUE(CompatPairwiseForces::is_compat(filename));
+    CompatPairwiseForces pf(filename);
+    EXPECT_FALSE(pf.get_is_binary());
+    check(pf);
+}
+
+TEST_F(CompatPairwiseForcesTest, Binary)
+{
+    std::string filename = fileManager().getTemporaryFilePath("compat_binary.pfa");
+    write_file(filename, true);
+
+    CompatPairwiseForces pf(filename);
+    EXPECT_TRUE(pf.get_is_binary());
+    check(pf);
+
+    // Conversion into the scalar format
+    std::string scalar_filename = fileManager().getTemporaryFilePath("scalar.pfa");
+    pf.write(scalar_filename, true);
+    auto pf_all = PairwiseForces<Force<real>>(scalar_filename).get_all_pairwise_forces();
+    ASSERT_EQ(2, pf_all.size());
+    EXPECT_EQ(pf.get_pairwise_forces(1), pf_all[1]);
+}
+
+TEST_F(CompatPairwiseForcesTest, Version15)
+{
+    std::string filename = fileManager().getTemporaryFilePath("compat_15.pfa");
+    {
+        std::ofstream os(filename);
+        os << "<begin_block>\n"
+           << "; Forcemat version 1.5\n"
+           << "version=1.5\n"
+           << "fmdim=20\n"
+           << "intsize=4\n"
+           << "realsize=4\n"
+           << "<end_block>\n"
+           << "<begin_block>\n"
+           << "0\n"
+           << "2\n"
+           << "3 1 \n"
+           << "79 22 \n"
+           << "1.5 -2.5 \n"
+           << "6 1 \n"
+           << "<end_block>\n";
+    }
+
+    CompatPairwiseForces pf(filename);
+    ASSERT_EQ(1, pf.get_number_of_frames());
+    auto pf_frame = pf.get_pairwise_forces(0);
+    ASSERT_EQ(2, pf_frame.size());
+    EXPECT_EQ(PairwiseForce<Force<real>>(1, 2, Force<real>(-2.5, InteractionType_BOND)), pf_frame[0]);
+    EXPECT_EQ(PairwiseForce<Force<real>>(3, 19, Force<real>(1.5, InteractionType_COULOMB)), pf_frame[1]);
+}
+
+} // namespace fda
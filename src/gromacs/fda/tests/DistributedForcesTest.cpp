@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <gtest/gtest.h>
+#include "gromacs/fda/DistributedForces.h"
+#include "gromacs/fda/PairwiseForces.h"
+#include "testutils/testfilemanager.h"
+
+namespace fda {
+
+namespace {
+
+Vector make_vector(real x, real y, real z)
+{
+    rvec v = {x, y, z};
+    return Vector(v);
+}
+
+/// Former vector-of-vectors layout with linear search, used as reference for the ordering
+struct LinearSearchForces
+{
+    LinearSearchForces(int syslen)
+     : indices(syslen), summed(syslen)
+    {}
+
+    void add_summed(int i, int j, Vector const& force, InteractionType type)
+    {
+        auto & indices_i = indices[i];
+        auto iter = std::find(indices_i.begin(), indices_i.end(), j);
+        if (iter == indices_i.end()) {
+            indices_i.push_back(j);
+            summed[i].push_back(Force<Vector>(force, type));
+        } else {
+            summed[i][std::distance(indices_i.begin(), iter)] += Force<Vector>(force, type);
+        }
+    }
+
+    void write_summed_vector(std::ostream& os) const
+    {
+        for (size_t i = 0; i != summed.size(); ++i) {
+            for (size_t p = 0; p != summed[i].size(); ++p) {
+                Vector const& force = summed[i][p].force;
+                os << i << " " << indices[i][p] << " "
+                   << force[XX] << " " << force[YY] << " " << force[ZZ] << " "
+                   << summed[i][p].type << std::endl;
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> indices;
+    std::vector<std::vector<Force<Vector>>> summed;
+};
+
+/// Random pairs (i,j) with i < j, every pair is hit several times
+std::vector<std::pair<int, int>> random_pairs(int syslen, int neighbours, int repeats)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(1, syslen - 1);
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i != syslen; ++i) {
+        for (int n = 0; n != neighbours; ++n) {
+            int j = dist(gen);
+            if (i < j) pairs.push_back(std::make_pair(i, j));
+            else if (j < i) pairs.push_back(std::make_pair(j, i));
+        }
+    }
+    std::vector<std::pair<int, int>> result;
+    for (int r = 0; r != repeats; ++r) {
+        std::shuffle(pairs.begin(), pairs.end(), gen);
+        result.insert(result.end(), pairs.begin(), pairs.end());
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(DistributedForcesTest, insertion_order)
+{
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::SUMMED;
+
+    const int syslen = 200;
+    DistributedForces forces(syslen, fda_settings);
+    LinearSearchForces reference_forces(syslen);
+
+    // Run twice to check that clear resets the pair index
+    for (int frame = 0; frame != 2; ++frame) {
+        forces.clear();
+        reference_forces = LinearSearchForces(syslen);
+        for (auto const& p : random_pairs(syslen, 100, 3)) {
+            Vector force = make_vector(p.first, p.second, 1.0);
+            forces.add_summed(p.first, p.second, force, InteractionType_COULOMB);
+            reference_forces.add_summed(p.first, p.second, force, InteractionType_COULOMB);
+        }
+        std::ostringstream result, reference;
+        forces.write_summed_vector(result);
+        reference_forces.write_summed_vector(reference);
+        EXPECT_EQ(reference.str(), result.str());
+    }
+}
+
+TEST(DistributedForcesTest, add_row_summed)
+{
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::SUMMED;
+
+    DistributedForces master(3, fda_settings);
+    master.add_summed(0, 1, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+    master.add_summed(0, 2, make_vector(2.0, 0.0, 0.0), InteractionType_COULOMB);
+
+    DistributedForces thread(3, fda_settings);
+    thread.add_summed(0, 2, make_vector(0.5, 0.0, 0.0), InteractionType_LJ);
+    thread.add_summed(1, 2, make_vector(3.0, 0.0, 0.0), InteractionType_BOND);
+
+    for (int i = 0; i != 3; ++i) master.add_row(i, thread);
+
+    std::ostringstream result, reference;
+    master.write_summed_vector(result);
+
+    DistributedForces serial(3, fda_settings);
+    serial.add_summed(0, 1, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+    serial.add_summed(0, 2, make_vector(2.0, 0.0, 0.0), InteractionType_COULOMB);
+    serial.add_summed(0, 2, make_vector(0.5, 0.0, 0.0), InteractionType_LJ);
+    serial.add_summed(1, 2, make_vector(3.0, 0.0, 0.0), InteractionType_BOND);
+    serial.write_summed_vector(reference);
+
+    EXPECT_EQ(reference.str(), result.str());
+}
+
+TEST(DistributedForcesTest, add_row_detailed)
+{
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::DETAILED;
+
+    DistributedForces master(2, fda_settings);
+    master.add_detailed(0, 1, make_vector(1.0, 0.0, 0.0), PureInteractionType::COULOMB);
+
+    DistributedForces thread(2, fda_settings);
+    thread.add_detailed(0, 1, make_vector(0.0, 1.0, 0.0), PureInteractionType::COULOMB);
+    thread.add_detailed(0, 1, make_vector(0.0, 0.0, 1.0), PureInteractionType::LJ);
+
+    for (int i = 0; i != 2; ++i) master.add_row(i, thread);
+
+    std::ostringstream result, reference;
+    master.write_detailed_vector(result);
+
+    DistributedForces serial(2, fda_settings);
+    serial.add_detailed(0, 1, make_vector(1.0, 0.0, 0.0), PureInteractionType::COULOMB);
+    serial.add_detailed(0, 1, make_vector(0.0, 1.0, 0.0), PureInteractionType::COULOMB);
+    serial.add_detailed(0, 1, make_vector(0.0, 0.0, 1.0), PureInteractionType::LJ);
+    serial.write_detailed_vector(reference);
+
+    EXPECT_EQ(reference.str(), result.str());
+}
+
+TEST(DistributedForcesTest, write_scalar_binary)
+{
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::SUMMED;
+    FDASettings fda_settings_binary = fda_settings;
+    fda_settings_binary.binary_result_file = true;
+
+    gmx::HostVector<gmx::RVec> x(4, gmx::RVec(0.0, 0.0, 0.0));
+    x[1][XX] = 1.0;
+    x[2][YY] = 1.0;
+    x[3][ZZ] = 1.0;
+    matrix box = {{10.0, 0.0, 0.0}, {0.0, 10.0, 0.0}, {0.0, 0.0, 10.0}};
+
+    // The summed pairs of the last frame differ from the scalar pairs
+    auto fill = [&](DistributedForces& forces) {
+        forces.add_summed(0, 1, make_vector(3.0, 4.0, 0.0), InteractionType_COULOMB);
+        forces.add_summed(0, 2, make_vector(0.0, 2.0, 0.0), InteractionType_LJ);
+        forces.add_summed(1, 3, make_vector(1.0, 0.0, 0.0), InteractionType_BOND);
+        forces.summed_merge_to_scalar(x, box);
+        forces.clear();
+        forces.add_summed(0, 3, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+        forces.add_summed(0, 1, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+        forces.add_summed(1, 2, make_vector(1.0, 0.0, 0.0), InteractionType_COULOMB);
+    };
+
+    gmx::test::TestFileManager fileManager;
+    std::string text_filename = fileManager.getTemporaryFilePath("scalar.pfa");
+    std::string binary_filename = fileManager.getTemporaryFilePath("scalar_binary.pfa");
+
+    DistributedForces forces(4, fda_settings);
+    fill(forces);
+    {
+        std::ofstream os(text_filename);
+        os << std::scientific << std::setprecision(6);
+        os << ResultType::PAIRWISE_FORCES_SCALAR << std::endl << "frame 0" << std::endl;
+        forces.write_scalar(os);
+    }
+
+    DistributedForces forces_binary(4, fda_settings_binary);
+    fill(forces_binary);
+    {
+        std::ofstream os(binary_filename, std::ofstream::binary);
+        char b = 'b';
+        os.write(&b, 1);
+        forces_binary.write_scalar(os);
+    }
+
+    auto&& pf_text = PairwiseForces<Force<real>>(text_filename).get_all_pairwise_forces();
+    auto&& pf_binary = PairwiseForces<Force<real>>(binary_filename).get_all_pairwise_forces();
+    ASSERT_EQ(1, pf_text.size());
+    ASSERT_EQ(3, pf_text[0].size());
+    EXPECT_EQ(2, pf_text[0][1].j);
+    EXPECT_EQ(3, pf_text[0][2].j);
+    EXPECT_TRUE(pf_text == pf_binary);
+}
+
+TEST(DistributedForcesTest, time_averages_statistics)
+{
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::SUMMED;
+    fda_settings.time_averages_statistics = true;
+
+    DistributedForces forces(3, fda_settings);
+    gmx::HostVector<gmx::RVec> x(3);
+    for (int i = 0; i != 3; ++i) x[i] = gmx::RVec(i, 0.0, 0.0);
+    matrix box = {{0.0}};
+
+    // Repulsive forces, pair (1,2) does not interact in the second frame
+    forces.add_summed(0, 1, make_vector(-1.0, 0.0, 0.0), InteractionType_COULOMB);
+    forces.add_summed(1, 2, make_vector(-4.0, 0.0, 0.0), InteractionType_COULOMB);
+    forces.summed_merge_to_scalar(x, box);
+    forces.summed_merge_to_total_forces_statistics(x);
+    forces.clear();
+    forces.add_summed(0, 1, make_vector(-3.0, 0.0, 0.0), InteractionType_COULOMB);
+    forces.summed_merge_to_scalar(x, box);
+    forces.summed_merge_to_total_forces_statistics(x);
+    forces.clear();
+
+    std::ostringstream result, reference;
+    forces.write_scalar_statistics(result, 2);
+    forces.write_total_forces_statistics(result, 2);
+    reference << "0 1 2 1 1 3 " << InteractionType_COULOMB << "\n"
+              << "1 2 2 4 0 4 " << InteractionType_COULOMB << "\n"
+              << "mean 2 4 2\n"
+              << "variance 1 1 4\n"
+              << "min 1 3 0\n"
+              << "max 3 5 4\n";
+    EXPECT_EQ(reference.str(), result.str());
+
+    forces.clear_scalar();
+    result.str("");
+    forces.write_total_forces_statistics(result, 0);
+    EXPECT_EQ("mean 0 0 0\nvariance 0 0 0\nmin 0 0 0\nmax 0 0 0\n", result.str());
+}
+
+} // namespace fda
@@ -0,0 +1,56 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/fda/DynamicGroups.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/pbc.h"
+
+namespace fda {
+
+namespace {
+
+/// Four atoms on the x-axis, atom 0 is not in index group 1
+class DynamicGroupsTest : public ::testing::Test
+{
+protected:
+
+    DynamicGroupsTest()
+     : index_group1{0, 1, 1, 1},
+       index_group2{1, 1, 1, 1},
+       x{{0.1, 0.0, 0.0}, {0.2, 0.0, 0.0}, {0.6, 0.0, 0.0}, {0.9, 0.0, 0.0}}
+    {
+        clear_mat(box);
+    }
+
+    std::vector<char> index_group1;
+    std::vector<char> index_group2;
+    rvec x[4];
+    matrix box;
+};
+
+TEST_F(DynamicGroupsTest, SelectionWithinIndexGroup)
+{
+    DynamicGroups groups("x < 0.5", "", nullptr, index_group1, index_group2);
+
+    groups.update(x, box, epbcNONE);
+    EXPECT_EQ((std::vector<char>{0, 1, 0, 0}), groups.get_in_group1());
+    EXPECT_EQ(index_group2, groups.get_in_group2());
+
+    // Atoms moving into the selection are added in the next frame
+    x[1][XX] = 0.8;
+    x[2][XX] = 0.3;
+    groups.update(x, box, epbcNONE);
+    EXPECT_EQ((std::vector<char>{0, 0, 1, 0}), groups.get_in_group1());
+}
+
+TEST_F(DynamicGroupsTest, BothGroups)
+{
+    DynamicGroups groups("atomnr 1 to 3", "x > 0.5", nullptr, index_group1, index_group2);
+
+    groups.update(x, box, epbcNONE);
+    EXPECT_EQ((std::vector<char>{0, 1, 1, 0}), groups.get_in_group1());
+    EXPECT_EQ((std::vector<char>{0, 0, 1, 1}), groups.get_in_group2());
+}
+
+} // namespace
+
+} // namespace fda
@@ -0,0 +1,64 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/fda/ForceMatrixReducer.h"
+
+namespace fda {
+
+namespace {
+
+/// Force matrix of frame k with the single pair (0, 1) and value k + 1
+ForceMatrix get_force_matrix(int k)
+{
+    return ForceMatrix(2, {{0, 1, k + 1.0}, {1, 0, k + 1.0}});
+}
+
+/// Run reducer over nb_frames frames, return the first frames and the values of the results
+void reduce(ForceMatrixReducer& reducer, int nb_frames, std::vector<int>& first_frames, std::vector<double>& values)
+{
+    auto store = [&]() {
+        first_frames.push_back(reducer.get_first_frame());
+        values.push_back(reducer.get_result()(0, 1));
+    };
+    for (int frame = 0; frame < nb_frames; ++frame) {
+        if (!reducer.is_needed(frame)) continue;
+        if (reducer.add(frame, get_force_matrix(frame))) store();
+    }
+    if (reducer.finish()) store();
+}
+
+} // namespace
+
+TEST(ForceMatrixReducerTest, EveryNth)
+{
+    ForceMatrixReducer reducer(FrameReduction::EVERY_NTH, 3);
+    std::vector<int> first_frames;
+    std::vector<double> values;
+    reduce(reducer, 8, first_frames, values);
+
+    EXPECT_EQ((std::vector<int>{0, 3, 6}), first_frames);
+    EXPECT_EQ((std::vector<double>{1.0, 4.0, 7.0}), values);
+}
+
+TEST(ForceMatrixReducerTest, BlockMean)
+{
+    ForceMatrixReducer reducer(FrameReduction::BLOCK_MEAN, 3);
+    std::vector<int> first_frames;
+    std::vector<double> values;
+    reduce(reducer, 8, first_frames, values);
+
+    EXPECT_EQ((std::vector<int>{0, 3, 6}), first_frames);
+    EXPECT_EQ((std::vector<double>{2.0, 5.0, 7.5}), values);
+}
+
+TEST(ForceMatrixReducerTest, SlidingMean)
+{
+    ForceMatrixReducer reducer(FrameReduction::SLIDING_MEAN, 3);
+    std::vector<int> first_frames;
+    std::vector<double> values;
+    reduce(reducer, 5, first_frames, values);
+
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), first_frames);
+    EXPECT_EQ((std::vector<double>{2.0, 3.0, 4.0}), values);
+}
+
+} // namespace fda
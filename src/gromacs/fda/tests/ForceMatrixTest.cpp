@@ -0,0 +1,60 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/fda/ForceMatrix.h"
+
+namespace fda {
+
+TEST(ForceMatrixTest, LastEntryWins)
+{
+    std::vector<ForceMatrixEntry> entries{{2, 1, 1.0}, {0, 3, 2.0}, {2, 1, 3.0}, {2, 0, 4.0}, {0, 3, 0.0}};
+    ForceMatrix m(4, entries);
+
+    EXPECT_EQ(4, m.size());
+    EXPECT_EQ(2, m.get_number_of_entries());
+    EXPECT_EQ(3.0, m(2, 1));
+    EXPECT_EQ(4.0, m(2, 0));
+    EXPECT_EQ(0.0, m(0, 3));
+    EXPECT_EQ(0.0, m(1, 1));
+    EXPECT_EQ(0.0, m(7, 1));
+
+    std::vector<int> columns;
+    m.for_each([&](int i, int j, double) { EXPECT_EQ(2, i); columns.push_back(j); });
+    EXPECT_EQ((std::vector<int>{0, 1}), columns);
+}
+
+TEST(ForceMatrixTest, Dense)
+{
+    std::vector<double> dense{0.0, 1.0, 0.0,
+                              1.0, 0.0, -2.0,
+                              0.0, -2.0, 5.0};
+    ForceMatrix m(dense);
+
+    EXPECT_EQ(3, m.size());
+    EXPECT_EQ(5, m.get_number_of_entries());
+    EXPECT_EQ(dense, m.to_dense());
+}
+
+TEST(ForceMatrixTest, Arithmetic)
+{
+    std::vector<double> dense1{0.0, 1.0, 3.0,
+                               1.0, 0.0, -2.0,
+                               3.0, -2.0, 0.0};
+    std::vector<double> dense2{0.0, 1.0, 0.0,
+                               1.0, 4.0, 2.0,
+                               0.0, 2.0, 0.0};
+    ForceMatrix m1(dense1), m2(dense2);
+
+    ForceMatrix diff(m1);
+    diff -= m2;
+    diff.abs();
+    diff *= 2.0;
+    EXPECT_EQ((std::vector<double>{0.0, 0.0, 6.0, 0.0, 8.0, 8.0, 6.0, 8.0, 0.0}), diff.to_dense());
+    EXPECT_EQ(5, diff.get_number_of_entries());
+
+    ForceMatrix sum(m1);
+    sum += m2;
+    sum /= 2.0;
+    EXPECT_EQ((std::vector<double>{0.0, 1.0, 1.5, 1.0, 2.0, 0.0, 1.5, 0.0, 0.0}), sum.to_dense());
+}
+
+} // namespace fda
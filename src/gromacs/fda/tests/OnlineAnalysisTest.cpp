@@ -0,0 +1,62 @@
+#include <sstream>
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/fda/OnlineAnalysis.h"
+
+namespace fda {
+
+namespace {
+
+/// Symmetric matrix of six particles: triangle 0-1-2, weak pair 3-4 and unconnected particle 5
+ForceMatrix make_forcematrix()
+{
+    std::vector<ForceMatrixEntry> entries;
+    auto add = [&entries](int i, int j, double force) {
+        entries.push_back(ForceMatrixEntry(i, j, force));
+        entries.push_back(ForceMatrixEntry(j, i, force));
+    };
+    add(0, 1, 1.0);
+    add(1, 2, 2.0);
+    add(0, 2, 5.0);
+    add(3, 4, 0.5);
+    return ForceMatrix(6, entries);
+}
+
+} // namespace
+
+TEST(OnlineAnalysisTest, Network)
+{
+    std::ostringstream os;
+    NetworkAnalysis(0.8, 2).analyse(make_forcematrix(), os);
+    EXPECT_EQ("network 3 0 1 2\n", os.str());
+
+    os.str("");
+    NetworkAnalysis(0.1, 2).analyse(make_forcematrix(), os);
+    EXPECT_EQ("network 3 0 1 2\nnetwork 2 3 4\n", os.str());
+}
+
+TEST(OnlineAnalysisTest, ShortestPaths)
+{
+    std::ostringstream os;
+    ShortestPathAnalysis(0, 2, 2).analyse(make_forcematrix(), os);
+    EXPECT_EQ("path 3 0 1 2\npath 5 0 2\n", os.str());
+
+    // No connection, nothing is written
+    os.str("");
+    ShortestPathAnalysis(0, 4, 1).analyse(make_forcematrix(), os);
+    ShortestPathAnalysis(0, 5, 1).analyse(make_forcematrix(), os);
+    EXPECT_EQ("", os.str());
+}
+
+TEST(OnlineAnalysisTest, PunctualStress)
+{
+    std::ostringstream os;
+    PunctualStressAnalysis().analyse(make_forcematrix(), os);
+    EXPECT_EQ("stress 6 3 7 0.5 0.5 0\n", os.str());
+
+    os.str("");
+    PunctualStressAnalysis(std::vector<int>{2, 3, 7, 1, 1, 1}).analyse(make_forcematrix(), os);
+    EXPECT_EQ("stress 3 1 1 0.5 0.5 0\n", os.str());
+}
+
+} // namespace fda
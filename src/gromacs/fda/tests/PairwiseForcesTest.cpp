@@ -5,8 +5,12 @@
  *      Author: Bernd Doser, HITS gGmbH <bernd.doser@h-its.org>
  */
 
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <gtest/gtest.h>
+#include "gromacs/fda/DistributedForces.h"
 #include "gromacs/fda/PairwiseForces.h"
 #include "testutils/cmdlinetest.h"
 #include "testutils/testfilemanager.h"
@@ -65,4 +69,184 @@ TEST_F(PairwiseForcesTest, ReadFile3)
     EXPECT_EQ(17, pf_all[8][5].j);
 }
 
+TEST_F(PairwiseForcesTest, BinaryFrameIndex)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test2_binary.pfa");
+
+    PairwiseForces<Force<real>> pf_text(data_path + "/test2.pfa");
+    pf_text.write(binary_filename, true);
+
+    PairwiseForces<Force<real>> pf_binary(binary_filename);
+    EXPECT_TRUE(pf_binary.get_is_binary());
+    EXPECT_EQ(11, pf_binary.get_number_of_frames());
+    EXPECT_EQ(11, pf_text.get_number_of_frames());
+
+    // Random access in reverse order
+    int nbParticles = pf_binary.get_max_index_second_column_first_frame() + 1;
+    for (int frame = 10; frame >= 0; --frame) {
+        EXPECT_EQ(pf_text.get_forcematrix_of_frame(nbParticles, frame),
+                  pf_binary.get_forcematrix_of_frame(nbParticles, frame));
+    }
+}
+
+TEST_F(PairwiseForcesTest, BinaryWithoutFrameIndex)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test2_binary.pfa");
+    std::string legacy_filename = fileManager().getTemporaryFilePath("test2_legacy.pfa");
+
+    PairwiseForces<Force<real>>(data_path + "/test2.pfa").write(binary_filename, true);
+    PairwiseForces<Force<real>> pf_binary(binary_filename);
+
+    // Remove the trailing index as in files of older versions
+    {
+        std::ifstream is(binary_filename, std::ifstream::binary);
+        std::vector<char> buffer((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        std::ofstream os(legacy_filename, std::ofstream::binary);
+        os.write(&buffer[0], pf_binary.get_frame_index().get_end_of_frames());
+    }
+
+    PairwiseForces<Force<real>> pf_legacy(legacy_filename);
+    ASSERT_EQ(11, pf_legacy.get_number_of_frames());
+    for (size_t frame = 0; frame != 11; ++frame) {
+        EXPECT_EQ(pf_binary.get_frame_index().get_begin(frame), pf_legacy.get_frame_index().get_begin(frame));
+    }
+    EXPECT_TRUE(pf_binary.get_all_pairwise_forces() == pf_legacy.get_all_pairwise_forces());
+
+    int nbParticles = pf_binary.get_max_index_second_column_first_frame() + 1;
+    EXPECT_EQ(pf_binary.get_forcematrix_of_frame(nbParticles, 7),
+              pf_legacy.get_forcematrix_of_frame(nbParticles, 7));
+}
+
+TEST_F(PairwiseForcesTest, BinaryFrameView)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test2_binary.pfa");
+
+    PairwiseForces<Force<real>> pf_text(data_path + "/test2.pfa");
+    pf_text.write(binary_filename, true);
+    PairwiseForces<Force<real>> pf_binary(binary_filename);
+
+    auto&& pf_all = pf_text.get_all_pairwise_forces();
+    for (size_t frame = 0; frame != pf_all.size(); ++frame) {
+        auto&& pairwise_forces_frame = pf_binary.get_frame(frame);
+        ASSERT_EQ(pf_all[frame].size(), pairwise_forces_frame.get_number_of_interactions());
+        size_t n = 0;
+        for (auto&& row : pairwise_forces_frame) {
+            for (size_t k = 0; k != row.size(); ++k, ++n) {
+                EXPECT_EQ(pf_all[frame][n].i, row.get_i());
+                EXPECT_EQ(pf_all[frame][n].j, row.get_j(k));
+                EXPECT_EQ(pf_all[frame][n].force, row.get_force(k));
+            }
+        }
+        EXPECT_EQ(pf_all[frame].size(), n);
+    }
+}
+
+TEST_F(PairwiseForcesTest, SparseForceMatrix)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+
+    PairwiseForces<Force<real>> pf(data_path + "/test2.pfa");
+    int nbParticles = pf.get_max_index_second_column_first_frame() + 1;
+    for (size_t frame = 0; frame != pf.get_number_of_frames(); ++frame) {
+        EXPECT_EQ(pf.get_forcematrix_of_frame(nbParticles, frame),
+                  pf.get_sparse_forcematrix_of_frame(nbParticles, frame).to_dense());
+    }
+}
+
+TEST_F(PairwiseForcesTest, AveragedForceMatrix)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test2_binary.pfa");
+
+    PairwiseForces<Force<real>> pf_text(data_path + "/test2.pfa");
+    pf_text.write(binary_filename, true);
+    PairwiseForces<Force<real>> pf_binary(binary_filename);
+
+    int nbParticles = pf_text.get_max_index_second_column_first_frame() + 1;
+    std::vector<double> mean(nbParticles * nbParticles, 0.0);
+    for (size_t frame = 0; frame != pf_text.get_number_of_frames(); ++frame) {
+        auto&& forcematrix = pf_text.get_forcematrix_of_frame(nbParticles, frame);
+        for (size_t i = 0; i != mean.size(); ++i) mean[i] += forcematrix[i];
+    }
+    for (auto& m : mean) m /= pf_text.get_number_of_frames();
+
+    auto&& mean_text = pf_text.get_averaged_forcematrix(nbParticles);
+    auto&& mean_binary = pf_binary.get_averaged_forcematrix(nbParticles);
+    ASSERT_EQ(mean.size(), mean_text.size());
+    for (size_t i = 0; i != mean.size(); ++i) EXPECT_NEAR(mean[i], mean_text[i], 1e-6 * std::abs(mean[i]));
+    EXPECT_EQ(mean_text, mean_binary);
+}
+
+TEST_F(PairwiseForcesTest, BinaryVector)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test3_binary.pfa");
+
+    PairwiseForces<Force<Vector>> pf_text(data_path + "/test3.pfa");
+    pf_text.write(binary_filename, true);
+    PairwiseForces<Force<Vector>> pf_binary(binary_filename);
+
+    EXPECT_EQ(11, pf_binary.get_number_of_frames());
+    EXPECT_TRUE(pf_text.get_all_pairwise_forces() == pf_binary.get_all_pairwise_forces());
+}
+
+TEST_F(PairwiseForcesTest, CompressedVector)
+{
+    std::string data_path = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string binary_filename = fileManager().getTemporaryFilePath("test3_binary.pfa");
+    std::string compressed_filename = fileManager().getTemporaryFilePath("test3_compressed.pfa");
+
+    PairwiseForces<Force<Vector>> pf_text(data_path + "/test3.pfa");
+    pf_text.write(binary_filename, true);
+    auto pf_all = pf_text.get_all_pairwise_forces(true);
+
+    FDASettings fda_settings;
+    fda_settings.one_pair = OnePair::SUMMED;
+    fda_settings.binary_result_file = true;
+    fda_settings.compression_precision = 1000.0;
+
+    // Write the frames as mdrun does
+    {
+        DistributedForces forces(pf_text.get_max_index_second_column_first_frame() + 1, fda_settings);
+        std::ofstream os(compressed_filename, std::ofstream::binary);
+        char c = 'c';
+        os.write(&c, 1);
+        os.write(reinterpret_cast<const char*>(&fda_settings.compression_precision), sizeof(double));
+        FrameIndex frame_index;
+        for (auto const& pairwise_forces : pf_all) {
+            forces.clear();
+            for (auto const& pf : pairwise_forces) forces.add_summed(pf.i, pf.j, pf.force.force, pf.force.type);
+            frame_index.add(os.tellp());
+            forces.write_summed_vector(os);
+        }
+        frame_index.set_end_of_frames(os.tellp());
+        frame_index.write(os);
+    }
+
+    PairwiseForces<Force<Vector>> pf_compressed(compressed_filename);
+    EXPECT_TRUE(pf_compressed.get_is_binary());
+    EXPECT_TRUE(pf_compressed.get_is_compressed());
+    auto pf_compressed_all = pf_compressed.get_all_pairwise_forces();
+    ASSERT_EQ(pf_all.size(), pf_compressed_all.size());
+    for (size_t frame = 0; frame != pf_all.size(); ++frame) {
+        ASSERT_EQ(pf_all[frame].size(), pf_compressed_all[frame].size());
+        for (size_t n = 0; n != pf_all[frame].size(); ++n) {
+            auto const& expected = pf_all[frame][n];
+            auto const& actual = pf_compressed_all[frame][n];
+            EXPECT_EQ(expected.i, actual.i);
+            EXPECT_EQ(expected.j, actual.j);
+            EXPECT_EQ(expected.force.type, actual.force.type);
+            for (int d = 0; d != DIM; ++d) EXPECT_NEAR(expected.force.force[d], actual.force.force[d], 0.6e-3);
+        }
+    }
+
+    std::ifstream binary_file(binary_filename, std::ifstream::binary | std::ifstream::ate);
+    std::ifstream compressed_file(compressed_filename, std::ifstream::binary | std::ifstream::ate);
+    std::cout << "Size of binary file: " << binary_file.tellg() << " bytes, compressed: " << compressed_file.tellg() << " bytes" << std::endl;
+    EXPECT_LT(2 * compressed_file.tellg(), binary_file.tellg());
+}
+
 } // namespace fda
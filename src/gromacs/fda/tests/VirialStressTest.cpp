@@ -0,0 +1,55 @@
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/fda/VirialStress.h"
+
+namespace fda {
+
+TEST(VirialStressTest, AddAndReduce)
+{
+    tensor v = {{1.0, 2.0, 3.0}, {2.0, 4.0, 5.0}, {3.0, 5.0, 6.0}};
+
+    VirialStress a(3), b(3);
+    a.add(1, v, 0.5);
+    b.add(1, v, 1.0);
+    b.add(2, v, 2.0);
+    a.reduce(b);
+
+    EXPECT_EQ(3, a.size());
+    EXPECT_FLOAT_EQ(0.0, a.xx[0]);
+    EXPECT_FLOAT_EQ(1.5, a.xx[1]);
+    EXPECT_FLOAT_EQ(6.0, a.yy[1]);
+    EXPECT_FLOAT_EQ(9.0, a.zz[1]);
+    EXPECT_FLOAT_EQ(3.0, a.xy[1]);
+    EXPECT_FLOAT_EQ(4.5, a.xz[1]);
+    EXPECT_FLOAT_EQ(7.5, a.yz[1]);
+    EXPECT_FLOAT_EQ(2.0, a.xx[2]);
+    EXPECT_FLOAT_EQ(12.0, a.zz[2]);
+
+    // other is cleared
+    for (int i = 0; i != b.size(); ++i) {
+        EXPECT_EQ(0.0, b.xx[i]);
+        EXPECT_EQ(0.0, b.yz[i]);
+    }
+}
+
+TEST(VirialStressTest, VonMises)
+{
+    tensor uniaxial = {{2.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    tensor shear = {{0.0, 1.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+
+    // More atoms than a SIMD register to cover the padding
+    int const n = 19;
+    VirialStress v(n);
+    for (int i = 0; i < n; ++i) v.add(i, i % 2 ? uniaxial : shear, i);
+
+    std::vector<real> von_mises = v.von_mises();
+    ASSERT_EQ(static_cast<size_t>(n), von_mises.size());
+    for (int i = 0; i < n; ++i) {
+        // uniaxial stress s has von Mises stress s, pure shear stress t has sqrt(3) * t
+        real expected = i % 2 ? 2.0 * i : std::sqrt(3.0) * i;
+        EXPECT_NEAR(expected, von_mises[i], 1e-5 * (1.0 + expected));
+    }
+}
+
+} // namespace fda
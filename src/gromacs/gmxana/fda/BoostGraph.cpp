@@ -10,7 +10,9 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <queue>
 #include <sstream>
 #include "BoostGraph.h"
 #include "Index.h"
@@ -18,19 +20,25 @@
 
 namespace fda_analysis {
 
+namespace {
+
+/// Vertex pair of an undirected edge with the lower index first
+std::pair<BoostGraph::Vertex, BoostGraph::Vertex> ordered_pair(BoostGraph::Vertex u, BoostGraph::Vertex v)
+{
+    return u < v ? std::make_pair(u, v) : std::make_pair(v, u);
+}
+
+} // namespace
+
 BoostGraph::BoostGraph(std::vector<double> const& forceMatrix)
+ : BoostGraph(fda::ForceMatrix(forceMatrix))
+{}
+
+BoostGraph::BoostGraph(fda::ForceMatrix const& forceMatrix)
 {
-    int dim = sqrt(forceMatrix.size());
-    double force;
-
-    for (int i = 0; i < dim; ++i) {
-        for (int j = i; j < dim; ++j) {
-            force = forceMatrix[i*dim+j];
-            if (force != 0.0) {
-                add_edge(i, j, force, graph_);
-            }
-        }
-    }
+    forceMatrix.for_each([this](int i, int j, double force) {
+        if (j >= i and force != 0.0) add_edge(i, j, force, graph_);
+    });
 
     #ifdef PRINT_DEBUG
         std::cout << "Num vertices = " << num_vertices(graph_) << std::endl;
@@ -48,6 +56,9 @@ BoostGraph::PathList BoostGraph::findKShortestPaths(size_t from, size_t to, size
     PathList shortestPaths;
     shortestPaths.push_back(findShortestPath(from, to));
 
+    // Candidates ordered by distance and for equal distances by the order of insertion
+    typedef std::pair<double, size_t> Key;
+    std::priority_queue<Key, std::vector<Key>, std::greater<Key>> heap;
     PathList variants;
 
     for (size_t k = 1; k < num; ++k)
@@ -55,83 +66,77 @@ BoostGraph::PathList BoostGraph::findKShortestPaths(size_t from, size_t to, size
         Path const& previousPath = shortestPaths[k-1];
 
         // The spur node ranges from the first node to the next to last node in the previous k-shortest path.
-        for (size_t i = 0; i < previousPath.size() - 1; ++i)
+        int numberOfSpurNodes = previousPath.size() - 1;
+        std::vector<Path> spurVariants(numberOfSpurNodes);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < numberOfSpurNodes; ++i)
         {
-              // Spur node is retrieved from the previous k-shortest path, k ��� 1.
+            // Spur node is retrieved from the previous k-shortest path, k - 1.
             Vertex spurNode = previousPath[i];
 
-              // The sequence of nodes from the source to the spur node of the previous k-shortest path.
-              Path rootPath(previousPath.begin(), previousPath.begin() + i);
+            // The sequence of nodes from the source to the spur node of the previous k-shortest path.
+            Path rootPath(previousPath.begin(), previousPath.begin() + i);
 
-              Graph tmpGraph(graph_);
-
-              for (auto & p : shortestPaths) {
-                   if (rootPath == Path(p.begin(), p.begin() + i)) {
-                       // Remove the links that are part of the previous shortest paths which share the same root path.
-                      //std::cout << "remove edge " << p[i] << "  " << p[i+1] << std::endl;
-                       remove_edge(vertex(p[i], tmpGraph), vertex(p[i+1], tmpGraph), tmpGraph);
-                   }
-              }
-
-            #ifdef PRINT_DEBUG
-                std::cout << "tmp graph after remove_edge" << std::endl;
-                print(tmpGraph);
-            #endif
-
-              // Calculate the spur path from the spur node to the sink.
-              Path spurPath;
-              try {
-                  spurPath = dijkstra(spurNode, to, tmpGraph);
-              } catch ( ... ) {
-                  continue;
-              }
-
-            #ifdef PRINT_DEBUG
-                std::cout << "spurPath:" << std::endl;
-                print(spurPath);
-            #endif
+            // Mask the links that are part of the previous shortest paths which share the same root path.
+            std::vector<std::pair<Vertex, Vertex>> removed;
+            for (auto const& p : shortestPaths) {
+                if (static_cast<int>(p.size()) > i + 1 and std::equal(rootPath.begin(), rootPath.end(), p.begin())) {
+                    removed.push_back(ordered_pair(p[i], p[i+1]));
+                }
+            }
+            std::sort(removed.begin(), removed.end());
+            FilteredGraph tmpGraph(graph_, EdgeMask(&graph_, &removed));
+
+            // Calculate the spur path from the spur node to the sink.
+            Path spurPath;
+            try {
+                spurPath = dijkstra(spurNode, to, tmpGraph);
+            } catch ( ... ) {
+                continue;
+            }
 
-              // Entire path is made up of the root path and spur path.
-              Path totalPath = rootPath;
-              totalPath.insert(totalPath.end(), spurPath.begin(), spurPath.end());
+            // Entire path is made up of the root path and spur path.
+            spurVariants[i] = rootPath;
+            spurVariants[i].insert(spurVariants[i].end(), spurPath.begin(), spurPath.end());
+        }
 
+        // Add the potential k-shortest paths to the heap.
+        for (auto& totalPath : spurVariants) {
+            if (totalPath.empty()) continue;
             #ifdef PRINT_DEBUG
                 std::cout << "totalPath:" << std::endl;
                 print(totalPath);
             #endif
-
-              // Add the potential k-shortest path to the heap.
-              variants.push_back(totalPath);
+            heap.push(Key(distance(totalPath), variants.size()));
+            variants.push_back(std::move(totalPath));
         }
 
         // This handles the case of there being no spur paths, or no spur paths left.
         // This could happen if the spur paths have already been exhausted (added to A),
         // or there are no spur paths at all - such as when both the source and sink vertices
         // lie along a "dead end".
-        if (variants.empty()) break;
-
-        // Find the potential k-shortest path.
-        PathList::iterator iterShortestPath;
-        double minDistance = std::numeric_limits<double>::max();
-          for (auto iter(variants.begin()), iterEnd(variants.end()); iter != iterEnd;  ++iter) {
-              if (distance(*iter) < minDistance) {
-                  minDistance = distance(*iter);
-                  iterShortestPath = iter;
-              }
-          }
+        if (heap.empty()) break;
 
         // Add the lowest cost path becomes the k-shortest path.
         #ifdef PRINT_DEBUG
             std::cout << k << "-shortest path:" << std::endl;
-            print(*iterShortestPath);
+            print(variants[heap.top().second]);
         #endif
-        shortestPaths.push_back(*iterShortestPath);
-        variants.erase(iterShortestPath);
+        shortestPaths.push_back(std::move(variants[heap.top().second]));
+        heap.pop();
     }
 
     return shortestPaths;
 }
 
+bool BoostGraph::EdgeMask::operator () (Edge const& e) const
+{
+    if (removed->empty()) return true;
+    return !std::binary_search(removed->begin(), removed->end(),
+        ordered_pair(source(e, *graph), target(e, *graph)));
+}
+
 double BoostGraph::distance(BoostGraph::Path const& path) const
 {
     double dist = 0.0;
@@ -139,7 +144,8 @@ double BoostGraph::distance(BoostGraph::Path const& path) const
     return dist;
 }
 
-BoostGraph::Path BoostGraph::dijkstra(Vertex source, Vertex dest, Graph const& graph) const
+template <class G>
+BoostGraph::Path BoostGraph::dijkstra(Vertex source, Vertex dest, G const& graph) const
 {
     //std::cout << "dijkstra: source = " << source << ", dest = " << dest << std::endl;
     //if (vertex(source, graph)) gmx_fatal(FARGS, "Vertex source is not an element of graph.");
@@ -147,12 +153,13 @@ BoostGraph::Path BoostGraph::dijkstra(Vertex source, Vertex dest, Graph const& g
 
     std::vector<Vertex> predecessor(num_vertices(graph));
     std::vector<double> distance(num_vertices(graph));
-    Vertex s = vertex(source, graph);
+    // With vecS vertex storage the vertex descriptors are the indices, also for a filtered graph
+    Vertex s = source;
 
     dijkstra_shortest_paths(graph, s, boost::predecessor_map(&predecessor[0]).distance_map(&distance[0]));
 
     #ifdef PRINT_DEBUG
-        boost::graph_traits<Graph>::vertex_iterator vi, vend;
+        typename boost::graph_traits<G>::vertex_iterator vi, vend;
         for (boost::tie(vi, vend) = boost::vertices(graph); vi != vend; ++vi) {
             std::cout << "distance(" << *vi << ") = " << distance[*vi] << ", ";
             std::cout << "parent(" << *vi << ") = " << predecessor[*vi] << std::endl;
@@ -160,7 +167,7 @@ BoostGraph::Path BoostGraph::dijkstra(Vertex source, Vertex dest, Graph const& g
     #endif
 
     Path shortestPath;
-    Vertex cur = vertex(dest, graph);
+    Vertex cur = dest;
     while (cur != s) {
         shortestPath.push_back(cur);
         if (cur == predecessor[cur]) throw std::runtime_error("No connection between source and dest.");
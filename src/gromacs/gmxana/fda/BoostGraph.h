@@ -10,8 +10,11 @@
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/graph/filtered_graph.hpp>
 #include <iostream>
+#include <utility>
 #include <vector>
+#include "gromacs/fda/ForceMatrix.h"
 
 namespace fda_analysis {
 
@@ -30,15 +33,42 @@ public:
     typedef std::vector<int> Path;
     typedef std::vector<Path> PathList;
 
+    /// Hides the edges of a sorted list of vertex pairs (lower index first) without copying the graph
+    struct EdgeMask
+    {
+        EdgeMask() : graph(nullptr), removed(nullptr) {}
+
+        EdgeMask(Graph const* graph, std::vector<std::pair<Vertex, Vertex>> const* removed)
+         : graph(graph), removed(removed)
+        {}
+
+        bool operator () (Edge const& e) const;
+
+        Graph const* graph;
+
+        std::vector<std::pair<Vertex, Vertex>> const* removed;
+    };
+
+    typedef boost::filtered_graph<Graph, EdgeMask> FilteredGraph;
+
     BoostGraph() {}
 
     //! Build graph by adjacency matrix
     BoostGraph(std::vector<double> const& forceMatrix);
 
+    //! Build graph by sparse adjacency matrix
+    BoostGraph(fda::ForceMatrix const& forceMatrix);
+
     //! Use Dijkstra algorithm to find the shortest path.
     Path findShortestPath(size_t source, size_t dest) const;
 
-    //! Yen's algorithm to find the k shortest paths.
+    /**
+     * Yen's algorithm to find the k shortest paths.
+     *
+     * The spur paths of a path are computed in parallel on a masked view of the graph,
+     * the candidates are collected in the order of the spur nodes, so that the result
+     * does not depend on the number of threads.
+     */
     PathList findKShortestPaths(size_t source, size_t dest, size_t num) const;
 
     //! Determine the sum of weights (distance) of a graph.
@@ -47,7 +77,8 @@ public:
 private:
 
     //! Calculate the spur path from source to dest.
-    Path dijkstra(Vertex source, Vertex dest, Graph const& graph) const;
+    template <class G>
+    Path dijkstra(Vertex source, Vertex dest, G const& graph) const;
 
     //! Print graph for debugging
     void print(Graph const& graph) const;
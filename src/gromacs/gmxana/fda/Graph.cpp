@@ -10,6 +10,7 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <list>
 #include <map>
 #include <set>
 #include <sstream>
@@ -19,70 +20,46 @@
 
 namespace fda_analysis {
 
-Graph::Graph(std::vector<double> const& forceMatrix, rvec *coord, int *index, int isize)
-{
-	double force;
-	bool addNode1, addNode2;
-	int dim = sqrt(forceMatrix.size());
-	std::vector<int>::iterator iterFind;
-
-    for (int i = 0; i < dim; ++i) {
-        for (int j = 0; j < dim; ++j) {
-        	force = forceMatrix[i*dim+j];
-            if (force == 0.0) continue;
-			Node node1(i), node2(j);
-
-			iterFind = std::find(indices_.begin(), indices_.end(), i);
-			if (iterFind != indices_.end()) {
-				nodes_[std::distance(indices_.begin(), iterFind)].addConnectedNode(j, force);
-				addNode1 = false;
-			} else {
-				addNode1 = true;
-			}
-
-			iterFind = std::find(indices_.begin(), indices_.end(), j);
-			if (iterFind != indices_.end()) {
-				nodes_[std::distance(indices_.begin(), iterFind)].addConnectedNode(i, force);
-				addNode2 = false;
-			} else {
-				addNode2 = true;
-			}
-
-			if (addNode1) {
-				node1.addConnectedNode(j, force);
-                nodes_.push_back(node1);
-                indices_.push_back(i);
-			}
-
-			if (addNode2) {
-				node2.addConnectedNode(i, force);
-                nodes_.push_back(node2);
-                indices_.push_back(j);
-			}
-        }
-    }
-    for (int i = 0; i < dim; ++i)
-    {
-    	if (std::find(indices_.begin(), indices_.end(), i) == indices_.end()){
-			nodes_.push_back(Node(i));
-			indices_.push_back(i);
-		}
-    }
+Graph::Graph(std::vector<double> const& forceMatrix, const rvec *coord, int *index, int isize)
+ : Graph(fda::ForceMatrix(forceMatrix), coord, index, isize)
+{}
 
-    updateCoordinates(coord, index, isize);
+Graph::Graph(fda::ForceMatrix const& forceMatrix, const rvec *coord, int *index, int isize)
+ : Graph(forceMatrix)
+{
+	updateCoordinates(coord, index, isize);
 }
 
-void Graph::updateCoordinates(rvec *coord, int *index, int isize)
+Graph::Graph(fda::ForceMatrix const& forceMatrix)
+ : positions_(forceMatrix.size(), -1)
 {
-    std::vector<int>::iterator iterFind;
+	// Nodes are added in the order of their first appearance in the edge list
+	auto addNode = [this](int i) {
+		if (positions_[i] != -1) return;
+		positions_[i] = nodes_.size();
+		nodes_.push_back(Node(i));
+		indices_.push_back(i);
+	};
+
+	forceMatrix.for_each([&](int i, int j, double force) {
+		if (force == 0.0) return;
+		addNode(i);
+		addNode(j);
+		nodes_[positions_[i]].addConnectedNode(j, force);
+		nodes_[positions_[j]].addConnectedNode(i, force);
+	});
+
+	// Unconnected nodes
+	for (int i = 0; i < forceMatrix.size(); ++i) addNode(i);
+}
 
+void Graph::updateCoordinates(const rvec *coord, int *index, int isize)
+{
     // residue-based
     if (index) {
-        for (int i = 0; i != isize; ++i)
+        for (int i = 0; i < isize and i < static_cast<int>(positions_.size()); ++i)
         {
-            iterFind = std::find(indices_.begin(), indices_.end(), i);
-            if (iterFind == indices_.end()) continue;
-            int pos = std::distance(indices_.begin(), iterFind);
+            int pos = positions_[i];
 
             /// Values will be converted from nm into Angstrom.
             nodes_[pos].x_ = coord[index[i]][0] * 10.0;
@@ -103,10 +80,21 @@ void Graph::updateCoordinates(rvec *coord, int *index, int isize)
 
 void Graph::convertInPDBMinGraphOrder(std::string const& outFilename, double threshold,
     size_t minGraphOrder, bool onlyBiggestNetwork, bool append) const
+{
+    std::ofstream pdb;
+    if (append) pdb.open(outFilename, std::ofstream::app);
+    else pdb.open(outFilename);
+    if (!pdb) gmx_fatal(FARGS, "Error opening pdb file.");
+
+    convertInPDBMinGraphOrder(pdb, threshold, minGraphOrder, onlyBiggestNetwork);
+}
+
+void Graph::convertInPDBMinGraphOrder(std::ostream& os, double threshold,
+    size_t minGraphOrder, bool onlyBiggestNetwork) const
 {
     Networks networks;
     createNetworkMinGraphOrder(networks, threshold, minGraphOrder, onlyBiggestNetwork);
-    convertNetworkToPDB(outFilename, networks, threshold, minGraphOrder, append);
+    convertNetworkToPDB(os, networks, threshold, minGraphOrder);
 }
 
 void Graph::convertInDIMACSMinGraphOrder(std::string const& outFilename, double threshold,
@@ -117,117 +105,110 @@ void Graph::convertInDIMACSMinGraphOrder(std::string const& outFilename, double
     convertNetworkToDIMACS(outFilename, networks, threshold, minGraphOrder);
 }
 
+Graph::Networks Graph::getNetworks(double threshold, size_t minGraphOrder) const
+{
+    Networks networks;
+    createNetworkMinGraphOrder(networks, threshold, minGraphOrder, false);
+    networks.erase(std::remove_if(networks.begin(), networks.end(),
+        [minGraphOrder](Network const& network){ return network.size() < minGraphOrder; }), networks.end());
+    return networks;
+}
+
 void Graph::createNetworkMinGraphOrder(Networks& networks, double threshold, size_t minGraphOrder,
     bool onlyBiggestNetwork) const
 {
-	int iNetwork = 0;
-	int idNetwork = 0;
+	// Union-find over the node indices, the root of a network owns the list of its members.
+	// Networks are ordered by the time of their creation or their last merge.
+	std::vector<int> parent(positions_.size(), -1);
+	std::vector<std::list<int>> members(positions_.size());
+	std::vector<size_t> order(positions_.size(), 0);
+	size_t time = 0;
+
+	auto find = [&parent](int i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
 
-	for (auto node : nodes_)
+	Network mergedNetwork;
+	for (auto const& node : nodes_)
 	{
-		Network mergedNetwork;
-		bool found = false;
-
-		for (auto network : index(networks))
-		{
-			if (std::find(network.value.begin(), network.value.end(), node.index_) != network.value.end()) {
-				mergedNetwork.push_back(network.index);
-				idNetwork = network.index;
-				found = true;
-			}
-		}
-		if (!found) {
-			mergedNetwork.push_back(networks.size());
-			idNetwork = networks.size();
-			networks.push_back(Network(1,node.index_));
+		if (parent[node.index_] == -1) {
+			parent[node.index_] = node.index_;
+			members[node.index_].push_back(node.index_);
+			order[node.index_] = time++;
 		}
+		int root = find(node.index_);
 
-		bool sup = false;
+		mergedNetwork.assign(1, root);
 		for (auto connectedIndex : index(node.connectedIndicies_)) {
 			if (std::abs(node.forces_[connectedIndex.index]) >= threshold) {
-				sup = true;
-				iNetwork = 0;
-				bool addNew = true;
-				for (auto network : networks) {
-					if (std::find(network.begin(), network.end(), connectedIndex.value) != network.end()) {
-						mergedNetwork.push_back(iNetwork);
-						addNew = false;
-						break;
-					}
-					++iNetwork;
+				int j = connectedIndex.value;
+				if (parent[j] == -1) {
+					parent[j] = root;
+					members[root].push_back(j);
+				} else {
+					mergedNetwork.push_back(find(j));
 				}
-				if (addNew) networks[idNetwork].push_back(connectedIndex.value);
 			}
 		}
-		if (sup) {
-			std::sort(mergedNetwork.begin(), mergedNetwork.end());
-			mergedNetwork.erase(std::unique(mergedNetwork.begin(), mergedNetwork.end()), mergedNetwork.end());
-			if (mergedNetwork.size() > 1) {
-				int mergeTimes = 0;
-				Network merge;
-				for (auto mergeIndex : mergedNetwork) {
-					Networks::iterator iter = networks.begin() + (mergeIndex - mergeTimes);
-					merge.insert(merge.end(), iter->begin(), iter->end());
-					networks.erase(iter);
-					++mergeTimes;
-				}
-				networks.push_back(merge);
+
+		// Merged networks are concatenated in their order
+		std::sort(mergedNetwork.begin(), mergedNetwork.end(), [&order](int a, int b){ return order[a] < order[b]; });
+		mergedNetwork.erase(std::unique(mergedNetwork.begin(), mergedNetwork.end()), mergedNetwork.end());
+		if (mergedNetwork.size() > 1) {
+			int mergedRoot = mergedNetwork[0];
+			for (size_t n = 1; n != mergedNetwork.size(); ++n) {
+				members[mergedRoot].splice(members[mergedRoot].end(), members[mergedNetwork[n]]);
+				parent[mergedNetwork[n]] = mergedRoot;
 			}
+			order[mergedRoot] = time++;
 		}
 	}
 
+	Network roots;
+	for (size_t i = 0; i != parent.size(); ++i) {
+		if (parent[i] == static_cast<int>(i)) roots.push_back(i);
+	}
+	std::sort(roots.begin(), roots.end(), [&order](int a, int b){ return order[a] < order[b]; });
+	for (auto root : roots) networks.push_back(Network(members[root].begin(), members[root].end()));
+
 	if (onlyBiggestNetwork) {
 		size_t count = 0;
-		for (auto network : networks) {
+		for (auto const& network : networks) {
 			if (network.size() > count) count = network.size();
 			if (count > minGraphOrder) minGraphOrder = count;
 		}
 	}
 }
 
-void Graph::convertNetworkToPDB(std::string const& filename, Networks const& networks, double threshold,
-    size_t minGraphOrder, bool append) const
+void Graph::convertNetworkToPDB(std::ostream& pdb, Networks const& networks, double threshold,
+    size_t minGraphOrder) const
 {
-    std::ofstream pdb;
-    if (append) pdb.open(filename, std::ofstream::app);
-    else pdb.open(filename);
-    if (!pdb) gmx_fatal(FARGS, "Error opening pdb file.");
-
     std::stringstream connections;
-    std::vector< std::pair<int, int> > finishedPairs;
-    std::vector<int>::const_iterator iterFind;
-    Node node, connectedNode;
+    std::set< std::pair<int, int> > finishedPairs;
     int numNetwork = 0;
     int n = 1;
 
     real currentForce;
     bool valueToLargeForPDB = false;
 
-    for (auto network : networks) {
+    for (auto const& network : networks) {
         if (network.size() >= minGraphOrder) {
         	for (auto nodeId : network) {
-        		iterFind = std::find(indices_.begin(), indices_.end(), nodeId);
-        		if (iterFind == indices_.end()) gmx_fatal(FARGS, "Error in insertPDBInfo.");
-                node = nodes_[std::distance(indices_.begin(), iterFind)];
+        		if (nodeId < 0 or nodeId >= static_cast<int>(positions_.size())) gmx_fatal(FARGS, "Error in insertPDBInfo.");
+                Node const& node = nodes_[positions_[nodeId]];
                 for (auto connectedIndex : index(node.connectedIndicies_)) {
                     if (std::abs(node.forces_[connectedIndex.index]) >= threshold) {
-                        int pos = std::distance(indices_.begin(), std::find(indices_.begin(), indices_.end(), connectedIndex.value));
-                    	connectedNode = nodes_[pos];
-                    	bool add = true;
-                    	for (auto finishedPair : finishedPairs) {
-                    		if ((node.index_ == finishedPair.first and
-                    			 connectedNode.index_ == finishedPair.second) or
-                    			(node.index_ == finishedPair.second and
-                    		     connectedNode.index_ == finishedPair.first))
-                    			add = false;
-                    	}
-                    	if (add) {
+                    	Node const& connectedNode = nodes_[positions_[connectedIndex.value]];
+                    	if (finishedPairs.insert(std::minmax(node.index_, connectedNode.index_)).second) {
                     	    currentForce = node.forces_[connectedIndex.index];
                     	    if (currentForce > 999.99) valueToLargeForPDB = true;
                     		writeAtomToPDB(pdb, n, node, currentForce, numNetwork);
                     		writeAtomToPDB(pdb, n+1, connectedNode, currentForce, numNetwork);
                             connections << "CONECT" << std::setw(5) << n << std::setw(5) << n+1 << std::endl;
-                            finishedPairs.push_back(std::make_pair(node.index_, connectedNode.index_));
                             n += 2;
                     	}
                     }
@@ -238,6 +219,8 @@ void Graph::convertNetworkToPDB(std::string const& filename, Networks const& net
     }
 
     if (numNetwork > 10) gmx_warning("%d networks are found, which could be difficult to visualize", numNetwork);
+    // Frames can be converted concurrently, the warning is printed only once
+    #pragma omp critical(fda_graph_pdb_warning)
     if (virginValueToLargeForPDB and valueToLargeForPDB) {
         gmx_warning("Force values larger than 999.99 are detected. Therefore, the general PDB format of the b-factor column of Real(6.2) is broken. "
                     "It is tested that it works for Pymol and VMD, but it is not guaranteed that it will work for other visualization programs.");
@@ -254,31 +237,19 @@ void Graph::convertNetworkToDIMACS(std::string const& outFilename, Networks cons
     std::stringstream edgeSection;
     std::set<int> addedNodes;
     std::map<int, int> corresp;
-    std::vector< std::pair<int, int> > finishedPairs;
-    std::vector<int>::const_iterator iterFind;
-    Node node, connectedNode;
+    std::set< std::pair<int, int> > finishedPairs;
     int numNetwork = 0;
     int n = 1;
 
-    for (auto network : networks) {
+    for (auto const& network : networks) {
         if (network.size() >= minGraphOrder) {
         	for (auto nodeId : network) {
-        		iterFind = std::find(indices_.begin(), indices_.end(), nodeId);
-        		if (iterFind == indices_.end()) gmx_fatal(FARGS, "Error in insertPDBInfo.");
-                node = nodes_[std::distance(indices_.begin(), iterFind)];
+        		if (nodeId < 0 or nodeId >= static_cast<int>(positions_.size())) gmx_fatal(FARGS, "Error in insertPDBInfo.");
+                Node const& node = nodes_[positions_[nodeId]];
                 for (auto connectedIndex : index(node.connectedIndicies_)) {
                     if (std::abs(node.forces_[connectedIndex.index]) >= threshold) {
-                        int pos = std::distance(indices_.begin(), std::find(indices_.begin(), indices_.end(), connectedIndex.value));
-                    	connectedNode = nodes_[pos];
-                    	bool add = true;
-                    	for (auto finishedPair : finishedPairs) {
-                    		if ((node.index_ == finishedPair.first and
-                    			 connectedNode.index_ == finishedPair.second) or
-                    			(node.index_ == finishedPair.second and
-                    		     connectedNode.index_ == finishedPair.first))
-                    			add = false;
-                    	}
-                    	if (add) {
+                    	Node const& connectedNode = nodes_[positions_[connectedIndex.value]];
+                    	if (finishedPairs.insert(std::minmax(node.index_, connectedNode.index_)).second) {
                             if (addedNodes.find(node.index_) == addedNodes.end()) {
                             	addedNodes.insert(node.index_);
                             	corresp[node.index_] = n;
@@ -290,7 +261,6 @@ void Graph::convertNetworkToDIMACS(std::string const& outFilename, Networks cons
                             	++n;
                             }
                             edgeSection << "e " << corresp[node.index_] << " " << corresp[connectedNode.index_] << std::endl;
-                            finishedPairs.push_back(std::make_pair(node.index_, connectedNode.index_));
                     	}
                     }
                 }
@@ -304,7 +274,7 @@ void Graph::convertNetworkToDIMACS(std::string const& outFilename, Networks cons
     dimacs << edgeSection.str();
 }
 
-void Graph::writeAtomToPDB(std::ofstream& os, int num, Node const& node, double force,
+void Graph::writeAtomToPDB(std::ostream& os, int num, Node const& node, double force,
     int numNetwork) const
 {
 	os << "ATOM"
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "gromacs/fda/ForceMatrix.h"
 #include "gromacs/math/vectypes.h"
 #include "Node.h"
 
@@ -25,33 +26,46 @@ class Graph
 {
 public:
 
+	typedef std::vector<int> Network;
+	typedef std::vector<Network> Networks;
+
 	Graph() {}
 
+	//! Build graph by sparse adjacency matrix without coordinates
+	explicit Graph(fda::ForceMatrix const& forceMatrix);
+
 	//! Build graph by adjacency matrix
-	Graph(std::vector<double> const& forceMatrix, rvec *coord, int *index, int isize);
+	Graph(std::vector<double> const& forceMatrix, const rvec *coord, int *index, int isize);
+
+	//! Build graph by sparse adjacency matrix
+	Graph(fda::ForceMatrix const& forceMatrix, const rvec *coord, int *index, int isize);
 
 	void convertInPDBMinGraphOrder(std::string const& outFilename, double threshold,
 		size_t minGraphOrder, bool onlyBiggestNetwork, bool append) const;
 
+	//! Write the networks of a single frame as PDB model into a stream
+	void convertInPDBMinGraphOrder(std::ostream& os, double threshold,
+		size_t minGraphOrder, bool onlyBiggestNetwork) const;
+
 	void convertInDIMACSMinGraphOrder(std::string const& outFilename, double threshold,
 		size_t minGraphOrder, bool onlyBiggestNetwork) const;
 
-	void updateCoordinates(rvec *coord, int *index, int isize);
+	void updateCoordinates(const rvec *coord, int *index, int isize);
 
-private:
+	//! Return the networks with at least minGraphOrder nodes connected by forces above threshold
+	Networks getNetworks(double threshold, size_t minGraphOrder) const;
 
-	typedef std::vector<int> Network;
-	typedef std::vector<Network> Networks;
+private:
 
 	void createNetworkMinGraphOrder(Networks& networks, double threshold, size_t minGraphOrder, bool onlyBiggestNetwork) const;
 
-	void convertNetworkToPDB(std::string const& outFilename, Networks const& networks, double threshold,
-		size_t minGraphOrder, bool append) const;
+	void convertNetworkToPDB(std::ostream& os, Networks const& networks, double threshold,
+		size_t minGraphOrder) const;
 
 	void convertNetworkToDIMACS(std::string const& outFilename, Networks const& networks, double threshold,
 		size_t minGraphOrder) const;
 
-	void writeAtomToPDB(std::ofstream& os, int num, Node const& node, double force,
+	void writeAtomToPDB(std::ostream& os, int num, Node const& node, double force,
         int numNetwork) const;
 
 	friend std::ostream& operator << (std::ostream& os, Graph const& graph);
@@ -60,6 +74,9 @@ private:
 
 	std::vector<int> indices_;
 
+	/// Position of the node of each index in nodes_
+	std::vector<int> positions_;
+
     static std::vector<std::string> colors;
 
     /// Flag for printing warning only one time per run.
@@ -0,0 +1,123 @@
+#ifndef ORDEREDFRAMEPIPELINE_H_
+#define ORDEREDFRAMEPIPELINE_H_
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+
+namespace fda_analysis {
+
+/**
+ * Frame-parallel processing with output in frame order
+ *
+ * The frames are pushed by the sequential reader stage and collected in batches.
+ * A full batch is passed to a worker thread, where its frames are processed by the
+ * OpenMP threads and the results are passed to the writer stage in the order of the
+ * frames as soon as they are ready. Meanwhile the reader collects the next batch.
+ * At most two batches are held in memory, the batch being read and the batch being processed.
+ */
+template <class Input, class Output>
+class OrderedFramePipeline
+{
+public:
+
+    /// Each frame is passed to a single thread only, so it can be consumed by the processing
+    typedef std::function<Output(Input&)> Process;
+    typedef std::function<void(Output const&)> Write;
+
+    OrderedFramePipeline(Process process, Write write, int batchSize = 4 * gmx_omp_get_max_threads())
+     : process_(process),
+       write_(write),
+       batchSize_(std::max(batchSize, 1))
+    {
+        inputs_.reserve(batchSize_);
+    }
+
+    /// Wait for the batch in process, pending frames which are not flushed are dropped
+    ~OrderedFramePipeline()
+    {
+        wait();
+    }
+
+    OrderedFramePipeline(OrderedFramePipeline const&) = delete;
+    OrderedFramePipeline& operator = (OrderedFramePipeline const&) = delete;
+
+    /// Add a frame, a full batch is started in the background
+    void push(Input&& input)
+    {
+        inputs_.push_back(std::move(input));
+        if (static_cast<int>(inputs_.size()) == batchSize_) start();
+    }
+
+    /// Process and write all pending frames
+    void flush()
+    {
+        if (!inputs_.empty()) start();
+        wait();
+    }
+
+private:
+
+    /// Pass the collected frames to the worker thread, the previous batch must be finished before
+    void start()
+    {
+        wait();
+        batch_.swap(inputs_);
+        inputs_.clear();
+        inputs_.reserve(batchSize_);
+        worker_ = std::thread([this] { process_batch(); });
+    }
+
+    /// Block until the batch in process is written
+    void wait()
+    {
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void process_batch()
+    {
+        int n = batch_.size();
+
+        #pragma omp parallel for ordered schedule(dynamic, 1)
+        for (int i = 0; i < n; ++i)
+        {
+            Output output;
+            try {
+                output = process_(batch_[i]);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+
+            #pragma omp ordered
+            {
+                try {
+                    write_(output);
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+            }
+        }
+    }
+
+    Process process_;
+
+    Write write_;
+
+    int batchSize_;
+
+    /// Frames collected by the reader
+    std::vector<Input> inputs_;
+
+    /// Frames of the batch in process
+    std::vector<Input> batch_;
+
+    /// Thread processing and writing batch_
+    std::thread worker_;
+
+};
+
+} // namespace fda_analysis
+
+#endif /* ORDEREDFRAMEPIPELINE_H_ */
@@ -66,16 +66,27 @@ PDB::PDB(std::string const& pdbFilename, std::vector<int> groupAtoms)
 
 void PDB::writePaths(std::string const& filename, std::vector< std::vector<int> > const& shortestPaths,
     std::vector<double> const& forceMatrix, bool append) const
+{
+    writePaths(filename, shortestPaths, fda::ForceMatrix(forceMatrix), append);
+}
+
+void PDB::writePaths(std::string const& filename, std::vector< std::vector<int> > const& shortestPaths,
+    fda::ForceMatrix const& forceMatrix, bool append) const
 {
     std::ofstream pdb;
     if (append) pdb.open(filename, std::ofstream::app);
     else pdb.open(filename);
     if (!pdb) gmx_fatal(FARGS, "Error opening pdb file.");
 
+    writePaths(pdb, shortestPaths, forceMatrix);
+}
+
+void PDB::writePaths(std::ostream& pdb, std::vector< std::vector<int> > const& shortestPaths,
+    fda::ForceMatrix const& forceMatrix) const
+{
     std::stringstream connections;
     int numAtom = 1;
     int numNetwork = 0;
-	int dim = std::sqrt(forceMatrix.size());
 
     real currentForce;
     bool valueToLargeForPDB = false;
@@ -87,7 +98,7 @@ void PDB::writePaths(std::string const& filename, std::vector< std::vector<int>
 			int i = path[n];
 			int j = path[n+1];
 
-            currentForce = forceMatrix[i*dim+j];
+            currentForce = forceMatrix(i, j);
             if (currentForce > 999.99) valueToLargeForPDB = true;
 
 			writeAtomToPDB(pdb, numAtom, indices_[i], coordinates_[i], currentForce, numNetwork);
@@ -100,6 +111,8 @@ void PDB::writePaths(std::string const& filename, std::vector< std::vector<int>
 		++numNetwork;
     }
 
+    // Frames can be written concurrently, the warning is printed only once
+    #pragma omp critical(fda_pdb_warning)
     if (virginValueToLargeForPDB and valueToLargeForPDB) {
         gmx_warning("Force values larger than 999.99 are detected. Therefore, the general PDB format of the b-factor column of Real(6.2) is broken. "
                     "It is tested that it works for Pymol and VMD, but it is not guaranteed that it will work for other visualization programs.");
@@ -131,7 +144,7 @@ void PDB::print() const
 		std::cerr << indices_[i] << " " << coordinates_[i][0] << " " << coordinates_[i][1] << " " << coordinates_[i][2] << std::endl;
 }
 
-void PDB::writeAtomToPDB(std::ofstream& os, int num, int index, Coordinate const& coord, double force,
+void PDB::writeAtomToPDB(std::ostream& os, int num, int index, Coordinate const& coord, double force,
     int numNetwork) const
 {
 	os << "ATOM"
@@ -8,9 +8,11 @@
 #ifndef PDB_H_
 #define PDB_H_
 
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <boost/array.hpp> // back-compatibility to gcc-4.7.2
+#include "gromacs/fda/ForceMatrix.h"
 #include "gromacs/math/vectypes.h"
 
 namespace fda_analysis {
@@ -34,6 +36,13 @@ public:
     void writePaths(std::string const& filename, std::vector< std::vector<int> > const& shortestPaths,
         std::vector<double> const& forceMatrix, bool append) const;
 
+    void writePaths(std::string const& filename, std::vector< std::vector<int> > const& shortestPaths,
+        fda::ForceMatrix const& forceMatrix, bool append) const;
+
+    /// Write the paths of a single frame as PDB model into a stream
+    void writePaths(std::ostream& os, std::vector< std::vector<int> > const& shortestPaths,
+        fda::ForceMatrix const& forceMatrix) const;
+
     /// Update with coordinates of trajectory file.
     /// Values will be converted from nm into Angstrom.
     void updateCoordinates(const rvec x[]);
@@ -45,7 +54,7 @@ public:
 
 private:
 
-	void writeAtomToPDB(std::ofstream& os, int num, int index, Coordinate const& coord, double force,
+	void writeAtomToPDB(std::ostream& os, int num, int index, Coordinate const& coord, double force,
         int numNetwork) const;
 
 	/// Abort if not sanity.
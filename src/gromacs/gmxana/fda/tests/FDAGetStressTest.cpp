@@ -5,10 +5,12 @@
  *      Author: Bernd Doser, HITS gGmbH <bernd.doser@h-its.org>
  */
 
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <gtest/gtest.h>
+#include "gromacs/fda/Stress.h"
 #include "gromacs/gmxana/fda/Helpers.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/options/filenameoption.h"
@@ -118,6 +120,59 @@ INSTANTIATE_TEST_CASE_P(AllFDAGetStress, FDAGetStress, ::testing::Values(
     )
 ));
 
+//! Test fixture for the options of gmx_fda_get_stress
+struct FDAGetStressOptions : public CommandLineTestBase
+{
+    /// Run gmx_fda_get_stress in a copy of the glycine trimer test data, return the stress of all frames
+    fda::Stress::StressFrameArrayType run(std::vector<std::string> const& options, std::string const& result)
+    {
+        std::string cwd = gmx::Path::getWorkingDirectory();
+        std::string dataPath = std::string(fileManager().getInputDataDirectory()) + "/data/glycine_trimer";
+        std::string testPath = fileManager().getTemporaryFilePath("/glycine_trimer");
+
+        std::string cmd = "mkdir -p " + testPath + " && cp -r " + dataPath + "/* " + testPath;
+        EXPECT_FALSE(system(cmd.c_str()));
+
+        gmx_chdir(testPath.c_str());
+
+        ::gmx::test::CommandLine caller;
+        caller.append("gmx_fda fda_get_stress");
+        caller.addOption("-i", "fda.pfr");
+        for (auto const& option : options) caller.append(option);
+        caller.addOption("-o", result);
+
+        EXPECT_FALSE(gmx_fda_get_stress(caller.argc(), caller.argv()));
+
+        fda::Stress::StressFrameArrayType stress = fda::Stress(result).get_stress();
+        gmx_chdir(cwd.c_str());
+        return stress;
+    }
+};
+
+TEST_F(FDAGetStressOptions, binary)
+{
+    auto text = run({}, "result.psr");
+    auto binary = run({"-binary"}, "result_binary.psr");
+
+    ASSERT_EQ(text.size(), binary.size());
+    for (size_t frame = 0; frame != text.size(); ++frame) {
+        ASSERT_EQ(text[frame].size(), binary[frame].size());
+        for (size_t i = 0; i != text[frame].size(); ++i) {
+            EXPECT_NEAR(text[frame][i], binary[frame][i], 1e-6 * std::abs(binary[frame][i]));
+        }
+    }
+}
+
+TEST_F(FDAGetStressOptions, diff)
+{
+    auto stress = run({"-diff", "fda.pfr"}, "result_diff.psr");
+
+    EXPECT_FALSE(stress.empty());
+    for (auto const& frame : stress) {
+        for (auto value : frame) EXPECT_EQ(0.0, value);
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
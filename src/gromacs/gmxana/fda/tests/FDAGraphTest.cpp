@@ -134,35 +134,35 @@ INSTANTIATE_TEST_CASE_P(AllFDAGraphTests, FDAGraphTest, ::testing::Values(
     ),
     TestDataStructure(
         "alagly",
-        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "0"},
+        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "0", "-t", "20", "-convert"},
         "",
         "result.pdb",
         "FDAGraphTest.ref2.pdb"
     ),
     TestDataStructure(
         "alagly",
-        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "all", "-t", "1000", "-pymol", "result.pml"},
+        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "all", "-t", "1000", "-pymol", "result.pml", "-convert"},
         "",
         "result.pdb",
         "FDAGraphTest.ref3.pdb"
     ),
     TestDataStructure(
         "alagly",
-        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "skip 3", "-t", "1000", "-pymol", "result.pml"},
+        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "skip 3", "-t", "1000", "-pymol", "result.pml", "-convert"},
         "",
         "result.pdb",
         "FDAGraphTest.ref4.pdb"
     ),
     TestDataStructure(
         "alagly",
-        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "average 3", "-t", "1000", "-pymol", "result.pml"},
+        {"-i", "fda.pfa", "-s", "conf.gro", "-frame", "average 3", "-t", "1000", "-pymol", "result.pml", "-convert"},
         "",
         "result.pdb",
         "FDAGraphTest.ref5.pdb"
     ),
     TestDataStructure(
         "glycine_trimer",
-        {"-i", "fda.pfr", "-s", "glycine_trimer.pdb", "-f", "traj.trr", "-n", "index.ndx", "-frame", "all", "-pymol", "result.pml"},
+        {"-i", "fda.pfr", "-s", "glycine_trimer.pdb", "-f", "traj.trr", "-n", "index.ndx", "-frame", "all", "-t", "1000", "-pymol", "result.pml", "-convert"},
         "C-alpha",
         "result.pdb",
         "FDAGraphTest.ref6.pdb"
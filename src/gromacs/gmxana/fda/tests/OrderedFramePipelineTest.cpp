@@ -0,0 +1,27 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "gromacs/gmxana/fda/OrderedFramePipeline.h"
+
+using namespace fda_analysis;
+
+//! Frames are written in the order they were pushed, independent of the processing time
+TEST(OrderedFramePipelineTest, FrameOrder)
+{
+    std::vector<std::string> written;
+    OrderedFramePipeline<int, std::string> pipeline(
+        [](int& frame) {
+            // Later frames of a batch are cheaper to process
+            volatile double sum = 0.0;
+            for (int i = 0; i < (100 - frame % 7) * 10000; ++i) sum += i;
+            return std::to_string(frame);
+        },
+        [&written](std::string const& result) { written.push_back(result); },
+        7);
+
+    for (int frame = 0; frame < 100; ++frame) pipeline.push(int(frame));
+    pipeline.flush();
+
+    ASSERT_EQ(100U, written.size());
+    for (int frame = 0; frame < 100; ++frame) EXPECT_EQ(std::to_string(frame), written[frame]);
+}
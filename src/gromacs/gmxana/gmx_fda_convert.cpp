@@ -9,6 +9,7 @@
 #include "gmx_ana.h"
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
+#include "gromacs/fda/CompatPairwiseForces.h"
 #include "gromacs/fda/PairwiseForces.h"
 #include <gromacs/fda/Stress.h>
 #include "gromacs/fileio/oenv.h"
@@ -33,6 +34,8 @@ int gmx_fda_convert(int argc, char *argv[])
         "[THISMODULE] converts pairwise forces, punctual, and virial stress files"
     	"from text- into binary-format and vice versa."
         "If the input is binary format the output will be text-based and vice versa."
+        " Pairwise forces in compat format (version 1.5 text or 2.0) are converted "
+        "into the scalar pairwise forces format."
     };
 
     gmx_output_env_t *oenv;
@@ -55,7 +58,11 @@ int gmx_fda_convert(int argc, char *argv[])
     if (fn2ftp(opt2fn("-i", NFILE, fnm)) != fn2ftp(opt2fn("-o", NFILE, fnm)))
         gmx_fatal(FARGS, "Input and output file type must be identical.");
 
-    if (fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFA or fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFR) {
+    if ((fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFA or fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFR)
+        and fda::CompatPairwiseForces::is_compat(opt2fn("-i", NFILE, fnm))) {
+        fda::CompatPairwiseForces pairwise_forces(opt2fn("-i", NFILE, fnm));
+        pairwise_forces.write(opt2fn("-o", NFILE, fnm), !pairwise_forces.get_is_binary());
+    } else if (fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFA or fn2ftp(opt2fn("-i", NFILE, fnm)) == efPFR) {
         fda::PairwiseForces<fda::Force<real>> pairwise_forces(opt2fn("-i", NFILE, fnm));
         pairwise_forces.write(opt2fn("-o", NFILE, fnm), !pairwise_forces.get_is_binary());
     } else if (fn2ftp(opt2fn("-i", NFILE, fnm)) == efPSA or fn2ftp(opt2fn("-i", NFILE, fnm)) == efPSR
@@ -10,16 +10,19 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <cstddef>
 #include <vector>
-#include "fda/Graph.h"
 #include "fda/Helpers.h"
 #include "gmx_ana.h"
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/commandline/pargs.h"
+#include "gromacs/fda/ForceMatrix.h"
+#include "gromacs/fda/FrameIndex.h"
 #include "gromacs/fda/PairwiseForces.h"
+#include "gromacs/fda/ResultType.h"
 #include "gromacs/fileio/oenv.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
@@ -43,10 +46,18 @@ int gmx_fda_get_stress(int argc, char *argv[])
     const char *desc[] = {
         "[THISMODULE] calculate the punctual stress by pairwise forces. "
         "If the optional file [TT]-diff[tt] is used "
-        "the differences of the pairwise forces will be taken."
+        "the differences of the pairwise forces will be taken. "
+        "The pairwise forces are streamed frame by frame, so that only the interacting pairs of a "
+        "single frame are kept in memory. "
+        "The option [TT]-binary[tt] writes the punctual stress in binary format."
     };
 
     gmx_output_env_t *oenv;
+    bool binary = false;
+
+    t_pargs pa[] = {
+        { "-binary", FALSE, etBOOL, {&binary}, "Write the punctual stress in binary format" }
+    };
 
     t_filenm fnm[] = {
         { efPFX, "-i", nullptr, ffREAD },
@@ -57,20 +68,22 @@ int gmx_fda_get_stress(int argc, char *argv[])
 #define NFILE asize(fnm)
 
     if (!parse_common_args(&argc, argv, PCA_CAN_TIME,
-        NFILE, fnm, 0, nullptr, asize(desc), desc, 0, nullptr, &oenv)) return 0;
+        NFILE, fnm, asize(pa), pa, asize(desc), desc, 0, nullptr, &oenv)) return 0;
+
+    if (opt2bSet("-diff", NFILE, fnm) and (fn2ftp(opt2fn("-diff", NFILE, fnm)) != fn2ftp(opt2fn("-i", NFILE, fnm))))
+        gmx_fatal(FARGS, "Type of the file (-diff) does not match the type of the file (-i).");
 
     // Open pairwise forces file
     fda::PairwiseForces<fda::Force<real>> pairwise_forces(opt2fn("-i", NFILE, fnm));
-    fda::PairwiseForces<fda::Force<real>> pairwise_forces_diff(opt2fn("-diff", NFILE, fnm));
+    std::shared_ptr<fda::PairwiseForces<fda::Force<real>>> ptr_pairwise_forces_diff;
+    if (opt2bSet("-diff", NFILE, fnm)) {
+        ptr_pairwise_forces_diff = std::make_shared<fda::PairwiseForces<fda::Force<real>>>(opt2fn("-diff", NFILE, fnm));
+    }
 
     size_t nbFrames = pairwise_forces.get_number_of_frames();
     size_t nbParticles = pairwise_forces.get_max_index_second_column_first_frame() + 1;
-    size_t nbParticles2 = nbParticles * nbParticles;
 
-    if (opt2bSet("-diff", NFILE, fnm) and (fn2ftp(opt2fn("-diff", NFILE, fnm)) != fn2ftp(opt2fn("-i", NFILE, fnm))))
-        gmx_fatal(FARGS, "Type of the file (-diff) does not match the type of the file (-i).");
-
-    if (opt2bSet("-diff", NFILE, fnm) and pairwise_forces_diff.get_number_of_frames() != nbFrames)
+    if (ptr_pairwise_forces_diff and ptr_pairwise_forces_diff->get_number_of_frames() != nbFrames)
         gmx_fatal(FARGS, "Number of frames is not identical between the two pairwise force files.");
 
 #ifdef PRINT_DEBUG
@@ -79,27 +92,48 @@ int gmx_fda_get_stress(int argc, char *argv[])
         std::cout << "result filename = " << opt2fn("-o", NFILE, fnm) << std::endl;
         std::cout << "nbFrames = " << nbFrames << std::endl;
         std::cout << "nbParticles = " << nbParticles << std::endl;
+        std::cout << "binary = " << binary << std::endl;
 #endif
 
-    std::ofstream opsFile(opt2fn("-o", NFILE, fnm));
-    if (!opsFile) gmx_fatal(FARGS, "Error opening file %s", opt2fn("-o", NFILE, fnm));
-    opsFile << std::scientific << std::setprecision(6)
-            << "punctual_stress\n";
+    std::ofstream opsFile;
+    fda::FrameIndex frameIndex;
+    if (binary) {
+        opsFile.open(opt2fn("-o", NFILE, fnm), std::ofstream::binary);
+        if (!opsFile) gmx_fatal(FARGS, "Error opening file %s", opt2fn("-o", NFILE, fnm));
+        char b = 'b';
+        opsFile.write(&b, 1);
+        uint nbValues = nbParticles;
+        opsFile.write(reinterpret_cast<char*>(&nbValues), sizeof(uint));
+    } else {
+        opsFile.open(opt2fn("-o", NFILE, fnm));
+        if (!opsFile) gmx_fatal(FARGS, "Error opening file %s", opt2fn("-o", NFILE, fnm));
+        opsFile << std::scientific << std::setprecision(6)
+                << fda::ResultType::PUNCTUAL_STRESS << "\n";
+    }
 
+    std::vector<real> stress(nbParticles);
     for (size_t frame = 0; frame != nbFrames; ++frame)
     {
-        std::vector<double> forceMatrix = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-        if (opt2bSet("-diff", NFILE, fnm)) {
-            std::vector<double> forceMatrix2 = pairwise_forces_diff.get_forcematrix_of_frame(nbParticles, frame);
-            for (size_t i = 0; i < nbParticles2; ++i) forceMatrix[i] -= forceMatrix2[i];
+        // Sparse matrix of the interacting pairs, the pairs of both files are joined in sorted order
+        fda::ForceMatrix forceMatrix = pairwise_forces.get_sparse_forcematrix_of_frame(nbParticles, frame);
+        if (ptr_pairwise_forces_diff) forceMatrix -= ptr_pairwise_forces_diff->get_sparse_forcematrix_of_frame(nbParticles, frame);
+
+        // The columns of each row are summed in ascending order
+        std::fill(stress.begin(), stress.end(), 0.0);
+        forceMatrix.for_each([&stress](int i, int, double force) { stress[i] += std::abs(force); });
+
+        if (binary) {
+            frameIndex.add(opsFile.tellp());
+            opsFile.write(reinterpret_cast<char*>(stress.data()), nbParticles * sizeof(real));
+        } else {
+            for (auto value : stress) opsFile << value << " ";
+            opsFile << std::endl;
         }
+    }
 
-        for (size_t i = 0; i < nbParticles; ++i) {
-        real value = 0.0;
-            for (size_t j = 0; j < nbParticles; ++j) value += std::abs(forceMatrix[i*nbParticles + j]);
-            opsFile << value << " ";
-        }
-        opsFile << std::endl;
+    if (binary) {
+        frameIndex.set_end_of_frames(opsFile.tellp());
+        frameIndex.write(opsFile);
     }
 
     std::cout << "All done." << std::endl;
@@ -10,12 +10,14 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "fda/EnumParser.h"
 #include "fda/FrameType.h"
 #include "fda/Graph.h"
 #include "fda/Helpers.h"
+#include "fda/OrderedFramePipeline.h"
 #include "fda/ResultFormat.h"
 #include "gmx_ana.h"
 #include "gromacs/commandline/filenm.h"
@@ -44,6 +46,17 @@ using namespace fda_analysis;
 
 #define PRINT_DEBUG
 
+namespace {
+
+/// Reduced force matrix and coordinates of a frame
+struct GraphFrame
+{
+    fda::ForceMatrix forceMatrix;
+    std::vector<gmx::RVec> coord;
+};
+
+} // namespace
+
 int gmx_fda_graph(int argc, char *argv[])
 {
     const char *desc[] = {
@@ -62,11 +75,11 @@ int gmx_fda_graph(int argc, char *argv[])
     };
 
     gmx_output_env_t *oenv;
-    static real threshold = 0.0;
-    static const char* frameString = "average 1";
-    static int minGraphOrder = 2;
-    static bool onlyBiggestNetwork = false;
-    static bool convert = false;
+    real threshold = 0.0;
+    const char* frameString = "average 1";
+    int minGraphOrder = 2;
+    bool onlyBiggestNetwork = false;
+    bool convert = false;
 
     t_pargs pa[] = {
         { "-frame", FALSE, etSTR, {&frameString}, "Specify a single frame number or \"average n\" to take the mean over every n-th frame"
@@ -107,7 +120,6 @@ int gmx_fda_graph(int argc, char *argv[])
 
     // Get number of particles
     int nbParticles = pairwise_forces.get_max_index_second_column_first_frame() + 1;
-    int nbParticles2 = nbParticles * nbParticles;
 
     // Interactive input of group name for residue model points
     int isize = 0;
@@ -148,7 +160,14 @@ int gmx_fda_graph(int argc, char *argv[])
     matrix box;
     read_tps_conf(ftp2fn(efTPS, NFILE, fnm), &top, &ePBC, &coord, nullptr, box, TRUE);
 
-    std::vector<double> forceMatrix, forceMatrix2;
+    // Prepare the sparse force matrix of a frame, the differences are taken if -diff is set
+    auto prepareForceMatrix = [&](int frame, fda::ForceMatrix& forceMatrix) {
+        if (ptr_pairwise_forces_diff) forceMatrix -= ptr_pairwise_forces_diff->get_sparse_forcematrix_of_frame(nbParticles, frame);
+        forceMatrix.abs();
+
+        // Convert from kJ/mol/nm into pN
+        if (convert) forceMatrix *= 1.66;
+    };
 
     // Pymol pml-file
     std::string molecularTrajectoryFilename = "traj.pdb";
@@ -165,16 +184,8 @@ int gmx_fda_graph(int argc, char *argv[])
 
     if (frameType == SINGLE) {
 
-        forceMatrix = pairwise_forces.get_forcematrix_of_frame(nbParticles, frameValue);
-        if (opt2bSet("-diff", NFILE, fnm)) {
-            forceMatrix2 = ptr_pairwise_forces_diff->get_forcematrix_of_frame(nbParticles, frameValue);
-        }
-
-        if (opt2bSet("-diff", NFILE, fnm)) for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] -= forceMatrix2[i];
-        for (auto & f : forceMatrix) f = std::abs(f);
-
-        // Convert from kJ/mol/nm into pN
-        if (convert) for (auto & f : forceMatrix) f *= 1.66;
+        fda::ForceMatrix forceMatrix = pairwise_forces.get_sparse_forcematrix_of_frame(nbParticles, frameValue);
+        prepareForceMatrix(frameValue, forceMatrix);
 
         Graph graph(forceMatrix, coord, index, isize);
         if (resultFormat == PDB)
@@ -187,65 +198,48 @@ int gmx_fda_graph(int argc, char *argv[])
         if (resultFormat == DIMACS) gmx_fatal(FARGS, "DIMACS format is not supported for multiple frames.");
 
         // Read trajectory coordinates
-        t_trxstatus *status;
+        t_trxstatus *status = nullptr;
         real time;
         rvec *coord_traj;
         matrix box;
+        int natoms = 0;
+        int trajectoryFrame = -1;
 
-        int nbFrames = pairwise_forces.get_number_of_frames();
-        for (int frame = 0; frame < nbFrames; ++frame)
-        {
-            if (frame == 0) read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
-            else read_next_x(oenv, status, &time, coord_traj, box);
-
-            if (frameType == SKIP and frame%frameValue) continue;
-
-            forceMatrix = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-            if (opt2bSet("-diff", NFILE, fnm)) {
-                forceMatrix2 = ptr_pairwise_forces_diff->get_forcematrix_of_frame(nbParticles, frame);
-                for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] -= forceMatrix2[i];
-            }
-            for (auto & f : forceMatrix) f = std::abs(f);
-
-            // Convert from kJ/mol/nm into pN
-            if (convert) for (auto & f : forceMatrix) f *= 1.66;
-
-            if (frameType == AVERAGE) {
-                for (int frameAvg = 0; frameAvg < frameValue - 1; ++frameAvg)
-                {
-                    std::vector<double> forceMatrixAvg, forceMatrixAvg2;
-                    forceMatrixAvg = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-                    if (opt2bSet("-diff", NFILE, fnm)) {
-                        forceMatrixAvg2 = ptr_pairwise_forces_diff->get_forcematrix_of_frame(nbParticles, frame);
-                        for (int i = 0; i < nbParticles2; ++i) forceMatrixAvg[i] -= forceMatrixAvg2[i];
-                    }
-
-                    for (auto & f : forceMatrixAvg) f = std::abs(f);
+        std::ofstream pdb(opt2fn("-o", NFILE, fnm));
+        if (!pdb) gmx_fatal(FARGS, "Error opening pdb file.");
 
-                    // Convert from kJ/mol/nm into pN
-                    if (convert) for (auto & f : forceMatrixAvg) f *= 1.66;
-
-                    for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] += forceMatrixAvg[i];
-                }
-                for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] /= frameValue;
+        // Frames are read in sequence, the networks are built in parallel and written in the order of the frames
+        OrderedFramePipeline<GraphFrame, std::string> pipeline(
+            [&](GraphFrame const& graphFrame)
+        {
+            Graph graph(graphFrame.forceMatrix, as_rvec_array(graphFrame.coord.data()), index, isize);
+            std::ostringstream os;
+            graph.convertInPDBMinGraphOrder(os, threshold, minGraphOrder, onlyBiggestNetwork);
+            return os.str();
+        },
+            [&pdb](std::string const& model) { pdb << model; });
+
+        // The force matrices are read once, frames of an average are combined in a single pass
+        fda::ForceMatrixReducer reducer(frameType == AVERAGE ? fda::FrameReduction::BLOCK_MEAN : fda::FrameReduction::EVERY_NTH,
+            frameType == ALL ? 1 : frameValue);
+
+        pairwise_forces.reduce_forcematrices(nbParticles, reducer, prepareForceMatrix,
+            [&](int frame, fda::ForceMatrix const& forceMatrix)
+        {
+            // Coordinates of the first frame of an average
+            for (; trajectoryFrame < frame; ++trajectoryFrame) {
+                if (trajectoryFrame == -1) natoms = read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
+                else read_next_x(oenv, status, &time, coord_traj, box);
             }
 
-            Graph graph(forceMatrix, coord_traj, index, isize);
-            graph.convertInPDBMinGraphOrder(opt2fn("-o", NFILE, fnm), threshold, minGraphOrder, onlyBiggestNetwork, frame);
+            pipeline.push(GraphFrame{forceMatrix, std::vector<gmx::RVec>(coord_traj, coord_traj + natoms)});
 
             // Write moleculare trajectory for pymol script
             if (opt2bSet("-pymol", NFILE, fnm))
                 write_pdbfile(molecularTrajectoryFile, "FDA trajectory for Pymol visualization", &top.atoms, coord_traj, ePBC, box, ' ', 0, nullptr, TRUE);
-
-            if (frameType == AVERAGE) {
-                frame += frameValue - 1;
-                // It would be better to skip the next frameValue - 1 frames instead of reading them.
-                for (int frameAvg = 0; frameAvg < frameValue - 1; ++frameAvg) {
-                    read_next_x(oenv, status, &time, coord_traj, box);
-                }
-            }
-        }
-        close_trx(status);
+        });
+        pipeline.flush();
+        if (status) close_trx(status);
     }
 
     if (opt2bSet("-pymol", NFILE, fnm)) gmx_ffclose(molecularTrajectoryFile);
@@ -10,12 +10,15 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "fda/BoostGraph.h"
 #include "fda/EnumParser.h"
 #include "fda/FrameType.h"
 #include "fda/Helpers.h"
+#include "fda/OrderedFramePipeline.h"
 #include "fda/PDB.h"
 #include "gmx_ana.h"
 #include "gromacs/commandline/filenm.h"
@@ -42,6 +45,17 @@ using namespace fda_analysis;
 
 #define PRINT_DEBUG
 
+namespace {
+
+/// Reduced force matrix and coordinates of a frame
+struct PathFrame
+{
+    fda::ForceMatrix forceMatrix;
+    std::vector<gmx::RVec> coord;
+};
+
+} // namespace
+
 int gmx_fda_shortest_path(int argc, char *argv[])
 {
     const char *desc[] = {
@@ -97,11 +111,13 @@ int gmx_fda_shortest_path(int argc, char *argv[])
 
     // Open pairwise forces file
     fda::PairwiseForces<fda::Force<real>> pairwise_forces(opt2fn("-i", NFILE, fnm));
-    fda::PairwiseForces<fda::Force<real>> pairwise_forces_diff(opt2fn("-diff", NFILE, fnm));
+    std::shared_ptr<fda::PairwiseForces<fda::Force<real>>> ptr_pairwise_forces_diff;
+    if (opt2bSet("-diff", NFILE, fnm)) {
+        ptr_pairwise_forces_diff = std::make_shared<fda::PairwiseForces<fda::Force<real>>>(opt2fn("-diff", NFILE, fnm));
+    }
 
     // Get number of particles
     int nbParticles = pairwise_forces.get_max_index_second_column_first_frame() + 1;
-    int nbParticles2 = nbParticles * nbParticles;
 
     // Interactive input of group name for residue model points
     int isize = 0;
@@ -137,7 +153,14 @@ int gmx_fda_shortest_path(int argc, char *argv[])
 
     PDB pdb(opt2fn("-s", NFILE, fnm), std::vector<int>(index, index + isize));
 
-    std::vector<double> forceMatrix, forceMatrix2;
+    // Prepare the sparse force matrix of a frame, the differences are taken if -diff is set
+    auto prepareForceMatrix = [&](int frame, fda::ForceMatrix& forceMatrix) {
+        if (ptr_pairwise_forces_diff) forceMatrix -= ptr_pairwise_forces_diff->get_sparse_forcematrix_of_frame(nbParticles, frame);
+        forceMatrix.abs();
+
+        // Convert from kJ/mol/nm into pN
+        if (convert) forceMatrix *= 1.66;
+    };
 
     // Pymol pml-file
     std::string molecularTrajectoryFilename = "traj.pdb";
@@ -154,16 +177,8 @@ int gmx_fda_shortest_path(int argc, char *argv[])
     if (frameType == SINGLE) {
 
         int frame = atoi(frameString);
-        forceMatrix = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-        if (opt2bSet("-diff", NFILE, fnm)) {
-            forceMatrix2 = pairwise_forces_diff.get_forcematrix_of_frame(nbParticles, frame);
-            for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] -= forceMatrix2[i];
-        }
-
-        for (auto & f : forceMatrix) f = std::abs(f);
-
-        // Convert from kJ/mol/nm into pN
-        if (convert) for (auto & f : forceMatrix) f *= 1.66;
+        fda::ForceMatrix forceMatrix = pairwise_forces.get_sparse_forcematrix_of_frame(nbParticles, frame);
+        prepareForceMatrix(frame, forceMatrix);
 
         BoostGraph graph(forceMatrix);
         BoostGraph::PathList shortestPaths = graph.findKShortestPaths(source, dest, numberOfShortestPaths);
@@ -173,68 +188,52 @@ int gmx_fda_shortest_path(int argc, char *argv[])
     } else {
 
         // Read trajectory coordinates
-        t_trxstatus *status;
+        t_trxstatus *status = nullptr;
         real time;
         rvec *coord_traj;
         matrix box;
+        int natoms = 0;
+        int trajectoryFrame = -1;
 
-        int nbFrames = pairwise_forces.get_number_of_frames();
-        for (int frame = 0; frame < nbFrames; ++frame)
-        {
-            if (frame == 0) read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
-            else read_next_x(oenv, status, &time, coord_traj, box);
+        std::ofstream pdbFile(opt2fn("-o", NFILE, fnm));
+        if (!pdbFile) gmx_fatal(FARGS, "Error opening pdb file.");
 
-            if (frameType == SKIP and frame%frameValue) continue;
-
-            forceMatrix = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-            if (opt2bSet("-diff", NFILE, fnm)) {
-                forceMatrix2 = pairwise_forces_diff.get_forcematrix_of_frame(nbParticles, frame);
-                for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] -= forceMatrix2[i];
-            }
-            for (auto & f : forceMatrix) f = std::abs(f);
-
-            // Convert from kJ/mol/nm into pN
-            if (convert) for (auto & f : forceMatrix) f *= 1.66;
-
-            if (frameType == AVERAGE) {
-                for (int frameAvg = 0; frameAvg < frameValue - 1; ++frameAvg)
-                {
-                    std::vector<double> forceMatrixAvg, forceMatrixAvg2;
-                    forceMatrixAvg = pairwise_forces.get_forcematrix_of_frame(nbParticles, frame);
-                    if (opt2bSet("-diff", NFILE, fnm)) {
-                        forceMatrixAvg2 = pairwise_forces_diff.get_forcematrix_of_frame(nbParticles, frame);
-                        for (int i = 0; i < nbParticles2; ++i) forceMatrixAvg[i] -= forceMatrixAvg2[i];
-                    }
+        // Frames are read in sequence, the paths are searched in parallel and written in the order of the frames
+        OrderedFramePipeline<PathFrame, std::string> pipeline(
+            [&](PathFrame const& pathFrame)
+        {
+            BoostGraph graph(pathFrame.forceMatrix);
+            BoostGraph::PathList shortestPaths = graph.findKShortestPaths(source, dest, numberOfShortestPaths);
 
-                    for (auto & f : forceMatrixAvg) f = std::abs(f);
+            PDB framePDB(pdb);
+            framePDB.updateCoordinates(as_rvec_array(pathFrame.coord.data()));
+            std::ostringstream os;
+            framePDB.writePaths(os, shortestPaths, pathFrame.forceMatrix);
+            return os.str();
+        },
+            [&pdbFile](std::string const& model) { pdbFile << model; });
 
-                    // Convert from kJ/mol/nm into pN
-                    if (convert) for (auto & f : forceMatrixAvg) f *= 1.66;
+        // The force matrices are read once, frames of an average are combined in a single pass
+        fda::ForceMatrixReducer reducer(frameType == AVERAGE ? fda::FrameReduction::BLOCK_MEAN : fda::FrameReduction::EVERY_NTH,
+            frameType == ALL ? 1 : frameValue);
 
-                    for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] += forceMatrixAvg[i];
-                }
-                for (int i = 0; i < nbParticles2; ++i) forceMatrix[i] /= frameValue;
+        pairwise_forces.reduce_forcematrices(nbParticles, reducer, prepareForceMatrix,
+            [&](int frame, fda::ForceMatrix const& forceMatrix)
+        {
+            // Coordinates of the first frame of an average
+            for (; trajectoryFrame < frame; ++trajectoryFrame) {
+                if (trajectoryFrame == -1) natoms = read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
+                else read_next_x(oenv, status, &time, coord_traj, box);
             }
 
-            BoostGraph graph(forceMatrix);
-            BoostGraph::PathList shortestPaths = graph.findKShortestPaths(source, dest, numberOfShortestPaths);
-
-            pdb.updateCoordinates(coord_traj);
-            pdb.writePaths(opt2fn("-o", NFILE, fnm), shortestPaths, forceMatrix, frame);
+            pipeline.push(PathFrame{forceMatrix, std::vector<gmx::RVec>(coord_traj, coord_traj + natoms)});
 
             // Write moleculare trajectory for pymol script
             if (opt2bSet("-pymol", NFILE, fnm))
                 write_pdbfile(molecularTrajectoryFile, "FDA trajectory for Pymol visualization", &top.atoms, coord_traj, ePBC, box, ' ', 0, nullptr, TRUE);
-
-            if (frameType == AVERAGE) {
-                frame += frameValue - 1;
-                // It would be better to skip the next frameValue - 1 frames instead of reading them.
-                for (int frameAvg = 0; frameAvg < frameValue - 1; ++frameAvg) {
-                    read_next_x(oenv, status, &time, coord_traj, box);
-                }
-            }
-        }
-        close_trx(status);
+        });
+        pipeline.flush();
+        if (status) close_trx(status);
     }
 
     if (opt2bSet("-pymol", NFILE, fnm)) gmx_ffclose(molecularTrajectoryFile);
@@ -10,10 +10,12 @@
 #include <iostream>
 #include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 #include "fda/EnumParser.h"
 #include "fda/FrameType.h"
 #include "fda/Helpers.h"
+#include "fda/OrderedFramePipeline.h"
 #include "fda/ParticleType.h"
 #include "fda/StressType.h"
 #include "gmx_ana.h"
@@ -25,12 +27,14 @@
 #include "gromacs/fileio/pdbio.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
+#include "gromacs/math/vec.h"
 #include "gromacs/math/vectypes.h"
 #include "gromacs/topology/atoms.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/real.h"
@@ -44,6 +48,19 @@ using namespace fda_analysis;
 
 #define PRINT_DEBUG
 
+namespace {
+
+/// Coordinates and stress of a frame
+struct StressFrame
+{
+    int frame;
+    std::vector<gmx::RVec> coord;
+    matrix box;
+    fda::Stress::StressType stress;
+};
+
+} // namespace
+
 int gmx_fda_view_stress(int argc, char *argv[])
 {
     const char *desc[] = {
@@ -105,9 +122,9 @@ int gmx_fda_view_stress(int argc, char *argv[])
     FrameType frameType = getFrameTypeAndSkipValue(frameString, frameValue);
 
     fda::Stress stress_reader(opt2fn("-i", NFILE, fnm));
-    auto&& stress = stress_reader.get_stress();
-    int nbFrames = stress.size();
-    int nbParticles = stress[0].size();
+    int nbFrames = stress_reader.get_number_of_frames();
+    if (nbFrames == 0) gmx_fatal(FARGS, "No frame found.");
+    int nbParticles = stress_reader.get_stress_of_frame(0).size();
 
     // Interactive input of group name for residue model points
     int isize = 0;
@@ -131,13 +148,17 @@ int gmx_fda_view_stress(int argc, char *argv[])
     if (fn2ftp(opt2fn("-o", NFILE, fnm)) == efPDB and !ftp2fn_null(efTPS, NFILE, fnm)) gmx_fatal(FARGS, "Input structure is missing.");
     if (stressType != PUNCTUAL and convert) gmx_fatal(FARGS, "Option -convert makes only sense for punctual stress.");
 
-    for (auto&& frame : stress) {
-        for (auto&& elem : frame) {
+    // Frames are read on demand using the frame index of the stress file
+    auto getStressOfFrame = [&](int frame) -> fda::Stress::StressType {
+        fda::Stress::StressType stress = stress_reader.get_stress_of_frame(frame);
+        stress.resize(nbParticles, 0.0);
+        for (auto&& elem : stress) {
         	elem = std::abs(elem);
             // Convert from kJ/mol/nm into pN
         	if (convert) elem *= 1.66;
         }
-    }
+        return stress;
+    };
 
     std::string title;
     if (stressType == PUNCTUAL) title += "Punctual ";
@@ -164,8 +185,9 @@ int gmx_fda_view_stress(int argc, char *argv[])
 
             FILE *fp = gmx_ffopen(opt2fn("-o", NFILE, fnm), "w");
 
+            auto&& stress = getStressOfFrame(frameValue);
             for (int i = 0; i < nbParticles; ++i) {
-                currentStress = stress[frameValue][i];
+                currentStress = stress[i];
                 if (currentStress > 999.99) {
                     top.atoms.pdbinfo[i].bfac = 999.99;
                     valueToLargeForPDB = true;
@@ -183,28 +205,45 @@ int gmx_fda_view_stress(int argc, char *argv[])
             real time;
             rvec *coord_traj;
             matrix box;
-            read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
+            int natoms = read_first_x(oenv, &status, opt2fn("-f", NFILE, fnm), &time, &coord_traj, box);
 
-            for (int frame = 0; frame < nbFrames; ++frame)
-            {
-                read_next_x(oenv, status, &time, coord_traj, box);
-                if (frame%frameValue) continue;
-
-                FILE *fp = nullptr;
-                if (frame) fp = gmx_ffopen(opt2fn("-o", NFILE, fnm), "a");
-                else fp = gmx_ffopen(opt2fn("-o", NFILE, fnm), "w");
+            FILE *fp = gmx_ffopen(opt2fn("-o", NFILE, fnm), "w");
 
+            // Frames are read in sequence, the stress is decoded in parallel and written in the order of the frames
+            OrderedFramePipeline<StressFrame, StressFrame> pipeline(
+                [&](StressFrame& stressFrame)
+            {
+                stressFrame.stress = getStressOfFrame(stressFrame.frame);
+                return std::move(stressFrame);
+            },
+                [&](StressFrame const& stressFrame)
+            {
                 for (int i = 0; i < nbParticles; ++i) {
-                    currentStress = stress[frameValue][i];
+                    currentStress = stressFrame.stress[i];
                     top.atoms.pdbinfo[i].bfac = currentStress;
                     if (currentStress > 999.99) {
                         valueToLargeForPDB = true;
                     }
                 }
 
-                write_pdbfile(fp, title.c_str(), &top.atoms, coord_traj, ePBC, box, ' ', 0, nullptr, TRUE);
-                gmx_ffclose(fp);
+                write_pdbfile(fp, title.c_str(), &top.atoms, as_rvec_array(stressFrame.coord.data()), ePBC,
+                    stressFrame.box, ' ', 0, nullptr, TRUE);
+            });
+
+            for (int frame = 0; frame < nbFrames; ++frame)
+            {
+                read_next_x(oenv, status, &time, coord_traj, box);
+                if (frame%frameValue) continue;
+
+                StressFrame stressFrame;
+                stressFrame.frame = frame;
+                stressFrame.coord.assign(coord_traj, coord_traj + natoms);
+                copy_mat(box, stressFrame.box);
+                pipeline.push(std::move(stressFrame));
             }
+            pipeline.flush();
+
+            gmx_ffclose(fp);
             close_trx(status);
         }
     } else if (fn2ftp(opt2fn("-o", NFILE, fnm)) == efXPM) {
@@ -216,33 +255,43 @@ int gmx_fda_view_stress(int argc, char *argv[])
         real maxValue = 0;
         int nbFramesForOutput = 1;
         if (frameType == SINGLE) {
+            auto&& stress = getStressOfFrame(frameValue);
             for (int i = 0; i < nbParticles; ++i) {
                 snew(stressMatrix2[i], nbFramesForOutput);
-                real value = stress[frameValue][i];
+                real value = stress[i];
                 stressMatrix2[i][0] = value;
                 if (value < minValue) minValue = value;
                 if (value > maxValue) maxValue = value;
             }
         } else {
             nbFramesForOutput = ceil(static_cast<real>(nbFrames) / frameValue);
-            for (int i = 0; i < nbParticles; ++i) {
-                snew(stressMatrix2[i], nbFramesForOutput);
-                if (frameType == AVERAGE) {
-                    for (int j = 0, js = 0; j < nbFramesForOutput; ++j) {
-                        real value = 0.0;
-                        for (int k = 0; k < frameValue and js < nbFrames; ++k, ++js) value += stress[js][i];
-                        value /= frameValue;
-                        stressMatrix2[i][j] = value;
-                        if (value < minValue) minValue = value;
-                        if (value > maxValue) maxValue = value;
-                    }
-                } else {
-                    for (int j = 0, js = 0; j < nbFramesForOutput; ++j, js += frameValue) {
-                        real value = stress[js][i];
-                        stressMatrix2[i][j] = value;
-                        if (value < minValue) minValue = value;
-                        if (value > maxValue) maxValue = value;
+            for (int i = 0; i < nbParticles; ++i) snew(stressMatrix2[i], nbFramesForOutput);
+
+            // The columns are independent, their frames are read in parallel
+            #pragma omp parallel for schedule(dynamic)
+            for (int j = 0; j < nbFramesForOutput; ++j) {
+                try {
+                    int js = j * frameValue;
+                    std::vector<real> values(nbParticles, 0.0);
+                    if (frameType == AVERAGE) {
+                        for (int k = 0; k < frameValue and js < nbFrames; ++k, ++js) {
+                            auto&& stress = getStressOfFrame(js);
+                            for (int i = 0; i < nbParticles; ++i) values[i] += stress[i];
+                        }
+                        for (auto&& value : values) value /= frameValue;
+                    } else {
+                        values = getStressOfFrame(js);
                     }
+                    for (int i = 0; i < nbParticles; ++i) stressMatrix2[i][j] = values[i];
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+            }
+
+            for (int i = 0; i < nbParticles; ++i) {
+                for (int j = 0; j < nbFramesForOutput; ++j) {
+                    real value = stressMatrix2[i][j];
+                    if (value < minValue) minValue = value;
+                    if (value > maxValue) maxValue = value;
                 }
             }
         }
@@ -160,19 +160,31 @@ static void bc_symtab(const t_commrec *cr, t_symtab *symtab)
 
     block_bc(cr, symtab->nr);
     nr = symtab->nr;
-    snew_bc(cr, symtab->symbuf, 1);
-    symbuf          = symtab->symbuf;
-    symbuf->bufsize = nr;
-    snew_bc(cr, symbuf->buf, nr);
+    if (!MASTER(cr))
+    {
+        snew(symtab->symbuf, 1);
+        symbuf          = symtab->symbuf;
+        symbuf->bufsize = nr;
+        snew(symbuf->buf, nr);
+    }
     for (i = 0; i < nr; i++)
     {
+        /* The master symbol table can consist of several buffers,
+         * when symbols were added after reading the run input file.
+         */
+        char *name = nullptr;
         if (MASTER(cr))
         {
-            len = strlen(symbuf->buf[i]) + 1;
+            name = *get_symtab_handle(symtab, i);
+            len  = strlen(name) + 1;
         }
         block_bc(cr, len);
-        snew_bc(cr, symbuf->buf[i], len);
-        nblock_bc(cr, len, symbuf->buf[i]);
+        if (!MASTER(cr))
+        {
+            snew(symtab->symbuf->buf[i], len);
+            name = symtab->symbuf->buf[i];
+        }
+        nblock_bc(cr, len, name);
     }
 }
 
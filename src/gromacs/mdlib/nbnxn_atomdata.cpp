@@ -141,6 +141,13 @@ void nbnxn_atomdata_realloc(nbnxn_atomdata_t *nbat, int n)
                            n/nbat->na_c*sizeof(*nbat->energrp),
                            nbat->alloc, nbat->free);
     }
+    if (nbat->fda_groups != nullptr)
+    {
+        nbnxn_realloc_void(reinterpret_cast<void **>(&nbat->fda_groups),
+                           nbat->natoms/nbat->na_c*sizeof(*nbat->fda_groups),
+                           n/nbat->na_c*sizeof(*nbat->fda_groups),
+                           nbat->alloc, nbat->free);
+    }
     nbnxn_realloc_void(reinterpret_cast<void **>(&nbat->x),
                        nbat->natoms*nbat->xstride*sizeof(*nbat->x),
                        n*nbat->xstride*sizeof(*nbat->x),
@@ -722,6 +729,7 @@ void nbnxn_atomdata_init(const gmx::MDLogger &mdlog,
         nbat->neg_2log++;
     }
     nbat->energrp = nullptr;
+    nbat->fda_groups = nullptr;
     nbat->alloc(reinterpret_cast<void **>(&nbat->shift_vec), SHIFTS*sizeof(*nbat->shift_vec));
     nbat->xstride = (nbat->XFormat == nbatXYZQ ? STRIDE_XYZQ : DIM);
     nbat->fstride = (nbat->FFormat == nbatXYZQ ? STRIDE_XYZQ : DIM);
@@ -1014,6 +1022,79 @@ static void nbnxn_atomdata_set_energygroups(nbnxn_atomdata_t    *nbat,
     }
 }
 
+/* Copies the FDA group flags of the atoms in a cluster to a flag per cluster */
+static void copy_fda_groups_to_nbat(const int *a, int na, int na_round,
+                                    int na_c,
+                                    const int *in, int *innb)
+{
+    int i;
+
+    int j = 0;
+    for (i = 0; i < na; i += na_c)
+    {
+        int flags = 0;
+        for (int sa = 0; sa < na_c; sa++)
+        {
+            int at = a[i+sa];
+            if (at >= 0)
+            {
+                if (GET_CGINFO_FDA_GROUP1(in[at]))
+                {
+                    flags |= NBNXN_FDA_GROUP1;
+                }
+                if (GET_CGINFO_FDA_GROUP2(in[at]))
+                {
+                    flags |= NBNXN_FDA_GROUP2;
+                }
+            }
+        }
+        innb[j++] = flags;
+    }
+    /* Complete the partially filled last cell with fill */
+    for (; i < na_round; i += na_c)
+    {
+        innb[j++] = 0;
+    }
+}
+
+/* Set the FDA group flags for clusters in nbnxn_atomdata_t */
+static void nbnxn_atomdata_set_fda_groups(nbnxn_atomdata_t    *nbat,
+                                          const nbnxn_search  *nbs,
+                                          const int           *atinfo)
+{
+    if (nbat->fda_groups == nullptr)
+    {
+        return;
+    }
+
+    for (const nbnxn_grid_t &grid : nbs->grid)
+    {
+        /* Loop over all columns and copy and fill */
+        for (int i = 0; i < grid.numCells[XX]*grid.numCells[YY]; i++)
+        {
+            int ncz = grid.cxy_ind[i+1] - grid.cxy_ind[i];
+            int ash = (grid.cell0 + grid.cxy_ind[i])*grid.na_sc;
+
+            copy_fda_groups_to_nbat(nbs->a.data() + ash, grid.cxy_na[i], ncz*grid.na_sc,
+                                    nbat->na_c,
+                                    atinfo, nbat->fda_groups+(ash>>grid.na_c_2log));
+        }
+    }
+}
+
+void nbnxn_atomdata_enable_fda_groups(nbnxn_atomdata_t *nbat)
+{
+    if (nbat->fda_groups == nullptr)
+    {
+        /* The cluster size is only known after the first gridding,
+         * before that nalloc is zero and a single element is allocated.
+         */
+        int nclusters = (nbat->na_c > 0 ? nbat->nalloc/nbat->na_c : 0);
+        nbat->alloc(reinterpret_cast<void **>(&nbat->fda_groups),
+                    std::max(nclusters, 1)*sizeof(*nbat->fda_groups));
+    }
+}
+
 /* Sets all required atom parameter data in nbnxn_atomdata_t */
 void nbnxn_atomdata_set(nbnxn_atomdata_t    *nbat,
                         const nbnxn_search  *nbs,
@@ -1033,6 +1114,8 @@ void nbnxn_atomdata_set(nbnxn_atomdata_t    *nbat,
     nbnxn_atomdata_set_ljcombparams(nbat, nbs);
 
     nbnxn_atomdata_set_energygroups(nbat, nbs, atinfo);
+
+    nbnxn_atomdata_set_fda_groups(nbat, nbs, atinfo);
 }
 
 /* Copies the shift vector array to nbnxn_atomdata_t */
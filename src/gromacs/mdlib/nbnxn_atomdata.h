@@ -101,6 +101,11 @@ void nbnxn_atomdata_set(nbnxn_atomdata_t    *nbat,
                         const t_mdatoms     *mdatoms,
                         const int           *atinfo);
 
+/* Let nbnxn_atomdata_set store the FDA group flags per cluster from atinfo,
+ * the pair search will then only generate cluster pairs between the two FDA groups.
+ */
+void nbnxn_atomdata_enable_fda_groups(nbnxn_atomdata_t *nbat);
+
 /* Copy the shift vectors to nbat */
 void nbnxn_atomdata_copy_shiftvec(gmx_bool          dynamic_box,
                                   rvec             *shift_vec,
@@ -225,6 +225,12 @@ nbnxn_kernel_cpu(nonbonded_verlet_group_t  *nbvg,
 
     GMX_ASSERT(nbl[0]->nci >= 0, "nci<0, which signals an invalid pair-list");
 
+    /* The SIMD kernels load the FDA group flags in nbnxn atom order */
+    if (fda && nbvg->kernel_type != nbnxnk4x4_PlainC)
+    {
+        fda->set_nbnxn_atom_order(cellInv);
+    }
+
     int gmx_unused nthreads = gmx_omp_nthreads_get(emntNonbonded);
 #pragma omp parallel for schedule(static) num_threads(nthreads)
     for (int nb = 0; nb < nnbl; nb++)
@@ -422,6 +428,12 @@ nbnxn_kernel_cpu(nonbonded_verlet_group_t  *nbvg,
                 }
             }
         }
+
+        /* Pairwise forces staged by the SIMD kernels of this thread */
+        if (fda)
+        {
+            fda->flush_nonbonded_staging(&cellInv[0]);
+        }
     }
 
     if (forceFlags & GMX_FORCE_ENERGY)
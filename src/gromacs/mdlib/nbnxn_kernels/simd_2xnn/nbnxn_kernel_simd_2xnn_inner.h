@@ -866,6 +866,68 @@
     fscal_S2    = rinvsq_S2 * frcoul_S2;
 #endif
 
+    /* pairwise forces
+     * The threshold and group masks are computed for all lanes at once,
+     * cluster pairs with interesting forces are stored as complete registers
+     * into the staging buffer, which is consumed by FDA after the kernel.
+     * Each register holds two i-atoms, so that the rows have the same layout as for 4xN.
+     */
+    if (fda_staging)
+    {
+        SimdReal fda_jg1_S  = loadDuplicateHsimd(fda_in_group1 + aj);
+        SimdReal fda_jg2_S  = loadDuplicateHsimd(fda_in_group2 + aj);
+        SimdBool fda_grp_S0 = (zero_S < fma(fda_ig1_S0, fda_jg2_S, fda_ig2_S0 * fda_jg1_S));
+        SimdBool fda_grp_S2 = (zero_S < fma(fda_ig1_S2, fda_jg2_S, fda_ig2_S2 * fda_jg1_S));
+
+#ifdef CALC_COULOMB
+        SimdReal fcoul_S0    = rinvsq_S0 * frcoul_S0;
+        SimdReal fcoul_S2    = rinvsq_S2 * frcoul_S2;
+        SimdBool fda_coul_S0 = fda_grp_S0 && (fda_tiny_S < abs(fcoul_S0));
+        SimdBool fda_coul_S2 = fda_grp_S2 && (fda_tiny_S < abs(fcoul_S2));
+        fcoul_S0             = selectByMask(fcoul_S0, fda_coul_S0);
+        fcoul_S2             = selectByMask(fcoul_S2, fda_coul_S2);
+        SimdBool fda_any_S   = fda_coul_S0 || fda_coul_S2;
+#else
+        SimdReal fcoul_S0    = setZero();
+        SimdReal fcoul_S2    = setZero();
+        SimdBool fda_any_S   = (one_S < zero_S);
+#endif
+#ifdef CALC_LJ
+        SimdReal fvdw_S0     = rinvsq_S0 * frLJ_S0;
+        SimdBool fda_vdw_S0  = fda_grp_S0 && (fda_tiny_S < abs(fvdw_S0));
+        fvdw_S0              = selectByMask(fvdw_S0, fda_vdw_S0);
+        fda_any_S            = fda_any_S || fda_vdw_S0;
+#else
+        SimdReal fvdw_S0     = setZero();
+#endif
+#if defined CALC_LJ && !defined HALF_LJ
+        SimdReal fvdw_S2     = rinvsq_S2 * frLJ_S2;
+        SimdBool fda_vdw_S2  = fda_grp_S2 && (fda_tiny_S < abs(fvdw_S2));
+        fvdw_S2              = selectByMask(fvdw_S2, fda_vdw_S2);
+        fda_any_S            = fda_any_S || fda_vdw_S2;
+#else
+        /* Atom 2 and 3 don't have LJ */
+        SimdReal fvdw_S2     = setZero();
+#endif
+
+        if (anyTrue(fda_any_S))
+        {
+            real *fda_block = fda_staging->append(ci*UNROLLI, aj, UNROLLJ);
+
+            store(fda_block +  0*UNROLLJ, fcoul_S0);
+            store(fda_block +  2*UNROLLJ, fcoul_S2);
+            store(fda_block +  4*UNROLLJ, fvdw_S0);
+            store(fda_block +  6*UNROLLJ, fvdw_S2);
+            store(fda_block +  8*UNROLLJ, dx_S0);
+            store(fda_block + 10*UNROLLJ, dx_S2);
+            store(fda_block + 12*UNROLLJ, dy_S0);
+            store(fda_block + 14*UNROLLJ, dy_S2);
+            store(fda_block + 16*UNROLLJ, dz_S0);
+            store(fda_block + 18*UNROLLJ, dz_S2);
+        }
+    }
+    /* end pairwise forces */
+
     /* Calculate temporary vectorial force */
     tx_S0       = fscal_S0 * dx_S0;
     tx_S2       = fscal_S2 * dx_S2;
@@ -1143,134 +1143,92 @@
     fscal_S3    = rinvsq_S3 * frcoul_S3;
 #endif
 
-    /* pairwise forces */
-    int ai = ci * UNROLLI;
-
-#if defined CALC_COULOMB
-    SimdReal fcoul_S0 = rinvsq_S0 * frcoul_S0;
-    SimdReal fcoul_S1 = rinvsq_S1 * frcoul_S1;
-    SimdReal fcoul_S2 = rinvsq_S2 * frcoul_S2;
-    SimdReal fcoul_S3 = rinvsq_S3 * frcoul_S3;
-    real* real_fcoul_S0 = (real*)&fcoul_S0;
-    real* real_fcoul_S1 = (real*)&fcoul_S1;
-    real* real_fcoul_S2 = (real*)&fcoul_S2;
-    real* real_fcoul_S3 = (real*)&fcoul_S3;
-#endif
-#if defined CALC_LJ
-    SimdReal fvdw_S0 = rinvsq_S0 * frLJ_S0;
-    SimdReal fvdw_S1 = rinvsq_S1 * frLJ_S1;
-    real* real_fvdw_S0 = (real*)&fvdw_S0;
-    real* real_fvdw_S1 = (real*)&fvdw_S1;
-#if !defined HALF_LJ
-    SimdReal fvdw_S2 = rinvsq_S2 * frLJ_S2;
-    SimdReal fvdw_S3 = rinvsq_S3 * frLJ_S3;
-    real* real_fvdw_S2 = (real*)&fvdw_S2;
-    real* real_fvdw_S3 = (real*)&fvdw_S3;
-#endif
-#endif
-
-    real* real_dx_S0 = (real*)&dx_S0;
-    real* real_dy_S0 = (real*)&dy_S0;
-    real* real_dz_S0 = (real*)&dz_S0;
-    real* real_dx_S1 = (real*)&dx_S1;
-    real* real_dy_S1 = (real*)&dy_S1;
-    real* real_dz_S1 = (real*)&dz_S1;
-    real* real_dx_S2 = (real*)&dx_S2;
-    real* real_dy_S2 = (real*)&dy_S2;
-    real* real_dz_S2 = (real*)&dz_S2;
-    real* real_dx_S3 = (real*)&dx_S3;
-    real* real_dy_S3 = (real*)&dy_S3;
-    real* real_dz_S3 = (real*)&dz_S3;
-
-    for (int j = 0; j < UNROLLJ; ++j) {
-#if defined CALC_LJ && defined CALC_COULOMB
-        if (fabs(real_fvdw_S0[j]) > PF_TINY_REAL_NUMBER && fabs(real_fcoul_S0[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded(cellInv[ai], cellInv[aj+j], real_fcoul_S0[j], real_fvdw_S0[j], real_dx_S0[j], real_dy_S0[j], real_dz_S0[j]);
-        } else if (fabs(real_fvdw_S0[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S0[j], real_dx_S0[j], real_dy_S0[j], real_dz_S0[j]);
-        } else if (fabs(real_fcoul_S0[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S0[j], real_dx_S0[j], real_dy_S0[j], real_dz_S0[j]);
-        }
-#endif
-#if defined CALC_LJ && !defined CALC_COULOMB
-        if (fabs(real_fvdw_S0[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S0[j], real_dx_S0[j], real_dy_S0[j], real_dz_S0[j]);
-        }
-#endif
-#if defined CALC_COULOMB && !defined CALC_LJ
-        if (fabs(real_fcoul_S0[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S0[j], real_dx_S0[j], real_dy_S0[j], real_dz_S0[j]);
-        }
-#endif
-#if defined CALC_LJ && defined CALC_COULOMB
-        if (fabs(real_fvdw_S1[j]) > PF_TINY_REAL_NUMBER && fabs(real_fcoul_S1[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded(cellInv[ai+1], cellInv[aj+j], real_fcoul_S1[j], real_fvdw_S1[j], real_dx_S1[j], real_dy_S1[j], real_dz_S1[j]);
-        } else if (fabs(real_fvdw_S1[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+1], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S1[j], real_dx_S1[j], real_dy_S1[j], real_dz_S1[j]);
-        } else if (fabs(real_fcoul_S1[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+1], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S1[j], real_dx_S1[j], real_dy_S1[j], real_dz_S1[j]);
-        }
-#endif
-#if defined CALC_LJ && !defined CALC_COULOMB
-        if (fabs(real_fvdw_S1[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+1], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S1[j], real_dx_S1[j], real_dy_S1[j], real_dz_S1[j]);
-        }
-#endif
-#if defined CALC_COULOMB && !defined CALC_LJ
-        if (fabs(real_fcoul_S1[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+1], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S1[j], real_dx_S1[j], real_dy_S1[j], real_dz_S1[j]);
-        }
-#endif
-#if defined CALC_LJ && defined CALC_COULOMB
-#if !defined HALF_LJ
-        if (fabs(real_fvdw_S2[j]) > PF_TINY_REAL_NUMBER && fabs(real_fcoul_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded(cellInv[ai+2], cellInv[aj+j], real_fcoul_S2[j], real_fvdw_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        } else if (fabs(real_fvdw_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+2], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        } else if (fabs(real_fcoul_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+2], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        }
+    /* pairwise forces
+     * The threshold and group masks are computed for all lanes at once,
+     * cluster pairs with interesting forces are stored as complete registers
+     * into the staging buffer, which is consumed by FDA after the kernel.
+     */
+    if (fda_staging)
+    {
+        SimdReal fda_jg1_S  = load<SimdReal>(fda_in_group1 + aj);
+        SimdReal fda_jg2_S  = load<SimdReal>(fda_in_group2 + aj);
+        SimdBool fda_grp_S0 = (zero_S < fma(fda_ig1_S0, fda_jg2_S, fda_ig2_S0 * fda_jg1_S));
+        SimdBool fda_grp_S1 = (zero_S < fma(fda_ig1_S1, fda_jg2_S, fda_ig2_S1 * fda_jg1_S));
+        SimdBool fda_grp_S2 = (zero_S < fma(fda_ig1_S2, fda_jg2_S, fda_ig2_S2 * fda_jg1_S));
+        SimdBool fda_grp_S3 = (zero_S < fma(fda_ig1_S3, fda_jg2_S, fda_ig2_S3 * fda_jg1_S));
+
+#ifdef CALC_COULOMB
+        SimdReal fcoul_S0    = rinvsq_S0 * frcoul_S0;
+        SimdReal fcoul_S1    = rinvsq_S1 * frcoul_S1;
+        SimdReal fcoul_S2    = rinvsq_S2 * frcoul_S2;
+        SimdReal fcoul_S3    = rinvsq_S3 * frcoul_S3;
+        SimdBool fda_coul_S0 = fda_grp_S0 && (fda_tiny_S < abs(fcoul_S0));
+        SimdBool fda_coul_S1 = fda_grp_S1 && (fda_tiny_S < abs(fcoul_S1));
+        SimdBool fda_coul_S2 = fda_grp_S2 && (fda_tiny_S < abs(fcoul_S2));
+        SimdBool fda_coul_S3 = fda_grp_S3 && (fda_tiny_S < abs(fcoul_S3));
+        fcoul_S0             = selectByMask(fcoul_S0, fda_coul_S0);
+        fcoul_S1             = selectByMask(fcoul_S1, fda_coul_S1);
+        fcoul_S2             = selectByMask(fcoul_S2, fda_coul_S2);
+        fcoul_S3             = selectByMask(fcoul_S3, fda_coul_S3);
+        SimdBool fda_any_S   = fda_coul_S0 || fda_coul_S1 || fda_coul_S2 || fda_coul_S3;
 #else
-        if (fabs(real_fcoul_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+2], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        }
-#endif
-#endif
-#if defined CALC_LJ && !defined CALC_COULOMB && !defined HALF_LJ
-        if (fabs(real_fvdw_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+2], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        }
+        SimdReal fcoul_S0    = setZero();
+        SimdReal fcoul_S1    = setZero();
+        SimdReal fcoul_S2    = setZero();
+        SimdReal fcoul_S3    = setZero();
+        SimdBool fda_any_S   = (one_S < zero_S);
 #endif
-#if defined CALC_COULOMB && !defined CALC_LJ
-        if (fabs(real_fcoul_S2[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+2], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S2[j], real_dx_S2[j], real_dy_S2[j], real_dz_S2[j]);
-        }
-#endif
-#if defined CALC_LJ && defined CALC_COULOMB
-#if !defined HALF_LJ
-        if (fabs(real_fvdw_S3[j]) > PF_TINY_REAL_NUMBER && fabs(real_fcoul_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded(cellInv[ai+3], cellInv[aj+j], real_fcoul_S3[j], real_fvdw_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
-        } else if (fabs(real_fvdw_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+3], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
-        } else if (fabs(real_fcoul_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+3], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
-        }
+#ifdef CALC_LJ
+        SimdReal fvdw_S0     = rinvsq_S0 * frLJ_S0;
+        SimdReal fvdw_S1     = rinvsq_S1 * frLJ_S1;
+        SimdBool fda_vdw_S0  = fda_grp_S0 && (fda_tiny_S < abs(fvdw_S0));
+        SimdBool fda_vdw_S1  = fda_grp_S1 && (fda_tiny_S < abs(fvdw_S1));
+        fvdw_S0              = selectByMask(fvdw_S0, fda_vdw_S0);
+        fvdw_S1              = selectByMask(fvdw_S1, fda_vdw_S1);
+        fda_any_S            = fda_any_S || fda_vdw_S0 || fda_vdw_S1;
 #else
-        if (fabs(real_fcoul_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+3], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
-        }
-#endif
+        SimdReal fvdw_S0     = setZero();
+        SimdReal fvdw_S1     = setZero();
 #endif
-#if defined CALC_LJ && !defined CALC_COULOMB && !defined HALF_LJ
-        if (fabs(real_fvdw_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+3], cellInv[aj+j], fda::InteractionType_LJ, real_fvdw_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
-        }
+#if defined CALC_LJ && !defined HALF_LJ
+        SimdReal fvdw_S2     = rinvsq_S2 * frLJ_S2;
+        SimdReal fvdw_S3     = rinvsq_S3 * frLJ_S3;
+        SimdBool fda_vdw_S2  = fda_grp_S2 && (fda_tiny_S < abs(fvdw_S2));
+        SimdBool fda_vdw_S3  = fda_grp_S3 && (fda_tiny_S < abs(fvdw_S3));
+        fvdw_S2              = selectByMask(fvdw_S2, fda_vdw_S2);
+        fvdw_S3              = selectByMask(fvdw_S3, fda_vdw_S3);
+        fda_any_S            = fda_any_S || fda_vdw_S2 || fda_vdw_S3;
+#else
+        /* Atom 2 and 3 don't have LJ */
+        SimdReal fvdw_S2     = setZero();
+        SimdReal fvdw_S3     = setZero();
 #endif
-#if defined CALC_COULOMB && !defined CALC_LJ
-        if (fabs(real_fcoul_S3[j]) > PF_TINY_REAL_NUMBER) {
-            fda->add_nonbonded_single(cellInv[ai+3], cellInv[aj+j], fda::InteractionType_COULOMB, real_fcoul_S3[j], real_dx_S3[j], real_dy_S3[j], real_dz_S3[j]);
+
+        if (anyTrue(fda_any_S))
+        {
+            real *fda_block = fda_staging->append(ci*UNROLLI, aj, UNROLLJ);
+
+            store(fda_block +  0*UNROLLJ, fcoul_S0);
+            store(fda_block +  1*UNROLLJ, fcoul_S1);
+            store(fda_block +  2*UNROLLJ, fcoul_S2);
+            store(fda_block +  3*UNROLLJ, fcoul_S3);
+            store(fda_block +  4*UNROLLJ, fvdw_S0);
+            store(fda_block +  5*UNROLLJ, fvdw_S1);
+            store(fda_block +  6*UNROLLJ, fvdw_S2);
+            store(fda_block +  7*UNROLLJ, fvdw_S3);
+            store(fda_block +  8*UNROLLJ, dx_S0);
+            store(fda_block +  9*UNROLLJ, dx_S1);
+            store(fda_block + 10*UNROLLJ, dx_S2);
+            store(fda_block + 11*UNROLLJ, dx_S3);
+            store(fda_block + 12*UNROLLJ, dy_S0);
+            store(fda_block + 13*UNROLLJ, dy_S1);
+            store(fda_block + 14*UNROLLJ, dy_S2);
+            store(fda_block + 15*UNROLLJ, dy_S3);
+            store(fda_block + 16*UNROLLJ, dz_S0);
+            store(fda_block + 17*UNROLLJ, dz_S1);
+            store(fda_block + 18*UNROLLJ, dz_S2);
+            store(fda_block + 19*UNROLLJ, dz_S3);
         }
-#endif
     }
     /* end pairwise forces */
 
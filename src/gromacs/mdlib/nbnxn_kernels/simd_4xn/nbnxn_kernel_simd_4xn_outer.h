@@ -371,6 +371,22 @@
     Vstride_i    = nbat->nenergrp*(1<<nbat->neg_2log)*egps_jstride;
 #endif
 
+    /* FDA: group flags in nbnxn order and staging buffer of this thread, fda is only set for reruns */
+    const real            *fda_in_group1 = nullptr;
+    const real            *fda_in_group2 = nullptr;
+    fda::NonbondedStaging *fda_staging   = nullptr;
+    if (fda)
+    {
+        fda_in_group1 = fda->get_nbnxn_in_group1();
+        fda_in_group2 = fda->get_nbnxn_in_group2();
+        fda_staging   = &fda->get_nonbonded_staging();
+    }
+    SimdReal  fda_tiny_S(PF_TINY_REAL_NUMBER);
+    SimdReal  fda_ig1_S0 = setZero(), fda_ig2_S0 = setZero();
+    SimdReal  fda_ig1_S1 = setZero(), fda_ig2_S1 = setZero();
+    SimdReal  fda_ig1_S2 = setZero(), fda_ig2_S2 = setZero();
+    SimdReal  fda_ig1_S3 = setZero(), fda_ig2_S3 = setZero();
+
     l_cj = nbl->cj;
 
     ninner = 0;
@@ -415,6 +431,18 @@
         do_coul = ((nbln->shift & NBNXN_CI_DO_COUL(0)) != 0);
         half_LJ = (((nbln->shift & NBNXN_CI_HALF_LJ(0)) != 0) || !do_LJ) && do_coul;
 
+        if (fda_staging)
+        {
+            fda_ig1_S0 = SimdReal(fda_in_group1[ci*UNROLLI + 0]);
+            fda_ig1_S1 = SimdReal(fda_in_group1[ci*UNROLLI + 1]);
+            fda_ig1_S2 = SimdReal(fda_in_group1[ci*UNROLLI + 2]);
+            fda_ig1_S3 = SimdReal(fda_in_group1[ci*UNROLLI + 3]);
+            fda_ig2_S0 = SimdReal(fda_in_group2[ci*UNROLLI + 0]);
+            fda_ig2_S1 = SimdReal(fda_in_group2[ci*UNROLLI + 1]);
+            fda_ig2_S2 = SimdReal(fda_in_group2[ci*UNROLLI + 2]);
+            fda_ig2_S3 = SimdReal(fda_in_group2[ci*UNROLLI + 3]);
+        }
+
 #ifdef ENERGY_GROUPS
         egps_i = nbat->energrp[ci];
         {
@@ -272,6 +272,10 @@ enum {
     ljcrGEOM, ljcrLB, ljcrNONE, ljcrNR
 };
 
+/* FDA group flags of a cluster, set when at least one atom of the cluster is in the group */
+#define NBNXN_FDA_GROUP1  1
+#define NBNXN_FDA_GROUP2  2
+
 typedef struct nbnxn_atomdata_t { //NOLINT(clang-analyzer-optin.performance.Padding)
     nbnxn_alloc_t           *alloc;
     nbnxn_free_t            *free;
@@ -293,6 +297,9 @@ typedef struct nbnxn_atomdata_t { //NOLINT(clang-analyzer-optin.performance.Padd
     int                      nenergrp;        /* The number of energy groups                        */
     int                      neg_2log;        /* Log2 of nenergrp                                   */
     int                     *energrp;         /* The energy groups per cluster, can be NULL         */
+    int                     *fda_groups;      /* The FDA group flags per cluster, NULL when the pair
+                                               * search does not filter on FDA groups
+                                               */
     gmx_bool                 bDynamicBox;     /* Do we need to update shift_vec every step?    */
     rvec                    *shift_vec;       /* Shift vectors, copied from t_forcerec              */
     int                      xstride;         /* stride for a coordinate in x (usually 3 or 4)      */
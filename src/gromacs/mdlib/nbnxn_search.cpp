@@ -2218,6 +2218,56 @@ static void nb_realloc_sci(nbnxn_pairlist_t *nbl, int n)
                        nbl->alloc, nbl->free);
 }
 
+/* Returns the FDA group flags of j-cluster cj,
+ * the flags are stored for i-clusters, j-clusters can be half or twice as large.
+ */
+static inline int fdaGroupsOfJCluster(const nbnxn_atomdata_t *nbat,
+                                      const nbnxn_grid_t     *gridj,
+                                      int                     cj)
+{
+    if (gridj->na_cj == gridj->na_c)
+    {
+        return nbat->fda_groups[cj];
+    }
+    else if (2*gridj->na_cj == gridj->na_c)
+    {
+        /* The flags of the whole i-cluster, which is conservative */
+        return nbat->fda_groups[cj >> 1];
+    }
+    else
+    {
+        return nbat->fda_groups[cj*2] | nbat->fda_groups[cj*2 + 1];
+    }
+}
+
+/* Removes the j-clusters added to the current ci entry from cjIndexStart on
+ * which can not have an atom pair with one atom in each FDA group.
+ * This reduces the kernel work of FDA reruns to the interface between the groups,
+ * as the energy group exclusions of FDA are not supported by the Verlet scheme.
+ */
+static void removeNonFdaClusterPairs(const nbnxn_atomdata_t *nbat,
+                                     const nbnxn_grid_t     *gridj,
+                                     int                     cjIndexStart,
+                                     nbnxn_pairlist_t       *nbl)
+{
+    nbnxn_ci_t &iEntry     = nbl->ci[nbl->nci];
+    int         groups_i   = nbat->fda_groups[iEntry.ci];
+
+    int         cjIndexNew = cjIndexStart;
+    for (int cjIndex = cjIndexStart; cjIndex < nbl->ncj; cjIndex++)
+    {
+        int groups_j = fdaGroupsOfJCluster(nbat, gridj, nbl->cj[cjIndex].cj);
+
+        if (((groups_i & NBNXN_FDA_GROUP1) && (groups_j & NBNXN_FDA_GROUP2)) ||
+            ((groups_i & NBNXN_FDA_GROUP2) && (groups_j & NBNXN_FDA_GROUP1)))
+        {
+            nbl->cj[cjIndexNew++] = nbl->cj[cjIndex];
+        }
+    }
+    nbl->ncj          = cjIndexNew;
+    iEntry.cj_ind_end = cjIndexNew;
+}
+
 /* Make a new ci entry at index nbl->nci */
 static void new_ci_entry(nbnxn_pairlist_t *nbl, int ci, int shift, int flags)
 {
@@ -3738,6 +3788,11 @@ static void nbnxn_make_pairlist_part(const nbnxn_search *nbs,
                                             break;
                                     }
 
+                                    if (bSimple && nbat->fda_groups != nullptr)
+                                    {
+                                        removeNonFdaClusterPairs(nbat, gridj, ncj_old_j, nbl);
+                                    }
+
                                     if (bFBufferFlag && nbl->ncj > ncj_old_j)
                                     {
                                         int cbf = nbl->cj[ncj_old_j].cj >> gridj_flag_shift;
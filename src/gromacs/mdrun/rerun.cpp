@@ -89,6 +89,7 @@
 #include "gromacs/mdlib/mdsetup.h"
 #include "gromacs/mdlib/membed.h"
 #include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_atomdata.h"
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/mdlib/ns.h"
 #include "gromacs/mdlib/resethandler.h"
@@ -348,6 +349,15 @@ void gmx::Integrator::do_rerun()
         state         = stateInstance.get();
         dd_init_local_state(cr->dd, state_global, state);
 
+        // FDA uses the global atom indices and merges the pairs of all ranks on the master rank.
+        // The group flags are set in the global atom info, which is copied at each repartitioning.
+        fr->fda->set_domain_decomposition(cr);
+        if (fr->cutoff_scheme == ecutsVERLET && fr->fda->get_settings().nonbonded_exclusion_on)
+        {
+            fr->fda->set_cginfo_groups(fr->cginfo_mb, top_global->molblock.size());
+            nbnxn_atomdata_enable_fda_groups(fr->nbv->nbat);
+        }
+
         /* Distribute the charge groups over the nodes from the master node */
         dd_partition_system(fplog, mdlog, ir->init_step, cr, TRUE, 1,
                             state_global, top_global, ir,
@@ -355,6 +365,10 @@ void gmx::Integrator::do_rerun()
                             vsite, constr,
                             nrnb, nullptr, FALSE);
         shouldCheckNumberOfBondedInteractions = true;
+
+        // The bonded slots are intentionally not built with domain decomposition. The local topology
+        // changes at each repartitioning, so the slots would have to be rebuilt every time. Without
+        // slots, the bonded pairs are added through the pair index of DistributedForces.
     }
     else
     {
@@ -372,6 +386,17 @@ void gmx::Integrator::do_rerun()
         snew(top, 1);
         mdAlgorithmsSetupAtomData(cr, ir, top_global, top, fr,
                                   &graph, mdAtoms, constr, vsite, shellfc);
+
+        // The bonded pairs do not change during the run, their FDA slots are fixed here
+        fr->fda->set_bonded_slots(top->idef);
+
+        // The Verlet scheme does not support the FDA energy group exclusions,
+        // instead the pair search only generates cluster pairs between the FDA groups
+        if (fr->cutoff_scheme == ecutsVERLET && fr->fda->get_settings().nonbonded_exclusion_on)
+        {
+            fr->fda->set_cginfo_groups(fr->cginfo);
+            nbnxn_atomdata_enable_fda_groups(fr->nbv->nbat);
+        }
     }
 
     auto mdatoms = mdAtoms->mdatoms();
@@ -526,6 +551,9 @@ void gmx::Integrator::do_rerun()
                           "use a single rank");
             }
             prepareRerunState(rerun_fr, state_global, constructVsites, vsite, top->idef, ir->delta_t, *fr, graph);
+
+            // The dynamic FDA groups are evaluated before the coordinates are distributed to the ranks
+            fr->fda->update_dynamic_groups(state_global->x, state_global->box, ir->ePBC);
         }
 
         isLastStep = isLastStep || stopHandler->stoppingAfterCurrentStep(bNS);
@@ -594,7 +622,17 @@ void gmx::Integrator::do_rerun()
         }
 
         // FDA
-        fr->fda->save_and_write_scalar_time_averages(state->x, state->box, top_global);
+        if (DOMAINDECOMP(cr))
+        {
+            // The results are written on the master rank, which needs the global coordinates
+            dd_collect_vec(cr->dd, state, state->x,
+                           MASTER(cr) ? gmx::makeArrayRef(state_global->x) : gmx::ArrayRef<gmx::RVec>());
+            fr->fda->save_and_write_scalar_time_averages(MASTER(cr) ? state_global->x : state->x, state->box);
+        }
+        else
+        {
+            fr->fda->save_and_write_scalar_time_averages(state->x, state->box);
+        }
 
         /* Now we have the energies and forces corresponding to the
          * coordinates at time t.
@@ -668,6 +668,20 @@ int Mdrunner::mdrunner()
     {
         /* now broadcast everything to the non-master nodes/threads: */
         init_parallel(cr, inputrec, &mtop);
+
+#if defined(BUILD_WITH_FDA) && GMX_THREAD_MPI
+        // The thread-MPI ranks share the FDA settings read by the master rank,
+        // the FDA instances of the other ranks only collect forces for the master rank.
+        // Broadcasting the pointer is only valid because all thread-MPI ranks live in the
+        // same address space; with library MPI, FDASettings rejects multiple ranks.
+        GMX_RELEASE_ASSERT(GMX_THREAD_MPI, "The FDA settings pointer can only be broadcast to thread-MPI ranks");
+        fda::FDASettings *fda_settings = ptr_fda_settings.get();
+        gmx_bcast(sizeof(fda_settings), &fda_settings, cr);
+        if (!SIMMASTER(cr))
+        {
+            ptr_fda = std::make_shared<FDA>(*fda_settings, false);
+        }
+#endif
     }
 
     // Now each rank knows the inputrec that SIMMASTER read and used,
@@ -1251,6 +1265,13 @@ int Mdrunner::mdrunner()
 
 #ifdef BUILD_WITH_FDA
         fr->fda = ptr_fda.get();
+        if (fr->fda)
+        {
+            fr->fda->set_wallcycle(wcycle);
+            fr->fda->set_number_of_threads(std::max(gmx_omp_nthreads_get(emntDefault),
+                                                    std::max(gmx_omp_nthreads_get(emntNonbonded),
+                                                             gmx_omp_nthreads_get(emntBonded))));
+        }
 #endif
 
         /* Initialize the mdAtoms structure.
@@ -1485,6 +1506,13 @@ int Mdrunner::mdrunner()
                pmedata,
                EI_DYNAMICS(inputrec->eI) && !isMultiSim(ms));
 
+#ifdef BUILD_WITH_FDA
+    if (fr && fr->fda)
+    {
+        fr->fda->print_counters(fplog);
+    }
+#endif
+
     // Free PME data
     if (pmedata)
     {
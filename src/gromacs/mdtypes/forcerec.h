@@ -77,6 +77,10 @@ class GpuBonded;
  */
 #define SET_CGINFO_GID(cgi, gid)     (cgi) = (((cgi)  &  ~255) | (gid))
 #define GET_CGINFO_GID(cgi)        ( (cgi)            &   255)
+#define SET_CGINFO_FDA_GROUP1(cgi)   (cgi) =  ((cgi)  |  (1<<8))
+#define GET_CGINFO_FDA_GROUP1(cgi) ( (cgi)            &  (1<<8))
+#define SET_CGINFO_FDA_GROUP2(cgi)   (cgi) =  ((cgi)  |  (1<<9))
+#define GET_CGINFO_FDA_GROUP2(cgi) ( (cgi)            &  (1<<9))
 #define SET_CGINFO_FEP(cgi)          (cgi) =  ((cgi)  |  (1<<15))
 #define GET_CGINFO_FEP(cgi)        ( (cgi)            &  (1<<15))
 #define SET_CGINFO_EXCL_INTRA(cgi)   (cgi) =  ((cgi)  |  (1<<16))
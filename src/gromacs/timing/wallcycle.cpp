@@ -111,7 +111,7 @@ static const char *wcn[ewcNR] =
     "Wait PME GPU spread", "PME 3D-FFT", "PME solve", /* the strings for FFT/solve are repeated here for mixed mode counters */
     "Wait PME GPU gather", "Wait Bonded GPU", "Reduce GPU PME F",
     "Wait GPU NB nonloc.", "Wait GPU NB local", "NB X/F buffer ops.",
-    "Vsite spread", "COM pull force", "AWH",
+    "Vsite spread", "COM pull force", "AWH", "FDA",
     "Write traj.", "Update", "Constraints", "Comm. energies",
     "Enforced rotation", "Add rot. forces", "Position swapping", "IMD", "Test"
 };
@@ -133,6 +133,10 @@ static const char *wcsn[ewcsNR] =
     "Ewald F correction",
     "NB X buffer ops.",
     "NB F buffer ops.",
+    "FDA reduction",
+    "FDA residue COM",
+    "FDA time averages",
+    "FDA output",
 };
 
 /* PME GPU timing events' names - correspond to the enum in the gpu_timing.h */
@@ -48,6 +48,7 @@
 
 #include "modules/angle.h"
 #include "modules/distance.h"
+#include "modules/fda.h"
 #include "modules/freevolume.h"
 #include "modules/pairdist.h"
 #include "modules/rdf.h"
@@ -92,6 +93,7 @@ void registerTrajectoryAnalysisModules(CommandLineModuleManager *manager)
     CommandLineModuleGroup group = manager->addModuleGroup("Trajectory analysis");
     registerModule<AngleInfo>(manager, group);
     registerModule<DistanceInfo>(manager, group);
+    registerModule<FDAInfo>(manager, group);
     registerModule<FreeVolumeInfo>(manager, group);
     registerModule<PairDistanceInfo>(manager, group);
     registerModule<RdfInfo>(manager, group);
@@ -0,0 +1,501 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2026, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::analysismodules::ForceDistributionAnalysis.
+ *
+ * \author Bernd Doser <bernd.doser@h-its.org>
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "fda.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/commandline/filenm.h"
+#include "gromacs/compat/make_unique.h"
+#include "gromacs/domdec/dlbtiming.h"
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/ewald/pme.h"
+#include "gromacs/fda/FDA.h"
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/tpxio.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/gmxlib/network.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/hardware/detecthardware.h"
+#include "gromacs/hardware/hw_info.h"
+#include "gromacs/listed-forces/disre.h"
+#include "gromacs/listed-forces/orires.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/force.h"
+#include "gromacs/mdlib/force_flags.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/mdatoms.h"
+#include "gromacs/mdlib/mdsetup.h"
+#include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_atomdata.h"
+#include "gromacs/mdlib/ppforceworkload.h"
+#include "gromacs/mdlib/vsite.h"
+#include "gromacs/mdrunutility/mdmodules.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/enerdata.h"
+#include "gromacs/mdtypes/fcdata.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/filenameoption.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/mshift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/timing/wallcycle.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/basenetwork.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/logger.h"
+#include "gromacs/utility/physicalnodecommunicator.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+namespace
+{
+
+/********************************************************************
+ * ForceDistributionAnalysis
+ */
+
+/*! \brief
+ * Recomputes the forces of trajectory frames and passes them to FDA.
+ *
+ * A single-rank force environment is set up from the run input file, like
+ * for mdrun -rerun without domain decomposition, but without the energy,
+ * log and trajectory output. The pair list is rebuilt for each frame.
+ */
+class ForceDistributionAnalysis : public TrajectoryAnalysisModule
+{
+    public:
+        ForceDistributionAnalysis();
+        ~ForceDistributionAnalysis() override;
+
+        void initOptions(IOptionsContainer          *options,
+                         TrajectoryAnalysisSettings *settings) override;
+        void initAnalysis(const TrajectoryAnalysisSettings &settings,
+                          const TopologyInformation        &top) override;
+        void initAfterFirstFrame(const TrajectoryAnalysisSettings &settings,
+                                 const t_trxframe                 &fr) override;
+
+        void analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
+                          TrajectoryAnalysisModuleData *pdata) override;
+
+        void finishAnalysis(int nframes) override;
+        void writeOutput() override;
+
+    private:
+        //! Throws if the run input uses features which need the full mdrun setup.
+        void checkInputrec() const;
+        //! Returns the file name arguments in the form read by fda::FDASettings.
+        std::vector<t_filenm> fdaFileNames() const;
+
+        std::string                         fnPfi_;
+        std::string                         fnPfn_;
+        std::string                         fnPfa_;
+        std::string                         fnPfr_;
+        std::string                         fnPsa_;
+        std::string                         fnPsr_;
+        std::string                         fnVsa_;
+        std::string                         fnVma_;
+        int                                 nthreads_;
+
+        MDLogger                            mdlog_;
+        t_inputrec                          ir_;
+        gmx_mtop_t                          mtop_;
+        t_state                             state_;
+        t_commrec                          *cr_;
+        gmx_hw_info_t                      *hwinfo_;
+        MDModules                           mdModules_;
+        std::unique_ptr<fda::FDASettings>   fdaSettings_;
+        std::unique_ptr<FDA>                fda_;
+        t_forcerec                         *fr_;
+        t_fcdata                           *fcd_;
+        std::unique_ptr<MDAtoms>            mdAtoms_;
+        std::unique_ptr<gmx_vsite_t>        vsite_;
+        gmx_localtop_t                     *top_;
+        t_graph                            *graph_;
+        gmx_enerdata_t                     *enerd_;
+        t_nrnb                             *nrnb_;
+        gmx_wallcycle_t                     wcycle_;
+        PpForceWorkload                     ppForceWorkload_;
+        PaddedVector<RVec>                  f_;
+};
+
+ForceDistributionAnalysis::ForceDistributionAnalysis()
+    : nthreads_(0), cr_(nullptr), hwinfo_(nullptr), fr_(nullptr), fcd_(nullptr),
+      top_(nullptr), graph_(nullptr), enerd_(nullptr), nrnb_(nullptr), wcycle_(nullptr)
+{
+}
+
+ForceDistributionAnalysis::~ForceDistributionAnalysis()
+{
+    if (fr_ != nullptr)
+    {
+        if (fr_->pmedata != nullptr)
+        {
+            gmx_pme_destroy(fr_->pmedata);
+        }
+        done_forcerec(fr_, mtop_.molblock.size(), mtop_.groups.grps[egcENER].nr);
+    }
+    if (top_ != nullptr)
+    {
+        done_and_sfree_localtop(top_);
+    }
+    if (graph_ != nullptr)
+    {
+        done_graph(graph_);
+        sfree(graph_);
+    }
+    if (enerd_ != nullptr)
+    {
+        destroy_enerdata(enerd_);
+        sfree(enerd_);
+    }
+    sfree(fcd_);
+    sfree(nrnb_);
+    if (hwinfo_ != nullptr)
+    {
+        gmx_hardware_info_free();
+    }
+    done_commrec(cr_);
+}
+
+
+void
+ForceDistributionAnalysis::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *settings)
+{
+    static const char *const desc[] = {
+        "[THISMODULE] recomputes the forces of all trajectory frames with the",
+        "force field of the run input file [TT]-s[tt] and writes the pairwise",
+        "forces, punctual stress or virial stress selected in the FDA input file",
+        "[TT]-pfi[tt] for the groups of the index file [TT]-pfn[tt]. The output",
+        "files are the same as those of [TT]gmx mdrun -rerun[tt] with FDA.[PAR]",
+        "In contrast to [TT]gmx mdrun -rerun[tt], only the forces are computed,",
+        "no energy, log or trajectory files are written, and the pair list is",
+        "rebuilt for each frame. A single rank is used, [TT]-nt[tt] sets the",
+        "number of OpenMP threads for the force computation.[PAR]",
+        "Free-energy perturbation, pulling, enforced rotation, IMD, MiMiC and",
+        "shells are not supported, please use [TT]gmx mdrun -rerun[tt] for these."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(FileNameOption("pfi").legacyType(efPFI).inputFile().required()
+                           .store(&fnPfi_).defaultBasename("fda")
+                           .description("FDA input parameters"));
+    options->addOption(FileNameOption("pfn").legacyType(efNDX).inputFile().required()
+                           .store(&fnPfn_).defaultBasename("index")
+                           .description("Index file with the FDA groups"));
+    options->addOption(FileNameOption("pfa").legacyType(efPFA).outputFile()
+                           .store(&fnPfa_).defaultBasename("fda")
+                           .description("Atom-based pairwise forces"));
+    options->addOption(FileNameOption("pfr").legacyType(efPFR).outputFile()
+                           .store(&fnPfr_).defaultBasename("fda")
+                           .description("Residue-based pairwise forces"));
+    options->addOption(FileNameOption("psa").legacyType(efPSA).outputFile()
+                           .store(&fnPsa_).defaultBasename("fda")
+                           .description("Atom-based punctual stress"));
+    options->addOption(FileNameOption("psr").legacyType(efPSR).outputFile()
+                           .store(&fnPsr_).defaultBasename("fda")
+                           .description("Residue-based punctual stress"));
+    options->addOption(FileNameOption("vsa").legacyType(efVSA).outputFile()
+                           .store(&fnVsa_).defaultBasename("fda")
+                           .description("Atom-based virial stress"));
+    options->addOption(FileNameOption("vma").legacyType(efVMA).outputFile()
+                           .store(&fnVma_).defaultBasename("fda")
+                           .description("Atom-based von Mises virial stress"));
+    options->addOption(IntegerOption("nt").store(&nthreads_)
+                           .description("Number of OpenMP threads for the force computation (0 is guess)"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efRequireTop);
+    settings->setFlag(TrajectoryAnalysisSettings::efNoUserPBC);
+    settings->setFlag(TrajectoryAnalysisSettings::efNoUserRmPBC);
+    settings->setPBC(false);
+    settings->setRmPBC(false);
+    settings->setFrameFlags(TRX_NEED_X);
+}
+
+
+std::vector<t_filenm>
+ForceDistributionAnalysis::fdaFileNames() const
+{
+    auto fileName = [](int ftp, const char *opt, const std::string &value)
+        {
+            t_filenm fnm = { ftp, opt, "fda", ffOPTRD, {} };
+            if (value.empty())
+            {
+                fnm.filenames.push_back(std::string("fda") + ftp2ext_with_dot(ftp));
+            }
+            else
+            {
+                fnm.flag |= ffSET;
+                fnm.filenames.push_back(value);
+            }
+            return fnm;
+        };
+
+    return {
+               fileName(efPFI, "-pfi", fnPfi_),
+               fileName(efNDX, "-pfn", fnPfn_),
+               fileName(efPFA, "-pfa", fnPfa_),
+               fileName(efPFR, "-pfr", fnPfr_),
+               fileName(efPSA, "-psa", fnPsa_),
+               fileName(efPSR, "-psr", fnPsr_),
+               fileName(efVSA, "-vsa", fnVsa_),
+               fileName(efVMA, "-vma", fnVma_)
+    };
+}
+
+
+void
+ForceDistributionAnalysis::checkInputrec() const
+{
+    if (ir_.efep != efepNO)
+    {
+        GMX_THROW(InconsistentInputError("Free-energy perturbation is not supported, use gmx mdrun -rerun"));
+    }
+    if (ir_.bPull || ir_.bRot || ir_.bIMD || ir_.eI == eiMimic)
+    {
+        GMX_THROW(InconsistentInputError("Pulling, enforced rotation, IMD and MiMiC are not supported, "
+                                         "use gmx mdrun -rerun"));
+    }
+    for (const gmx_moltype_t &moltype : mtop_.moltype)
+    {
+        for (int i = 0; i < moltype.atoms.nr; ++i)
+        {
+            if (moltype.atoms.atom[i].ptype == eptShell)
+            {
+                GMX_THROW(InconsistentInputError("Shells are not supported, use gmx mdrun -rerun"));
+            }
+        }
+    }
+}
+
+
+void
+ForceDistributionAnalysis::initAnalysis(const TrajectoryAnalysisSettings & /*settings*/,
+                                        const TopologyInformation        &top)
+{
+    if (fn2ftp(top.fileName().c_str()) != efTPR)
+    {
+        GMX_THROW(InconsistentInputError("The force computation needs a run input file (-s)"));
+    }
+    read_tpx_state(top.fileName().c_str(), &ir_, &state_, &mtop_);
+    checkInputrec();
+
+    cr_ = init_commrec();
+    PhysicalNodeCommunicator physicalNodeComm(MPI_COMM_WORLD, gmx_physicalnode_id_hash());
+    hwinfo_ = gmx_detect_hardware(mdlog_, physicalNodeComm);
+    gmx_omp_nthreads_init(mdlog_, cr_, hwinfo_->nthreads_hw_avail, 1, nthreads_, 0,
+                          FALSE, ir_.cutoff_scheme == ecutsVERLET);
+
+    std::vector<t_filenm> fnm = fdaFileNames();
+    fdaSettings_ = compat::make_unique<fda::FDASettings>(fnm.size(), fnm.data(), &mtop_, false);
+    fda_         = compat::make_unique<FDA>(*fdaSettings_);
+    fda_->modify_energy_group_exclusions(&mtop_, &ir_);
+
+    mdModules_.assignOptionsToModules(*ir_.params, nullptr);
+
+    snew(fcd_, 1);
+    init_disres(nullptr, &mtop_, &ir_, cr_, nullptr, fcd_, &state_, FALSE);
+    init_orires(nullptr, &mtop_, &ir_, cr_, nullptr, &state_, &fcd_->orires);
+
+    wcycle_ = wallcycle_init(nullptr, -1, cr_);
+    snew(nrnb_, 1);
+
+    fr_                 = mk_forcerec();
+    fr_->forceProviders = mdModules_.initForceProviders();
+    init_forcerec(nullptr, mdlog_, fr_, fcd_, &ir_, &mtop_, cr_, state_.box,
+                  "table.xvg", "tablep.xvg", {}, *hwinfo_, nullptr, false, FALSE, -1);
+
+    fr_->fda = fda_.get();
+    fda_->set_wallcycle(wcycle_);
+    fda_->set_number_of_threads(std::max(gmx_omp_nthreads_get(emntDefault),
+                                         std::max(gmx_omp_nthreads_get(emntNonbonded),
+                                                  gmx_omp_nthreads_get(emntBonded))));
+
+    // As for mdrun -rerun, the pair list is built and the energies are computed for each frame
+    ir_.nstlist       = 1;
+    ir_.nstcalcenergy = 1;
+
+    mdAtoms_ = makeMDAtoms(nullptr, mtop_, ir_, false);
+    vsite_   = initVsite(mtop_, cr_);
+
+    if (EEL_PME(ir_.coulombtype) || EVDW_PME(ir_.vdwtype))
+    {
+        fr_->pmedata = gmx_pme_init(cr_, getNumPmeDomains(nullptr), &ir_, mtop_.natoms,
+                                    FALSE, FALSE, FALSE,
+                                    fr_->ic->ewaldcoeff_q, fr_->ic->ewaldcoeff_lj,
+                                    gmx_omp_nthreads_get(emntPME),
+                                    PmeRunMode::CPU, nullptr, nullptr, nullptr, mdlog_);
+    }
+
+    state_change_natoms(&state_, state_.natoms);
+    f_.resizeWithPadding(state_.natoms);
+
+    snew(top_, 1);
+    mdAlgorithmsSetupAtomData(cr_, &ir_, &mtop_, top_, fr_, &graph_, mdAtoms_.get(),
+                              nullptr, vsite_.get(), nullptr);
+    update_mdatoms(mdAtoms_->mdatoms(), state_.lambda[efptMASS]);
+
+    // The bonded pairs do not change during the run, their FDA slots are fixed here
+    fda_->set_bonded_slots(top_->idef);
+
+    // The Verlet scheme does not support the FDA energy group exclusions,
+    // instead the pair search only generates cluster pairs between the FDA groups
+    if (fr_->cutoff_scheme == ecutsVERLET && fdaSettings_->nonbonded_exclusion_on)
+    {
+        fda_->set_cginfo_groups(fr_->cginfo);
+        nbnxn_atomdata_enable_fda_groups(fr_->nbv->nbat);
+    }
+
+    snew(enerd_, 1);
+    init_enerdata(mtop_.groups.grps[egcENER].nr, ir_.fepvals->n_lambda, enerd_);
+}
+
+
+void
+ForceDistributionAnalysis::initAfterFirstFrame(const TrajectoryAnalysisSettings & /*settings*/,
+                                               const t_trxframe                 &fr)
+{
+    if (fr.natoms != mtop_.natoms)
+    {
+        GMX_THROW(InconsistentInputError(formatString(
+                                                 "Number of atoms in trajectory (%d) does not match the "
+                                                 "run input file (%d)", fr.natoms, mtop_.natoms)));
+    }
+    if (ir_.ePBC != epbcNONE)
+    {
+        if (!fr.bBox)
+        {
+            GMX_THROW(InconsistentInputError("The trajectory does not contain a box, while pbc is used"));
+        }
+        if (max_cutoff2(ir_.ePBC, fr.box) < gmx::square(fr_->rlist))
+        {
+            GMX_THROW(InconsistentInputError("The trajectory has too small box dimensions"));
+        }
+
+        /* Set the shift vectors.
+         * Necessary here when have a static box different from the tpr box.
+         */
+        calc_shifts(fr.box, fr_->shift_vec);
+    }
+}
+
+
+void
+ForceDistributionAnalysis::analyzeFrame(int frnr, const t_trxframe &fr, t_pbc * /*pbc*/,
+                                        TrajectoryAnalysisModuleData * /*pdata*/)
+{
+    const int64_t step = fr.bStep ? fr.step : frnr;
+    const double  t    = fr.bTime ? fr.time : step;
+
+    auto          x    = makeArrayRef(state_.x);
+    auto          frX  = arrayRefFromArray(reinterpret_cast<const RVec *>(fr.x), fr.natoms);
+    std::copy(frX.begin(), frX.end(), x.begin());
+    copy_mat(fr.box, state_.box);
+
+    fda_->update_dynamic_groups(state_.x, state_.box, ir_.ePBC);
+
+    tensor force_vir;
+    rvec   mu_tot;
+    do_force(nullptr, cr_, nullptr, &ir_, nullptr, nullptr,
+             step, nrnb_, wcycle_, top_, &mtop_.groups,
+             state_.box, state_.x.arrayRefWithPadding(), &state_.hist,
+             f_.arrayRefWithPadding(), force_vir, mdAtoms_->mdatoms(), enerd_, fcd_,
+             state_.lambda, graph_,
+             fr_, &ppForceWorkload_, vsite_.get(), mu_tot, t, nullptr,
+             GMX_FORCE_STATECHANGED | GMX_FORCE_DYNAMICBOX | GMX_FORCE_ALLFORCES |
+             GMX_FORCE_ENERGY | GMX_FORCE_NS,
+             DdOpenBalanceRegionBeforeForceComputation::no,
+             DdCloseBalanceRegionAfterForceComputation::no);
+
+    fda_->save_and_write_scalar_time_averages(state_.x, state_.box);
+}
+
+
+void
+ForceDistributionAnalysis::finishAnalysis(int /*nframes*/)
+{
+    fda_->write_scalar_time_averages();
+}
+
+
+void
+ForceDistributionAnalysis::writeOutput()
+{
+}
+
+}       // namespace
+
+const char FDAInfo::name[]             = "fda";
+const char FDAInfo::shortDescription[] =
+    "Compute pairwise forces and stress of a trajectory with FDA";
+
+TrajectoryAnalysisModulePointer FDAInfo::create()
+{
+    return TrajectoryAnalysisModulePointer(new ForceDistributionAnalysis);
+}
+
+} // namespace analysismodules
+
+} // namespace gmx
@@ -89,6 +89,7 @@ void TopologyInformation::fillFromInputFile(const std::string &filename)
     sfree(x);
     sfree(v);
     hasLoadedMtop_ = true;
+    fileName_      = filename;
     // TODO: Only load this here if the tool actually needs it; selections
     // take care of themselves.
     for (gmx_moltype_t &moltype : mtop_->moltype)
@@ -122,6 +122,8 @@ class TopologyInformation
          * \todo This should throw upon error but currently does
          * not. */
         void fillFromInputFile(const std::string &filename);
+        //! Returns the name of the file the topology was read from, or an empty string if not loaded.
+        const std::string &fileName() const { return fileName_; }
         /*! \brief Returns the loaded topology, or nullptr if not loaded. */
         gmx_mtop_t *mtop() const { return mtop_.get(); }
         //! Returns the loaded topology fully expanded, or nullptr if no topology is available.
@@ -169,6 +171,8 @@ class TopologyInformation
         ~TopologyInformation();
 
     private:
+        //! The name of the file the topology was read from.
+        std::string                      fileName_;
         //! The topology structure, or nullptr if no topology loaded.
         std::unique_ptr<gmx_mtop_t> mtop_;
         //! Whether a topology has been loaded.
@@ -0,0 +1,276 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/confio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/gmxpreprocess/grompp.h"
+#include "gromacs/gmxpreprocess/solvate.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/path.h"
+#include "gromacs/utility/smalloc.h"
+#include "programs/mdrun/mdrun_main.h"
+#include "testutils/cmdlinetest.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/testoptions.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Largest system, the systems of 10k, 100k and 1M atoms are generated up to this size
+int g_maxAtoms = 100000;
+
+//! Number of frames of the rerun trajectory
+int g_numFrames = 10;
+
+//! Number of threads of mdrun
+int g_numThreads = 1;
+
+//! \cond
+GMX_TEST_OPTIONS(FDABenchmarkOptions, options)
+{
+    options->addOption(IntegerOption("max_atoms").store(&g_maxAtoms)
+                           .description("Largest number of atoms of the water systems (10k, 100k, 1M)"));
+    options->addOption(IntegerOption("nframes").store(&g_numFrames)
+                           .description("Number of frames of the rerun trajectory"));
+    options->addOption(IntegerOption("nt").store(&g_numThreads)
+                           .description("Number of threads of mdrun"));
+}
+//! \endcond
+
+/// FDA configuration of a rerun, only one of atom- or residue-based is used
+struct BenchmarkCase
+{
+    std::string result_type;
+    bool residue_based;
+    std::string onepair;
+
+    std::string name() const
+    {
+        return result_type + (residue_based ? "_residue_" : "_atom_") + onepair;
+    }
+
+    /// mdrun option of the result file
+    std::string file_option() const
+    {
+        if (result_type == "pairwise_forces_vector" or result_type == "pairwise_forces_scalar") return residue_based ? "pfr" : "pfa";
+        if (result_type == "punctual_stress") return residue_based ? "psr" : "psa";
+        if (result_type == "virial_stress") return "vsa";
+        return "vma";
+    }
+};
+
+std::vector<BenchmarkCase> get_cases()
+{
+    std::vector<BenchmarkCase> cases;
+    for (bool residue_based : {false, true}) {
+        for (std::string onepair : {"summed", "detailed"}) {
+            cases.push_back({"pairwise_forces_vector", residue_based, onepair});
+            cases.push_back({"pairwise_forces_scalar", residue_based, onepair});
+        }
+        // Per atom data can only be computed from summed interactions
+        cases.push_back({"punctual_stress", residue_based, "summed"});
+    }
+    // Virial stress is only atom-based
+    cases.push_back({"virial_stress", false, "summed"});
+    cases.push_back({"virial_stress_von_mises", false, "summed"});
+    return cases;
+}
+
+void write_file(std::string const& filename, std::string const& content)
+{
+    std::ofstream os(filename);
+    os << content;
+}
+
+int64_t get_file_size(std::string const& filename)
+{
+    std::ifstream is(filename, std::ifstream::ate | std::ifstream::binary);
+    return is ? static_cast<int64_t>(is.tellg()) : 0;
+}
+
+/// Return the number of pairs kept by the FDA filters from the log file of the rerun
+int64_t get_pairs_kept(std::string const& logFilename)
+{
+    std::ifstream is(logFilename);
+    std::string line, label = "Pairs kept";
+    while (std::getline(is, line)) {
+        size_t pos = line.find(label);
+        if (pos != std::string::npos) return std::stoll(line.substr(pos + label.size()));
+    }
+    return 0;
+}
+
+/**
+ * Generate a box of flexible SPC water with about natoms atoms, each water molecule is a residue.
+ * The system, index file and a rerun trajectory of g_numFrames identical frames are written
+ * into directory and reused if they already exist. Returns the actual number of atoms.
+ */
+int prepare_system(std::string const& directory, int natoms)
+{
+    std::string tprFilename = directory + "/topol.tpr";
+    std::string trajFilename = directory + "/traj.trr";
+
+    if (!File::exists(tprFilename, File::returnFalseOnError)) {
+        Directory::create(directory);
+        gmx_chdir(directory.c_str());
+
+        write_file("topol.top",
+                   "#include \"oplsaa.ff/forcefield.itp\"\n"
+                   "#include \"oplsaa.ff/spc.itp\"\n\n"
+                   "[ system ]\n"
+                   "FDA benchmark water\n\n"
+                   "[ molecules ]\n");
+        write_file("md.mdp",
+                   "define        = -DFLEXIBLE\n"
+                   "integrator    = md\n"
+                   "nsteps        = 0\n"
+                   "cutoff-scheme = Verlet\n"
+                   "pbc           = xyz\n"
+                   "coulombtype   = Reaction-Field\n"
+                   "rcoulomb      = 1.0\n"
+                   "rvdw          = 1.0\n");
+
+        // Water has about 100 atoms per nm^3
+        double boxLength = std::cbrt(natoms / 100.0);
+
+        CommandLine callSolvate;
+        callSolvate.append("solvate");
+        callSolvate.addOption("-cs", "spc216.gro");
+        callSolvate.append("-box");
+        for (int d = 0; d < 3; ++d) callSolvate.append(std::to_string(boxLength));
+        callSolvate.addOption("-o", "conf.gro");
+        callSolvate.addOption("-p", "topol.top");
+        EXPECT_EQ(0, gmx_solvate(callSolvate.argc(), callSolvate.argv()));
+
+        CommandLine callGrompp;
+        callGrompp.append("grompp");
+        callGrompp.addOption("-f", "md.mdp");
+        callGrompp.addOption("-c", "conf.gro");
+        callGrompp.addOption("-p", "topol.top");
+        callGrompp.addOption("-o", "topol.tpr");
+        EXPECT_EQ(0, gmx_grompp(callGrompp.argc(), callGrompp.argv()));
+    }
+
+    gmx_mtop_t mtop;
+    bool haveTopology;
+    int ePBC;
+    rvec *x = nullptr;
+    matrix box;
+    readConfAndTopology(tprFilename.c_str(), &haveTopology, &mtop, &ePBC, &x, nullptr, box);
+
+    std::ofstream index(directory + "/index.ndx");
+    index << "[ all ]\n";
+    for (int i = 1; i <= mtop.natoms; ++i) index << i << "\n";
+
+    t_fileio *trajectory = gmx_trr_open(trajFilename.c_str(), "w");
+    for (int frame = 0; frame < g_numFrames; ++frame) {
+        gmx_trr_write_frame(trajectory, frame, frame, 0.0, box, mtop.natoms, x, nullptr, nullptr);
+    }
+    gmx_trr_close(trajectory);
+    sfree(x);
+
+    return mtop.natoms;
+}
+
+/// Results of a rerun
+struct BenchmarkResult
+{
+    int exitCode;
+    double seconds;
+    int64_t pairsKept;
+    int64_t peakRSS;
+    int64_t bytesWritten;
+};
+
+/**
+ * The rerun is forked into a child process, so that the peak resident set size of
+ * each rerun can be measured independently of the previous ones.
+ */
+BenchmarkResult run_case(std::string const& directory, BenchmarkCase const& c)
+{
+    gmx_chdir(directory.c_str());
+
+    write_file("fda.pfi",
+               "onepair = " + c.onepair + "\n"
+               "group1 = all\n"
+               "group2 = all\n"
+               "atombased = " + (c.residue_based ? "no" : c.result_type) + "\n"
+               "residuebased = " + (c.residue_based ? c.result_type : "no") + "\n"
+               "type = all\n"
+               "energy_grp_exclusion = no\n");
+
+    std::string resultFilename = "fda_" + c.name() + "." + c.file_option();
+    std::remove(resultFilename.c_str());
+
+    CommandLine callRerun;
+    callRerun.append("mdrun");
+    callRerun.addOption("-deffnm", c.name());
+    callRerun.addOption("-s", "topol.tpr");
+    callRerun.addOption("-rerun", "traj.trr");
+    callRerun.addOption("-nt", g_numThreads);
+    callRerun.addOption("-pfn", "index.ndx");
+    callRerun.addOption("-pfi", "fda.pfi");
+    callRerun.addOption(("-" + c.file_option()).c_str(), resultFilename);
+
+    BenchmarkResult result;
+    std::fflush(nullptr);
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) _exit(gmx_mdrun(callRerun.argc(), callRerun.argv()));
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result.pairsKept = get_pairs_kept(c.name() + ".log");
+    // ru_maxrss is given in kilobytes
+    result.peakRSS = static_cast<int64_t>(usage.ru_maxrss) * 1024;
+    result.bytesWritten = get_file_size(resultFilename);
+    return result;
+}
+
+TEST(FDABenchmark, Rerun)
+{
+    std::string cwd = Path::getWorkingDirectory();
+    std::string tempPath = TestFileManager::getGlobalOutputTempDirectory();
+
+    std::printf("\n%10s %-40s %10s %14s %12s %14s\n", "atoms", "case", "frames/s", "pairs/s", "peak RSS MB", "bytes written");
+    for (int natoms : {10000, 100000, 1000000}) {
+        if (natoms > g_maxAtoms) break;
+        std::string directory = tempPath + "/fda_benchmark_water_" + std::to_string(natoms);
+        int systemAtoms = prepare_system(directory, natoms);
+
+        for (auto const& c : get_cases()) {
+            // The rates include the setup of mdrun, run enough frames to make it negligible
+            BenchmarkResult result = run_case(directory, c);
+            EXPECT_EQ(0, result.exitCode) << "rerun " << c.name() << " failed";
+            std::printf("%10d %-40s %10.3f %14.0f %12.1f %14lld\n", systemAtoms, c.name().c_str(),
+                        g_numFrames / result.seconds, result.pairsKept / result.seconds,
+                        result.peakRSS / (1024.0 * 1024.0), static_cast<long long>(result.bytesWritten));
+            std::fflush(stdout);
+        }
+    }
+
+    gmx_chdir(cwd.c_str());
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
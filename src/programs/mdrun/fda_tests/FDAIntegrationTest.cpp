@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <iostream>
+#include "FDAIntegrationTest.h"
+#include "gromacs/fda/PairwiseForces.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/path.h"
+#include "gromacs/utility/real.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/TextSplitter.h"
+#include "testutils/LogicallyErrorComparer.h"
+
+namespace gmx
+{
+namespace test
+{
+
+std::ostream& operator << (std::ostream& os, TestDataStructure const& data)
+{
+    os << data.testDirectory;
+    if (data.nb_ranks > 1) os << " (" << data.nb_ranks << " ranks)";
+    return os;
+}
+
+void FDAIntegrationTest::SetUp()
+{
+    std::cout << GetParam() << std::endl;
+
+    cwd = gmx::Path::getWorkingDirectory();
+    std::string dataPath = std::string(fileManager().getInputDataDirectory()) + "/data";
+    std::string testPath = fileManager().getTemporaryFilePath("/" + GetParam().testDirectory);
+
+    std::string cmd = "mkdir -p " + testPath;
+    ASSERT_FALSE(system(cmd.c_str()));
+
+    cmd = "cp -r " + dataPath + "/" + GetParam().testDirectory + "/* " + testPath;
+    ASSERT_FALSE(system(cmd.c_str()));
+
+    gmx_chdir(testPath.c_str());
+}
+
+void FDAIntegrationTest::TearDown()
+{
+    gmx_chdir(cwd.c_str());
+}
+
+void FDAIntegrationTest::addFDAOptions(CommandLine& commandLine) const
+{
+    std::string atomExtension = GetParam().atomFileExtension;
+    std::string residueExtension = GetParam().residueFileExtension;
+
+    commandLine.addOption("-pfn", "index.ndx");
+    commandLine.addOption("-pfi", "fda.pfi");
+    if (!atomExtension.empty()) commandLine.addOption(("-" + atomExtension).c_str(), "fda." + atomExtension);
+    if (!residueExtension.empty()) commandLine.addOption(("-" + residueExtension).c_str(), "fda." + residueExtension);
+}
+
+namespace {
+
+/// The order of the pairwise forces depends on the domain decomposition and is only compared for a single rank
+template <class Comparer>
+void check_result(std::string const& extension, bool is_vector, bool sort, Comparer const& comparer)
+{
+    if (extension.empty()) return;
+
+    std::string filename = "fda." + extension;
+    std::string reference = filename + ".ref";
+
+    if (extension == "pfa" or extension == "pfr") {
+        if (is_vector)
+            EXPECT_TRUE((fda::PairwiseForces<fda::Force<fda::Vector>>(filename).equal(
+                fda::PairwiseForces<fda::Force<fda::Vector>>(reference), comparer, sort)));
+        else
+            EXPECT_TRUE((fda::PairwiseForces<fda::Force<real>>(filename).equal(
+                fda::PairwiseForces<fda::Force<real>>(reference), comparer, sort)));
+    } else {
+        EXPECT_TRUE((equal(TextSplitter(filename), TextSplitter(reference), comparer)));
+    }
+}
+
+} // namespace
+
+void FDAIntegrationTest::checkResults() const
+{
+    const double error_factor = 1e4;
+    const bool weight_by_magnitude = true;
+    const bool ignore_sign = false;
+
+    LogicallyEqualComparer<weight_by_magnitude, ignore_sign> comparer(error_factor);
+
+    const bool sort = GetParam().nb_ranks > 1;
+
+    check_result(GetParam().atomFileExtension, GetParam().is_vector, sort, comparer);
+    check_result(GetParam().residueFileExtension, GetParam().is_vector, sort, comparer);
+}
+
+} // namespace test
+} // namespace gmx
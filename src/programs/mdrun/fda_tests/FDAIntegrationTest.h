@@ -0,0 +1,80 @@
+#ifndef FDAINTEGRATIONTEST_H_
+#define FDAINTEGRATIONTEST_H_
+
+#include <iosfwd>
+#include <string>
+#include <gtest/gtest.h>
+#include "testutils/cmdlinetest.h"
+
+namespace gmx
+{
+namespace test
+{
+
+struct TestDataStructure
+{
+    TestDataStructure(
+        std::string const& testDirectory,
+        std::string const& atomFileExtension,
+        std::string const& residueFileExtension,
+        std::string const& trajectoryFilename = "traj.trr",
+        bool is_vector = false,
+        bool must_die = false,
+        int nb_ranks = 1
+    )
+      : testDirectory(testDirectory),
+        atomFileExtension(atomFileExtension),
+        residueFileExtension(residueFileExtension),
+        trajectoryFilename(trajectoryFilename),
+        is_vector(is_vector),
+        must_die(must_die),
+        nb_ranks(nb_ranks)
+    {}
+
+    std::string testDirectory;
+    std::string atomFileExtension;
+    std::string residueFileExtension;
+    std::string trajectoryFilename;
+    bool is_vector;
+    bool must_die;
+
+    /// Number of thread-MPI ranks, the results must be identical to the single rank reference
+    int nb_ranks;
+};
+
+//! Print the name of the test directory and the number of ranks in the test output
+std::ostream& operator << (std::ostream& os, TestDataStructure const& data);
+
+/**
+ * Common part of the FDA integration tests
+ *
+ * The test data directory is copied into a temporary directory, where FDA is executed.
+ * The results are compared with the reference files fda.<ext>.ref of the test data directory.
+ */
+class FDAIntegrationTest : public ::testing::WithParamInterface<TestDataStructure>,
+                           public CommandLineTestBase
+{
+protected:
+
+    /// Copy the test data into a temporary directory and change into it
+    void SetUp() override;
+
+    /// Change back into the original working directory
+    void TearDown() override;
+
+    /// Add the FDA input and output options of the test
+    void addFDAOptions(CommandLine& commandLine) const;
+
+    /// Compare the results with the references
+    void checkResults() const;
+
+private:
+
+    std::string cwd;
+
+};
+
+} // namespace test
+} // namespace gmx
+
+#endif /* FDAINTEGRATIONTEST_H_ */
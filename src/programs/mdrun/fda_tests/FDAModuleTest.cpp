@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "FDAIntegrationTest.h"
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/simd/support.h"
+#include "gromacs/trajectoryanalysis/cmdlinerunner.h"
+#include "gromacs/trajectoryanalysis/modules/fda.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Test fixture for the FDA trajectory analysis module, which must reproduce the results of mdrun -rerun
+class FDAModuleTest : public FDAIntegrationTest
+{};
+
+//! Test body for the FDA trajectory analysis module
+TEST_P(FDAModuleTest, Basic)
+{
+    ::gmx::test::CommandLine callModule;
+    callModule.append("fda");
+    callModule.addOption("-s", "topol.tpr");
+    callModule.addOption("-f", GetParam().trajectoryFilename);
+    callModule.addOption("-nt", 1);
+    addFDAOptions(callModule);
+
+    std::cout << "command: " << callModule.toString() << std::endl;
+
+    auto factory = [] { return TrajectoryAnalysisCommandLineRunner::createModule(analysismodules::FDAInfo::create()); };
+
+    if (GetParam().must_die) {
+        EXPECT_EXIT(CommandLineTestHelper::runModuleFactory(factory, &callModule), ::testing::ExitedWithCode(1), "");
+    } else {
+        ASSERT_FALSE(CommandLineTestHelper::runModuleFactory(factory, &callModule));
+        checkResults();
+    }
+}
+
+std::vector<TestDataStructure> get_module_tests()
+{
+    std::vector<TestDataStructure> tests {
+        {"alagly_verlet_summed_scalar", "pfa", "pfr"},
+        {"alagly_verlet_pbc_summed_scalar", "pfa", "pfr"},
+        {"alagly_verlet_pbc_summed_scalar_binary", "pfa", "pfr"},
+        {"alagly_verlet_dynamic_groups", "pfa", ""},
+        {"cmap_ignore_missing_potentials", "", "psr", "traj.xtc"},
+        {"cmap", "", "psr", "traj.xtc", false, true}
+    };
+
+    if (simdCompiled() == SimdType::None) {
+        tests.push_back({"alagly_pairwise_forces_scalar", "pfa", "pfr"});
+        tests.push_back({"alagly_punctual_stress", "psa", "psr"});
+        tests.push_back({"glycine_trimer_virial_stress", "vsa", ""});
+    }
+
+    return tests;
+}
+
+INSTANTIATE_TEST_CASE_P(AllFDAModuleTests, FDAModuleTest, ::testing::ValuesIn(get_module_tests()));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -6,22 +6,12 @@
  */
 
 #include <iostream>
-#include <string>
 #include <vector>
 #include <gtest/gtest.h>
 
+#include "FDAIntegrationTest.h"
 #include "gromacs/simd/support.h"
-#include "gromacs/fda/PairwiseForces.h"
-#include "gromacs/options/filenameoption.h"
-#include "gromacs/utility/futil.h"
-#include "gromacs/utility/path.h"
-#include "gromacs/utility/real.h"
-#include "gromacs/gmxpreprocess/grompp.h"
 #include "programs/mdrun/mdrun_main.h"
-#include "testutils/cmdlinetest.h"
-#include "testutils/testfilemanager.h"
-#include "testutils/TextSplitter.h"
-#include "testutils/LogicallyErrorComparer.h"
 
 namespace gmx
 {
@@ -30,71 +20,26 @@ namespace test
 namespace
 {
 
-struct TestDataStructure
-{
-    TestDataStructure(
-        std::string const& testDirectory,
-        std::string const& atomFileExtension,
-        std::string const& residueFileExtension,
-        std::string const& trajectoryFilename = "traj.trr",
-        bool is_vector = false,
-        bool must_die = false
-    )
-      : testDirectory(testDirectory),
-        atomFileExtension(atomFileExtension),
-        residueFileExtension(residueFileExtension),
-        trajectoryFilename(trajectoryFilename),
-        is_vector(is_vector),
-        must_die(must_die)
-    {}
-
-    std::string testDirectory;
-    std::string atomFileExtension;
-    std::string residueFileExtension;
-    std::string trajectoryFilename;
-    bool is_vector;
-    bool must_die;
-};
-
-//! Test fixture for FDA
-class FDATest : public ::testing::WithParamInterface<TestDataStructure>,
-                public CommandLineTestBase
+//! Test fixture for FDA with mdrun -rerun
+class FDATest : public FDAIntegrationTest
 {};
 
 //! Test body for FDA
 TEST_P(FDATest, Basic)
 {
-    std::cout << GetParam().testDirectory << std::endl;
-
-    std::string cwd = gmx::Path::getWorkingDirectory();
-    std::string dataPath = std::string(fileManager().getInputDataDirectory()) + "/data";
-    std::string testPath = fileManager().getTemporaryFilePath("/" + GetParam().testDirectory);
-
-    std::string cmd = "mkdir -p " + testPath;
-    ASSERT_FALSE(system(cmd.c_str()));
-
-    cmd = "cp -r " + dataPath + "/" + GetParam().testDirectory + "/* " + testPath;
-    ASSERT_FALSE(system(cmd.c_str()));
-
-    gmx_chdir(testPath.c_str());
-
-    std::string atomFilename = "fda." + GetParam().atomFileExtension;
-    std::string atomOption = "-" + GetParam().atomFileExtension;
-    std::string atomReference = atomFilename + ".ref";
-    std::string residueFilename = "fda." + GetParam().residueFileExtension;
-    std::string residueOption = "-" + GetParam().residueFileExtension;
-    std::string residueReference = residueFilename + ".ref";
-
     ::gmx::test::CommandLine callRerun;
     callRerun.append("gmx_fda mdrun");
     callRerun.addOption("-deffnm", "rerun");
     callRerun.addOption("-s", "topol.tpr");
     callRerun.addOption("-rerun", GetParam().trajectoryFilename);
-    callRerun.addOption("-nt", "1");
-    callRerun.addOption("-pfn", "index.ndx");
-    callRerun.addOption("-pfi", "fda.pfi");
-    if (!GetParam().atomFileExtension.empty()) callRerun.addOption(atomOption.c_str(), atomFilename.c_str());
-    if (!GetParam().residueFileExtension.empty()) callRerun.addOption(residueOption.c_str(), residueFilename.c_str());
+    if (GetParam().nb_ranks > 1) {
+        // Domain decomposition with thread-MPI
+        callRerun.addOption("-ntmpi", GetParam().nb_ranks);
+        callRerun.addOption("-ntomp", 1);
+    } else {
+        callRerun.addOption("-nt", 1);
+    }
+    addFDAOptions(callRerun);
 
     std::cout << "command: " << callRerun.toString() << std::endl;
 
@@ -102,37 +47,7 @@ TEST_P(FDATest, Basic)
         EXPECT_EXIT(gmx_mdrun(callRerun.argc(), callRerun.argv()), ::testing::ExitedWithCode(1), "");
     } else {
         ASSERT_FALSE(gmx_mdrun(callRerun.argc(), callRerun.argv()));
-
-		const double error_factor = 1e4;
-		const bool weight_by_magnitude = true;
-		const bool ignore_sign = false;
-
-		LogicallyEqualComparer<weight_by_magnitude, ignore_sign> comparer(error_factor);
-
-		// Check results
-		if (!GetParam().atomFileExtension.empty()) {
-			if (GetParam().atomFileExtension == "pfa")
-				if (GetParam().is_vector)
-					EXPECT_TRUE((fda::PairwiseForces<fda::Force<fda::Vector>>(atomFilename).equal(
-						fda::PairwiseForces<fda::Force<fda::Vector>>(atomReference), comparer)));
-				else
-					EXPECT_TRUE((fda::PairwiseForces<fda::Force<real>>(atomFilename).equal(
-						fda::PairwiseForces<fda::Force<real>>(atomReference), comparer)));
-			else
-				EXPECT_TRUE((equal(TextSplitter(atomFilename), TextSplitter(atomReference), comparer)));
-		}
-		if (!GetParam().residueFileExtension.empty()) {
-			if (GetParam().residueFileExtension == "pfr")
-				if (GetParam().is_vector)
-					EXPECT_TRUE((fda::PairwiseForces<fda::Force<fda::Vector>>(residueFilename).equal(
-						fda::PairwiseForces<fda::Force<fda::Vector>>(residueReference), comparer)));
-				else
-					EXPECT_TRUE((fda::PairwiseForces<fda::Force<real>>(residueFilename).equal(
-						fda::PairwiseForces<fda::Force<real>>(residueReference), comparer)));
-			else
-				EXPECT_TRUE((equal(TextSplitter(residueFilename), TextSplitter(residueReference), comparer)));
-		}
-		gmx_chdir(cwd.c_str());
+        checkResults();
     }
 }
 
@@ -142,13 +57,17 @@ std::vector<TestDataStructure> get_tests()
 		{"alagly_verlet_summed_scalar", "pfa", "pfr"},
 		{"alagly_verlet_pbc_summed_scalar", "pfa", "pfr"},
 		{"alagly_verlet_pbc_summed_scalar_binary", "pfa", "pfr", "traj.trr", false, false},
+		{"alagly_verlet_dynamic_groups", "pfa", ""},
 		{"cmap_ignore_missing_potentials", "", "psr", "traj.xtc"},
-		{"cmap", "", "psr", "traj.xtc", false, true}
+		{"cmap", "", "psr", "traj.xtc", false, true},
+		{"alagly_verlet_pbc_domain_decomposition", "pfa", "pfr"},
+		{"alagly_verlet_pbc_domain_decomposition", "pfa", "pfr", "traj.trr", false, false, 2}
 	};
 
 	if (simdCompiled() == SimdType::None) {
 		tests.push_back({"alagly_pairwise_forces_scalar", "pfa", "pfr"});
 		tests.push_back({"alagly_pairwise_forces_scalar_atom_based", "pfa", ""});
+		tests.push_back({"alagly_dynamic_groups_select_all", "pfa", ""});
 		tests.push_back({"alagly_pairwise_forces_scalar_no_residue_based", "pfa", ""});
 		tests.push_back({"alagly_pairwise_forces_scalar_detailed_no_residue_based", "pfa", ""});
 		tests.push_back({"alagly_pairwise_forces_vector", "pfa", "pfr", "traj.trr", true});